@@ -0,0 +1,92 @@
+#!/usr/bin/env bash
+# Compares the stack and the register-style expression codegen (--codegen).
+# Every runnable test program is compiled in both modes and run on each of
+# its inputs; the outputs must match. Reports the static instruction count
+# (from --stats) and the number of executed instructions (see
+# bench_common.sh).
+#
+# Usage: ./bench_codegen.sh [compiler options, e.g. -O1]
+
+set -u
+
+TEST_DIRS=("../tests/simple" "../tests/examples" "../tests/bonus")
+MODES=("stack" "regs")
+
+source "$(dirname "$0")/bench_common.sh"
+
+declare -A static_total dynamic_total
+for mode in "${MODES[@]}"; do
+	static_total[${mode}]=0
+	dynamic_total[${mode}]=0
+done
+mismatches=0
+
+printf "${BOLD}%-45s %10s %10s %12s %12s${RESET}\n" "program" "static" "static" "executed" "executed"
+printf "${BOLD}%-45s %10s %10s %12s %12s${RESET}\n" "" "stack" "regs" "stack" "regs"
+
+while IFS= read -r -d '' file; do
+	dir="$(dirname "${file}")"
+	name="${dir#../tests/}"
+	inputs=()
+	while IFS= read -r -d '' variation; do
+		[[ -f "${variation}/expected_output.txt" ]] || continue
+		if [[ -f "${variation}/source.in" ]]; then
+			inputs+=("${variation}/source.in")
+		else
+			inputs+=("/dev/null")
+		fi
+	done < <(find "${dir}" -mindepth 1 -maxdepth 1 -type d -print0 | sort -z)
+	(( ${#inputs[@]} > 0 )) || continue
+
+	declare -A static_count dynamic_count
+	compiled=true
+	for mode in "${MODES[@]}"; do
+		code="${TMP_DIR}/${mode}.code"
+		if ! bench_compile "${file}" "${code}" --codegen="${mode}" "$@" \
+			--stats="${TMP_DIR}/${mode}.json" 2>/dev/null; then
+			compiled=false
+			break
+		fi
+		static_count[${mode}]=$(grep -m1 -o '"instructions": [0-9]*' "${TMP_DIR}/${mode}.json" | grep -o '[0-9]*$')
+		dynamic_count[${mode}]=0
+		index=0
+		for input in "${inputs[@]}"; do
+			bench_run "${code}" "${input}" "${TMP_DIR}/${mode}.${index}.out"
+			dynamic_count[${mode}]=$(( dynamic_count[${mode}] + ${BENCH_EXECUTED:-0} ))
+			((index++))
+		done
+	done
+	if [[ "${compiled}" != true ]]; then
+		unset static_count dynamic_count
+		continue
+	fi
+
+	for (( i = 0; i < ${#inputs[@]}; i++ )); do
+		if ! cmp -s "${TMP_DIR}/stack.${i}.out" "${TMP_DIR}/regs.${i}.out"; then
+			printf "${RED}[MISMATCH]${RESET} %s (%s)\n" "${name}" "${inputs[${i}]}"
+			((mismatches++))
+		fi
+	done
+
+	printf "%-45s %10d %10d %12d %12d\n" "${name}" "${static_count[stack]}" "${static_count[regs]}" \
+		"${dynamic_count[stack]}" "${dynamic_count[regs]}"
+	for mode in "${MODES[@]}"; do
+		static_total[${mode}]=$(( static_total[${mode}] + static_count[${mode}] ))
+		dynamic_total[${mode}]=$(( dynamic_total[${mode}] + dynamic_count[${mode}] ))
+	done
+	unset static_count dynamic_count
+done < <(find "${TEST_DIRS[@]}" -name 'source.wren' -print0 | sort -z)
+
+printf "${BOLD}%-45s %10d %10d %12d %12d${RESET}\n" "total" "${static_total[stack]}" "${static_total[regs]}" \
+	"${dynamic_total[stack]}" "${dynamic_total[regs]}"
+if (( dynamic_total[stack] > 0 )); then
+	printf "executed instructions with --codegen=regs: %d%% of --codegen=stack\n" \
+		$(( 100 * dynamic_total[regs] / dynamic_total[stack] ))
+fi
+
+if (( mismatches > 0 )); then
+	printf "${RED}%d outputs differ between the modes${RESET}\n" "${mismatches}"
+	exit 1
+fi
+printf "${GREEN}All outputs match${RESET}\n"
+exit 0
@@ -0,0 +1,58 @@
+#!/usr/bin/env bash
+# Shared part of the bench_*.sh scripts, sourced by them. Checks for the
+# compiler and the interpreter (taken from $INTERPRETER), creates a temporary
+# directory and compiles and runs programs. The interpreter has to print the
+# number of executed instructions on stderr at BREAK, which is placed before
+# the EXIT of the program entry point.
+
+PROJECT_BIN="../ifj25"
+INTERPRETER="${INTERPRETER:-/pub/courses/ifj/ic25int/linux/ic25int}"
+
+if [[ -t 1 ]]; then
+	GREEN=$'\033[32m'
+	RED=$'\033[31m'
+	BOLD=$'\033[1m'
+	RESET=$'\033[0m'
+else
+	GREEN=""
+	RED=""
+	BOLD=""
+	RESET=""
+fi
+
+if [[ ! -x "${PROJECT_BIN}" ]]; then
+	echo "Binary ${PROJECT_BIN} not found or not executable. Run 'make' first." >&2
+	exit 1
+fi
+if ! command -v "${INTERPRETER}" > /dev/null; then
+	echo "Interpreter ${INTERPRETER} not found, set INTERPRETER." >&2
+	exit 1
+fi
+
+TMP_DIR="$(mktemp -d)"
+trap 'rm -rf "${TMP_DIR}"' EXIT
+
+# bench_compile <source> <code> [compiler options...]
+# Compiles the source into <code> and writes <code>.break with the BREAK.
+bench_compile() {
+	local source="$1"
+	local code="$2"
+	shift 2
+	"${PROJECT_BIN}" "$@" < "${source}" > "${code}" || return 1
+
+	# The first EXIT int@0 ends the program entry point
+	awk '!done && /^EXIT int@0/ { print "BREAK"; done = 1 } { print }' "${code}" > "${code}.break"
+}
+
+# bench_run <code> <input> <output>
+# Runs <code>.break from bench_compile and sets BENCH_STATUS (exit code),
+# BENCH_SECONDS (wall time) and BENCH_EXECUTED (empty if not reported).
+bench_run() {
+	local start end
+	start=$(date +%s.%N)
+	"${INTERPRETER}" "$1.break" < "$2" > "$3" 2> "${TMP_DIR}/bench.err"
+	BENCH_STATUS=$?
+	end=$(date +%s.%N)
+	BENCH_SECONDS=$(awk -v a="${start}" -v b="${end}" 'BEGIN { print b - a }')
+	BENCH_EXECUTED=$(grep -i 'instruction' "${TMP_DIR}/bench.err" | tail -n 1 | grep -o '[0-9][0-9]*' | tail -n 1)
+}
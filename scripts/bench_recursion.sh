@@ -0,0 +1,60 @@
+#!/usr/bin/env bash
+# Runs a self-recursive tail call at recursion depth 100000 (or $DEPTH)
+# compiled without and with -O1. At -O1 the call becomes a jump, so the
+# program has to run in constant frame depth. Reports the output, the wall
+# time and the number of executed instructions (see bench_common.sh).
+#
+# Usage: ./bench_recursion.sh [extra compiler options, e.g. --codegen=regs]
+
+set -u
+
+DEPTH="${DEPTH:-100000}"
+LEVELS=("-O0" "-O1")
+
+source "$(dirname "$0")/bench_common.sh"
+
+cat > "${TMP_DIR}/source.wren" << EOF
+import "ifj25" for Ifj
+class Program {
+    static sum(n, acc) {
+        if (n == 0) {
+            return acc
+        } else {
+            return sum(n - 1, acc + n)
+        }
+    }
+    static main() {
+        Ifj.write(sum(${DEPTH}, 0))
+        Ifj.write("\n")
+    }
+}
+EOF
+expected="$(( DEPTH * (DEPTH + 1) / 2 ))"
+
+printf "${BOLD}%-6s %-6s %12s %10s %14s${RESET}\n" "level" "result" "output" "time [s]" "executed"
+failures=0
+for level in "${LEVELS[@]}"; do
+	code="${TMP_DIR}/${level}.code"
+	if ! bench_compile "${TMP_DIR}/source.wren" "${code}" "${level}" "$@"; then
+		printf "${RED}%-6s compilation failed${RESET}\n" "${level}"
+		((failures++))
+		continue
+	fi
+
+	bench_run "${code}" /dev/null "${TMP_DIR}/out"
+	output="$(head -n 1 "${TMP_DIR}/out")"
+
+	result="${GREEN}ok${RESET}"
+	if [[ ${BENCH_STATUS} -ne 0 || "${output}" != "${expected}" ]]; then
+		result="${RED}FAIL${RESET}"
+		((failures++))
+	fi
+	printf "%-6s %-6s %12s %10.2f %14s\n" "${level}" "${result}" "${output:-exit ${BENCH_STATUS}}" \
+		"${BENCH_SECONDS}" "${BENCH_EXECUTED:-?}"
+done
+
+if (( failures > 0 )); then
+	printf "${RED}%d runs failed${RESET}\n" "${failures}"
+	exit 1
+fi
+exit 0
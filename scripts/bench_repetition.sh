@@ -0,0 +1,55 @@
+#!/usr/bin/env bash
+# Repeats a one-character string 1000, 100000 and 1000000 times (or the
+# counts in $COUNTS) with `String * Num`. The repetition doubles the string,
+# so the number of executed instructions has to grow with the logarithm of
+# the count. Reports the length of the result, the wall time and the number
+# of executed instructions (see bench_common.sh).
+#
+# Usage: ./bench_repetition.sh [compiler options, e.g. -O1 --codegen=regs]
+
+set -u
+
+read -r -a COUNTS <<< "${COUNTS:-1000 100000 1000000}"
+
+source "$(dirname "$0")/bench_common.sh"
+
+# The count is read at run time, otherwise the repetition is folded
+cat > "${TMP_DIR}/source.wren" << EOF
+import "ifj25" for Ifj
+class Program {
+    static main() {
+        var n = Ifj.read_num()
+        var s = "a" * n
+        Ifj.write(Ifj.length(s))
+        Ifj.write("\n")
+    }
+}
+EOF
+
+code="${TMP_DIR}/source.code"
+if ! bench_compile "${TMP_DIR}/source.wren" "${code}" "$@"; then
+	echo "${RED}compilation failed${RESET}" >&2
+	exit 1
+fi
+
+printf "${BOLD}%-10s %-6s %10s %14s${RESET}\n" "count" "result" "time [s]" "executed"
+failures=0
+for count in "${COUNTS[@]}"; do
+	echo "${count}" > "${TMP_DIR}/in"
+	bench_run "${code}" "${TMP_DIR}/in" "${TMP_DIR}/out"
+	output="$(head -n 1 "${TMP_DIR}/out")"
+
+	result="${GREEN}ok${RESET}"
+	if [[ ${BENCH_STATUS} -ne 0 || "${output}" != "${count}" ]]; then
+		result="${RED}FAIL${RESET}"
+		((failures++))
+	fi
+	printf "%-10s %-6s %10.2f %14s\n" "${count}" "${result}" "${BENCH_SECONDS}" \
+		"${BENCH_EXECUTED:-?}"
+done
+
+if (( failures > 0 )); then
+	printf "${RED}%d runs failed${RESET}\n" "${failures}"
+	exit 1
+fi
+exit 0
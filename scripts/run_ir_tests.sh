@@ -0,0 +1,71 @@
+#!/usr/bin/env bash
+# Round-trips every compilable test program through the binary IR format.
+# Each program is compiled with --emit-ir, the IR is re-emitted with --load-ir
+# and both IFJcode25 listings must be byte-identical.
+
+set -u
+
+PROJECT_BIN="../ifj25"
+TEST_DIRS=("../tests/simple" "../tests/examples" "../tests/bonus" "../tests/advanced/sem_tests")
+
+# simple ANSI colors (disabled when stdout is not a TTY)
+if [[ -t 1 ]]; then
+	GREEN=$'\033[32m'
+	RED=$'\033[31m'
+	YELLOW=$'\033[33m'
+	BOLD=$'\033[1m'
+	RESET=$'\033[0m'
+else
+	GREEN=""
+	RED=""
+	YELLOW=""
+	BOLD=""
+	RESET=""
+fi
+
+if [[ ! -x "${PROJECT_BIN}" ]]; then
+	echo "Binary ${PROJECT_BIN} not found or not executable. Run 'make' first." >&2
+	exit 1
+fi
+
+TMP_DIR="$(mktemp -d)"
+trap 'rm -rf "${TMP_DIR}"' EXIT
+
+total=0
+passed=0
+failed=0
+skipped=0
+
+printf "${BOLD}Running IR round-trip tests${RESET}\n\n"
+
+while IFS= read -r -d '' file; do
+	((total++))
+	name="${file#../tests/}"
+
+	if ! "${PROJECT_BIN}" --emit-ir "${TMP_DIR}/program.ir" < "${file}" > "${TMP_DIR}/direct.out" 2>/dev/null; then
+		printf "${YELLOW}[SKIP]${RESET} %-50s reason: does not compile\n" "${name}"
+		((skipped++))
+		continue
+	fi
+
+	if "${PROJECT_BIN}" --load-ir "${TMP_DIR}/program.ir" > "${TMP_DIR}/reloaded.out" 2>/dev/null &&
+		cmp -s "${TMP_DIR}/direct.out" "${TMP_DIR}/reloaded.out"; then
+		printf "${GREEN}[PASS]${RESET} %s\n" "${name}"
+		((passed++))
+	else
+		printf "${RED}[FAIL]${RESET} %s\n" "${name}"
+		((failed++))
+	fi
+done < <(find "${TEST_DIRS[@]}" \( -name 'source.wren' -o -name '*_0.txt' \) -print0 | sort -z)
+
+summary_color="${GREEN}"
+fail_color="${RED}"
+(( failed > 0 )) && summary_color="${RED}"
+(( failed == 0 )) && fail_color="${GREEN}"
+skip_color="${YELLOW}"
+
+printf "\n${summary_color}Summary:${RESET} %d total | ${GREEN}%d passed${RESET} | ${fail_color}%d failed${RESET} | ${skip_color}%d skipped${RESET}\n" \
+	"${total}" "${passed}" "${failed}" "${skipped}"
+
+(( failed == 0 )) || exit 1
+exit 0
@@ -115,8 +115,14 @@ run_test() {
 
     mkdir -p "$(dirname "$compiled_code_file_for_test")" # Ensure temp dir for compiled code exists
 
+    # Optional compiler options of the test, e.g. an optimization level
+    local compiler_flags=()
+    if [ -f "$test_base_dir/compiler_flags.txt" ]; then
+        read -r -a compiler_flags < "$test_base_dir/compiler_flags.txt"
+    fi
+
     # Compile source.wren once for the entire test case
-    if ! "$IFJ25_BIN" "$source_wren_file" > "$compiled_code_file_for_test" 2>&1; then
+    if ! "$IFJ25_BIN" "${compiler_flags[@]}" "$source_wren_file" > "$compiled_code_file_for_test" 2>&1; then
         local exit_code=$?
         echo -e "${RED}FAIL: $test_name - ifj25 compilation failed.${NC}"
         cat "$compiled_code_file_for_test"
@@ -3,6 +3,7 @@
 
 #include "3AC.h"
 #include "helper.h"
+#include "timing.h"
 
 void list_init(tThreeACList *list)
 {
@@ -126,6 +127,7 @@ void list_InsertFirst(tThreeACList *list, tOperationType opType, tOperand *resul
     newNode->arg2 = arg2;
     newNode->result = result;
     newNode->prev = NULL;
+    newNode->next = NULL;
     list->head = newNode;
     list->tail = newNode;
     list->active = newNode;
@@ -263,6 +265,133 @@ void list_add_global_def(tThreeACList *list, tOperationType op, tOperand *result
     list->globalDefTail = newNode;
 }
 
+// Unlinks and frees one instruction, its operands are left alone because they may be shared.
+// The active element moves to the previous instruction.
+void list_remove(tThreeACList *list, tInstructionNode *node)
+{
+    if (node->prev)
+    {
+        node->prev->next = node->next;
+    }
+    else
+    {
+        list->head = node->next;
+    }
+    if (node->next)
+    {
+        node->next->prev = node->prev;
+    }
+    else
+    {
+        list->tail = node->prev;
+    }
+    if (list->active == node)
+    {
+        list->active = node->prev;
+    }
+    list->length--;
+    free(node);
+}
+
+// Moves the instructions from first to last right behind after, keeping their order.
+// The range must not contain after.
+void list_move_after(tThreeACList *list, tInstructionNode *first, tInstructionNode *last,
+                     tInstructionNode *after)
+{
+    if (first->prev)
+    {
+        first->prev->next = last->next;
+    }
+    else
+    {
+        list->head = last->next;
+    }
+    if (last->next)
+    {
+        last->next->prev = first->prev;
+    }
+    else
+    {
+        list->tail = first->prev;
+    }
+
+    last->next = after->next;
+    if (after->next)
+    {
+        after->next->prev = last;
+    }
+    else
+    {
+        list->tail = last;
+    }
+    after->next = first;
+    first->prev = after;
+}
+
+// Moves every local DEFVAR emitted after hoistPoint right behind it, keeping their order.
+// Runs once per function, so each instruction is visited exactly once.
+void list_hoist_defvars(tThreeACList *list, tInstructionNode *hoistPoint)
+{
+    TIMING_BEGIN(PHASE_HOIST);
+
+    tInstructionNode *end = list->active;
+    tInstructionNode *lastKept = NULL;
+    tInstructionNode *current = hoistPoint ? hoistPoint->next : list->head;
+    bool done = (current == NULL || hoistPoint == end);
+
+    while (!done)
+    {
+        tInstructionNode *next = current->next;
+        done = (current == end || next == NULL);
+
+        if (current->opType == OP_DEFVAR &&
+            (current->result->type == OPP_VAR || current->result->type == OPP_TEMP))
+        {
+            if (current != (hoistPoint ? hoistPoint->next : list->head))
+            {
+                // Unlink from the current position
+                current->prev->next = current->next;
+                if (current->next)
+                {
+                    current->next->prev = current->prev;
+                }
+                else
+                {
+                    list->tail = current->prev;
+                }
+
+                // Insert after hoistPoint
+                if (hoistPoint)
+                {
+                    current->next = hoistPoint->next;
+                    hoistPoint->next->prev = current;
+                    hoistPoint->next = current;
+                    current->prev = hoistPoint;
+                }
+                else
+                {
+                    current->next = list->head;
+                    list->head->prev = current;
+                    list->head = current;
+                    current->prev = NULL;
+                }
+            }
+            hoistPoint = current;
+        }
+        else
+        {
+            lastKept = current;
+        }
+
+        current = next;
+    }
+
+    // Emission continues after the last instruction that stayed in place
+    list->active = lastKept ? lastKept : hoistPoint;
+
+    TIMING_END(PHASE_HOIST);
+}
+
 const char *operation_to_string(tOperationType op)
 {
     switch (op)
@@ -672,6 +801,7 @@ void emit_comment(const char *text, tThreeACList *list)
 
 void emit(tOperationType op, tOperand *result, tOperand *arg1, tOperand *arg2, tThreeACList *list)
 {
+    TIMING_BEGIN(PHASE_CODEGEN);
     if (list_isActive(list))
     {
         list_InsertAfter(list, op, result, arg1, arg2);
@@ -685,4 +815,5 @@ void emit(tOperationType op, tOperand *result, tOperand *arg1, tOperand *arg2, t
         list_last(list);
         list_InsertAfter(list, op, result, arg1, arg2);
     }
+    TIMING_END(PHASE_CODEGEN);
 }
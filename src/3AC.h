@@ -168,6 +168,10 @@ void list_InsertFirst(tThreeACList *list, tOperationType opType, tOperand *resul
                       tOperand *arg2);
 void list_add_global_def(tThreeACList *list, tOperationType op, tOperand *result, tOperand *arg1,
                          tOperand *arg2);
+void list_remove(tThreeACList *list, tInstructionNode *node);
+void list_move_after(tThreeACList *list, tInstructionNode *first, tInstructionNode *last,
+                     tInstructionNode *after);
+void list_hoist_defvars(tThreeACList *list, tInstructionNode *hoistPoint);
 
 void emit(tOperationType op, tOperand *result, tOperand *arg1, tOperand *arg2, tThreeACList *list);
 void emit_comment(const char *text, tThreeACList *list);
@@ -9,6 +9,185 @@
 #include "scanner.h"
 #include "symtable.h"
 
+tCodegenMode codegenMode = CODEGEN_STACK;
+bool sharedHelpers = false;
+
+// Patterns that -Os emits once as a subroutine
+typedef enum
+{
+    HELPER_ADD,
+    HELPER_MULT,
+    HELPER_SUB,
+    HELPER_DIV,
+    HELPER_LT,
+    HELPER_GT,
+    HELPER_LTE,
+    HELPER_GTE,
+    HELPER_EQ,
+    HELPER_NEQ,
+    HELPER_WRITE,
+    HELPER_READ_NUM,
+    HELPER_STRCMP,
+    HELPER_ORD,
+    HELPER_FLOOR,
+    HELPER_STR,
+    HELPER_LENGTH,
+    HELPER_SUBSTRING,
+    HELPER_CHR,
+    HELPER_COUNT
+} tHelper;
+
+static const char *helperLabels[HELPER_COUNT] = {
+    "add%helper",   "mult%helper",     "sub%helper",    "div%helper",       "lt%helper",
+    "gt%helper",    "lte%helper",      "gte%helper",    "eq%helper",        "neq%helper",
+    "write%helper", "read_num%helper", "strcmp%helper", "ord%helper",       "floor%helper",
+    "str%helper",   "length%helper",   "substring%helper", "chr%helper"};
+
+static bool helperUsed[HELPER_COUNT];
+
+// Cold blocks of the function being generated, as pairs of their first and last instruction
+static tInstructionNode **coldBlocks = NULL;
+static int coldBlockCount = 0;
+static int coldBlockCapacity = 0;
+
+// Set while the body of a helper is generated, the pattern is then emitted inline
+static bool inHelper = false;
+
+// Calls the shared copy of a pattern whose operands are on the data stack,
+// false if the pattern has to be emitted inline
+static bool generate_helper_call(tHelper helper)
+{
+    if (!sharedHelpers || inHelper || helper == HELPER_COUNT)
+    {
+        return false;
+    }
+
+    helperUsed[helper] = true;
+    emit(OP_CALL, create_operand_from_label(helperLabels[helper]), NULL, NULL, &threeACcode);
+    return true;
+}
+
+// Register-style call of a helper, the operands are passed and the result returned on the stack
+static bool generate_helper_call_regs(tHelper helper, tOperand *result, tOperand *op1,
+                                      tOperand *op2)
+{
+    if (!sharedHelpers || inHelper || helper == HELPER_COUNT)
+    {
+        return false;
+    }
+
+    emit(OP_PUSHS, op1, NULL, NULL, &threeACcode);
+    emit(OP_PUSHS, op2, NULL, NULL, &threeACcode);
+    generate_helper_call(helper);
+    emit(OP_POPS, result, NULL, NULL, &threeACcode);
+    return true;
+}
+
+// Helper of a subtraction, division or comparison operator, HELPER_COUNT for other operators
+static tHelper generate_operator_helper(char *op)
+{
+    static const struct
+    {
+        const char *op;
+        tHelper helper;
+    } operators[] = {{"-", HELPER_SUB}, {"/", HELPER_DIV}, {"<", HELPER_LT},   {">", HELPER_GT},
+                     {"<=", HELPER_LTE}, {">=", HELPER_GTE}, {"==", HELPER_EQ}, {"!=", HELPER_NEQ}};
+
+    for (size_t i = 0; i < sizeof(operators) / sizeof(operators[0]); i++)
+    {
+        if (strcmp(op, operators[i].op) == 0)
+        {
+            return operators[i].helper;
+        }
+    }
+    return HELPER_COUNT;
+}
+
+// Body of a helper, the pattern itself
+static void generate_helper_body(tHelper helper)
+{
+    static char *operators[] = {"-", "/", "<", ">", "<=", ">=", "==", "!="};
+
+    switch (helper)
+    {
+        case HELPER_ADD:
+            generate_add_op();
+            break;
+        case HELPER_MULT:
+            generate_mult_op();
+            break;
+        case HELPER_SUB:
+        case HELPER_DIV:
+            generate_numeric_op(operators[helper - HELPER_SUB]);
+            break;
+        case HELPER_LT:
+        case HELPER_GT:
+        case HELPER_LTE:
+        case HELPER_GTE:
+        case HELPER_EQ:
+        case HELPER_NEQ:
+            generate_relational_op(operators[helper - HELPER_SUB]);
+            break;
+        case HELPER_WRITE:
+            generate_ifj_write();
+            break;
+        case HELPER_READ_NUM:
+            generate_ifj_read_num();
+            break;
+        case HELPER_STRCMP:
+            generate_ifj_strcmp();
+            break;
+        case HELPER_ORD:
+            generate_ifj_ord();
+            break;
+        case HELPER_FLOOR:
+            generate_ifj_floor();
+            break;
+        case HELPER_STR:
+            generate_ifj_str();
+            break;
+        case HELPER_LENGTH:
+            generate_ifj_length();
+            break;
+        case HELPER_SUBSTRING:
+            generate_ifj_substring();
+            break;
+        case HELPER_CHR:
+            generate_ifj_chr();
+            break;
+        default:
+            break;
+    }
+}
+
+void generate_shared_helpers()
+{
+    for (int i = 0; i < HELPER_COUNT; i++)
+    {
+        if (!helperUsed[i])
+        {
+            continue;
+        }
+
+        emit(NO_OP, NULL, NULL, NULL, &threeACcode);
+        emit_comment("Shared helper", &threeACcode);
+        emit(OP_LABEL, create_operand_from_label(helperLabels[i]), NULL, NULL, &threeACcode);
+        emit(OP_CREATEFRAME, NULL, NULL, NULL, &threeACcode);
+        emit(OP_PUSHFRAME, NULL, NULL, NULL, &threeACcode);
+        tInstructionNode *prologueEnd = threeACcode.active;
+        threeACcode.tempCounter = 0;
+
+        inHelper = true;
+        generate_helper_body((tHelper)i);
+        inHelper = false;
+
+        emit(OP_POPFRAME, NULL, NULL, NULL, &threeACcode);
+        emit(OP_RETURN, NULL, NULL, NULL, &threeACcode);
+        generate_cold_blocks();
+        list_hoist_defvars(&threeACcode, prologueEnd);
+    }
+}
+
 void generate_program_entrypoint()
 {
     emit(NO_OP, NULL, NULL, NULL, &threeACcode);
@@ -33,6 +212,60 @@ void generate_program_entrypoint()
     emit(NO_OP, NULL, NULL, NULL, &threeACcode);
 }
 
+tInstructionNode *generate_function_prologue(const char *funcName, const char *label,
+                                             tSymTable *scope, char **paramNames, int paramCount)
+{
+    char *commentText = safeMalloc(strlen(funcName) + 25);
+    sprintf(commentText, "####################");
+    emit_comment(commentText, &threeACcode);
+    sprintf(commentText, "Function declaration: %s", funcName);
+    emit_comment(commentText, &threeACcode);
+    sprintf(commentText, "####################");
+    emit_comment(commentText, &threeACcode);
+    free(commentText);
+    emit(OP_LABEL, create_operand_from_label(label), NULL, NULL, &threeACcode);
+
+    tOperand *retvalDef = create_operand_from_variable("%retval", false);
+    emit(OP_DEFVAR, retvalDef, NULL, NULL, &threeACcode);
+    tOperand *retvalInit = create_operand_from_variable("%retval", false);
+    tOperand *nilOp = create_operand_from_constant_nil();
+    emit(OP_MOVE, retvalInit, nilOp, NULL, &threeACcode);
+
+    for (int i = 0; i < paramCount; i++)
+    {
+        tSymbolData *paramData = symtable_find(scope, paramNames[i]);
+        tOperand *paramOp = create_operand_from_variable(paramData->unique_name, false);
+        emit(OP_DEFVAR, paramOp, NULL, NULL, &threeACcode);
+    }
+
+    for (int i = 0; i < paramCount; i++)
+    {
+        char tempParamName[20];
+        sprintf(tempParamName, "%%param%d", i);
+
+        tSymbolData *paramData = symtable_find(scope, paramNames[i]);
+
+        tOperand *dest = create_operand_from_variable(paramData->unique_name, false);
+        tOperand *src = create_operand_from_variable(tempParamName, false);
+        emit(OP_MOVE, dest, src, NULL, &threeACcode);
+    }
+
+    emit(NO_OP, NULL, NULL, NULL, &threeACcode);
+    threeACcode.tempCounter = 0;
+    return threeACcode.active;
+}
+
+void generate_function_epilogue(tInstructionNode *prologueEnd)
+{
+    emit(OP_RETURN, NULL, NULL, NULL, &threeACcode);
+    generate_cold_blocks();
+    list_hoist_defvars(&threeACcode, prologueEnd);
+
+    // For space bettween instructions
+    emit(NO_OP, NULL, NULL, NULL, &threeACcode);
+    emit(NO_OP, NULL, NULL, NULL, &threeACcode);
+}
+
 void generate_return(FILE *file, tToken *currentToken, tSymTableStack *stack, bool isOneLine)
 {
     if (!isOneLine)
@@ -41,6 +274,7 @@ void generate_return(FILE *file, tToken *currentToken, tSymTableStack *stack, bo
     }
 
     parse_expression(file, currentToken, stack);
+    typeinfer_return(typeinfer_value(), typeinfer_value_callee());
     tOperand *retvalVar = create_operand_from_variable("%retval", false);
     emit(OP_POPS, retvalVar, NULL, NULL, &threeACcode);
     emit(OP_RETURN, NULL, NULL, NULL, &threeACcode);
@@ -48,6 +282,11 @@ void generate_return(FILE *file, tToken *currentToken, tSymTableStack *stack, bo
 
 tDataType generate_ifj_write()
 {
+    if (generate_helper_call(HELPER_WRITE))
+    {
+        return TYPE_NULL;
+    }
+
     emit(NO_OP, NULL, NULL, NULL, &threeACcode);
     emit_comment("Ifj.write call", &threeACcode);
 
@@ -92,6 +331,11 @@ tDataType generate_ifj_read_str()
 
 tDataType generate_ifj_read_num()
 {
+    if (generate_helper_call(HELPER_READ_NUM))
+    {
+        return TYPE_NUM;
+    }
+
     emit(NO_OP, NULL, NULL, NULL, &threeACcode);
     emit_comment("Ifj.read_num call", &threeACcode);
 
@@ -121,6 +365,11 @@ tDataType generate_ifj_read_num()
 
 tDataType generate_ifj_strcmp()
 {
+    if (generate_helper_call(HELPER_STRCMP))
+    {
+        return TYPE_NUM;
+    }
+
     emit(NO_OP, NULL, NULL, NULL, &threeACcode);
     emit_comment("Ifj.strcmp call", &threeACcode);
 
@@ -190,6 +439,11 @@ tDataType generate_ifj_strcmp()
 
 tDataType generate_ifj_ord()
 {
+    if (generate_helper_call(HELPER_ORD))
+    {
+        return TYPE_NUM;
+    }
+
     emit(NO_OP, NULL, NULL, NULL, &threeACcode);
     emit_comment("Ifj.ord call", &threeACcode);
 
@@ -282,6 +536,11 @@ tDataType generate_ifj_ord()
 
 tDataType generate_ifj_floor()
 {
+    if (generate_helper_call(HELPER_FLOOR))
+    {
+        return TYPE_NUM;
+    }
+
     emit(NO_OP, NULL, NULL, NULL, &threeACcode);
     emit_comment("Ifj.floor call", &threeACcode);
 
@@ -327,6 +586,11 @@ tDataType generate_ifj_floor()
 
 tDataType generate_ifj_str()
 {
+    if (generate_helper_call(HELPER_STR))
+    {
+        return TYPE_STRING;
+    }
+
     emit(NO_OP, NULL, NULL, NULL, &threeACcode);
     emit_comment("Ifj.str call", &threeACcode);
 
@@ -389,6 +653,11 @@ tDataType generate_ifj_str()
 
 tDataType generate_ifj_length()
 {
+    if (generate_helper_call(HELPER_LENGTH))
+    {
+        return TYPE_NUM;
+    }
+
     emit(NO_OP, NULL, NULL, NULL, &threeACcode);
     emit_comment("Ifj.length call", &threeACcode);
 
@@ -420,6 +689,11 @@ tDataType generate_ifj_length()
 
 tDataType generate_ifj_substring()
 {
+    if (generate_helper_call(HELPER_SUBSTRING))
+    {
+        return TYPE_STRING;
+    }
+
     emit(NO_OP, NULL, NULL, NULL, &threeACcode);
     emit_comment("Ifj.substring call", &threeACcode);
 
@@ -577,6 +851,11 @@ tDataType generate_ifj_substring()
 
 tDataType generate_ifj_chr()
 {
+    if (generate_helper_call(HELPER_CHR))
+    {
+        return TYPE_STRING;
+    }
+
     emit(NO_OP, NULL, NULL, NULL, &threeACcode);
     emit_comment("Ifj.chr call", &threeACcode);
 
@@ -664,23 +943,167 @@ void generate_truthiness_check(tOperand *expr_val)
     emit(OP_PUSHS, finalBoolResult, NULL, NULL, &threeACcode); // Push the final boolean result
 }
 
-void generate_add_op()
+// Arithmetic on two operands, without a result they are pushed and the stack form is used
+static void generate_arithmetic(tOperationType op, tOperand *result, tOperand *op1, tOperand *op2)
 {
-    tOperand *op2 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, op2, NULL, NULL, &threeACcode);
-    emit(OP_POPS, op2, NULL, NULL, &threeACcode);
+    if (result != NULL)
+    {
+        emit(op, result, op1, op2, &threeACcode);
+        return;
+    }
 
-    tOperand *op1 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, op1, NULL, NULL, &threeACcode);
-    emit(OP_POPS, op1, NULL, NULL, &threeACcode);
+    emit(OP_PUSHS, op1, NULL, NULL, &threeACcode);
+    emit(OP_PUSHS, op2, NULL, NULL, &threeACcode);
+    switch (op)
+    {
+        case OP_ADD:
+            emit(OP_ADDS, NULL, NULL, NULL, &threeACcode);
+            break;
+        case OP_SUB:
+            emit(OP_SUBS, NULL, NULL, NULL, &threeACcode);
+            break;
+        case OP_MUL:
+            emit(OP_MULS, NULL, NULL, NULL, &threeACcode);
+            break;
+        default:
+            emit(OP_DIVS, NULL, NULL, NULL, &threeACcode);
+            break;
+    }
+}
 
-    tOperand *type1 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, type1, NULL, NULL, &threeACcode);
-    emit(OP_TYPE, type1, op1, NULL, &threeACcode);
+// Comparison of two operands of the same type. Without a result the stack form is used,
+// NULL operands are already on the data stack
+static void generate_comparison(char *op, tOperand *result, tOperand *op1, tOperand *op2)
+{
+    tOperationType opType = OP_EQ;
+    bool useNot = false;
 
-    tOperand *type2 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, type2, NULL, NULL, &threeACcode);
-    emit(OP_TYPE, type2, op2, NULL, &threeACcode);
+    if (strcmp(op, "<") == 0)
+        opType = OP_LT;
+    else if (strcmp(op, ">") == 0)
+        opType = OP_GT;
+    else if (strcmp(op, "!=") == 0)
+        useNot = true;
+    else if (strcmp(op, "<=") == 0)
+    {
+        opType = OP_GT;
+        useNot = true;
+    }
+    else if (strcmp(op, ">=") == 0)
+    {
+        opType = OP_LT;
+        useNot = true;
+    }
+
+    if (result != NULL)
+    {
+        emit(opType, result, op1, op2, &threeACcode);
+        if (useNot)
+        {
+            emit(OP_NOT, result, result, NULL, &threeACcode);
+        }
+        return;
+    }
+
+    if (op1 != NULL)
+    {
+        emit(OP_PUSHS, op1, NULL, NULL, &threeACcode);
+        emit(OP_PUSHS, op2, NULL, NULL, &threeACcode);
+    }
+    emit(opType == OP_LT ? OP_LTS : opType == OP_GT ? OP_GTS : OP_EQS, NULL, NULL, NULL,
+         &threeACcode);
+    if (useNot)
+    {
+        emit(OP_NOTS, NULL, NULL, NULL, &threeACcode);
+    }
+}
+
+// Pops the two operands of a generic operator into new temporaries
+static void generate_pop_operands(tOperand **op1, tOperand **op2)
+{
+    *op2 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+    emit(OP_DEFVAR, *op2, NULL, NULL, &threeACcode);
+    emit(OP_POPS, *op2, NULL, NULL, &threeACcode);
+
+    *op1 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+    emit(OP_DEFVAR, *op1, NULL, NULL, &threeACcode);
+    emit(OP_POPS, *op1, NULL, NULL, &threeACcode);
+}
+
+// Fast path of an arithmetic operator for two ints or two floats. The other types are left
+// to the full dispatch in a cold block, which starts at the returned label
+static tOperand *generate_fast_arithmetic(tOperationType op, tOperand *result, tOperand *op1,
+                                          tOperand *op2, tOperand **type1, tOperand **type2)
+{
+    *type1 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+    emit(OP_DEFVAR, *type1, NULL, NULL, &threeACcode);
+    emit(OP_TYPE, *type1, op1, NULL, &threeACcode);
+
+    *type2 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+    emit(OP_DEFVAR, *type2, NULL, NULL, &threeACcode);
+    emit(OP_TYPE, *type2, op2, NULL, &threeACcode);
+
+    tOperand *coldLabel = create_operand_from_label(threeAC_create_label(&threeACcode));
+    tOperand *floatLabel = create_operand_from_label(threeAC_create_label(&threeACcode));
+
+    emit(OP_JUMPIFNEQ, coldLabel, *type1, *type2, &threeACcode);
+    emit(OP_JUMPIFEQ, floatLabel, *type1, create_operand_from_constant_string("float"),
+         &threeACcode);
+    emit(OP_JUMPIFNEQ, coldLabel, *type1, create_operand_from_constant_string("int"),
+         &threeACcode);
+    emit(OP_INT2FLOAT, op1, op1, NULL, &threeACcode);
+    emit(OP_INT2FLOAT, op2, op2, NULL, &threeACcode);
+    emit(OP_LABEL, floatLabel, NULL, NULL, &threeACcode);
+    generate_arithmetic(op, result, op1, op2);
+
+    return coldLabel;
+}
+
+// Starts a cold block, it stays in place until generate_cold_blocks() moves it
+static void generate_cold_begin(tOperand *coldLabel)
+{
+    if (coldBlockCount + 2 > coldBlockCapacity)
+    {
+        coldBlockCapacity = coldBlockCapacity == 0 ? 16 : 2 * coldBlockCapacity;
+        coldBlocks = safeRealloc(coldBlocks, sizeof(tInstructionNode *) * coldBlockCapacity);
+    }
+
+    emit(OP_LABEL, coldLabel, NULL, NULL, &threeACcode);
+    coldBlocks[coldBlockCount++] = threeACcode.active;
+}
+
+// Ends a cold block by jumping back behind its fast path
+static void generate_cold_end()
+{
+    tOperand *endLabel = create_operand_from_label(threeAC_create_label(&threeACcode));
+    emit(OP_JUMP, endLabel, NULL, NULL, &threeACcode);
+    coldBlocks[coldBlockCount++] = threeACcode.active;
+    emit(OP_LABEL, endLabel, NULL, NULL, &threeACcode);
+}
+
+void generate_cold_blocks()
+{
+    tOperationType last = threeACcode.active->opType;
+    if (coldBlockCount > 0 && last != OP_RETURN && last != OP_JUMP && last != OP_EXIT)
+    {
+        // Never fall through into the cold blocks
+        emit(OP_RETURN, NULL, NULL, NULL, &threeACcode);
+    }
+
+    for (int i = 0; i < coldBlockCount; i += 2)
+    {
+        list_move_after(&threeACcode, coldBlocks[i], coldBlocks[i + 1], threeACcode.active);
+        threeACcode.active = coldBlocks[i + 1];
+    }
+    coldBlockCount = 0;
+}
+
+// Addition with run-time type dispatch, without a result the sum is pushed
+static void generate_add_values(tOperand *result, tOperand *op1, tOperand *op2)
+{
+    tOperand *type1;
+    tOperand *type2;
+    generate_cold_begin(generate_fast_arithmetic(OP_ADD, result, op1, op2, &type1, &type2));
 
     tOperand *endAddLabel = create_operand_from_label(threeAC_create_label(&threeACcode));
 
@@ -699,10 +1122,18 @@ void generate_add_op()
     emit(OP_PUSHS, create_operand_from_constant_bool(true), NULL, NULL, &threeACcode);
     emit(OP_JUMPIFNEQS, numAddLabelCheck, NULL, NULL, &threeACcode);
 
-    tOperand *resultStr = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, resultStr, NULL, NULL, &threeACcode);
-    emit(OP_CONCAT, resultStr, op1, op2, &threeACcode);
-    emit(OP_PUSHS, resultStr, NULL, NULL, &threeACcode);
+    if (result == NULL)
+    {
+        tOperand *resultStr =
+            create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+        emit(OP_DEFVAR, resultStr, NULL, NULL, &threeACcode);
+        emit(OP_CONCAT, resultStr, op1, op2, &threeACcode);
+        emit(OP_PUSHS, resultStr, NULL, NULL, &threeACcode);
+    }
+    else
+    {
+        emit(OP_CONCAT, result, op1, op2, &threeACcode);
+    }
     emit(OP_JUMP, endAddLabel, NULL, NULL, &threeACcode);
 
     emit(OP_LABEL, numAddLabelCheck, NULL, NULL, &threeACcode);
@@ -733,9 +1164,7 @@ void generate_add_op()
 
     emit(OP_LABEL, numAddLabelType, NULL, NULL, &threeACcode);
 
-    emit(OP_PUSHS, op1, NULL, NULL, &threeACcode);
-    emit(OP_PUSHS, op2, NULL, NULL, &threeACcode);
-    emit(OP_ADDS, NULL, NULL, NULL, &threeACcode);
+    generate_arithmetic(OP_ADD, result, op1, op2);
 
     emit(OP_JUMP, endAddLabel, NULL, NULL, &threeACcode);
 
@@ -744,25 +1173,79 @@ void generate_add_op()
          &threeACcode);
 
     emit(OP_LABEL, endAddLabel, NULL, NULL, &threeACcode);
+    generate_cold_end();
 }
 
-void generate_mult_op()
+void generate_add_op()
 {
-    tOperand *op2 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, op2, NULL, NULL, &threeACcode);
-    emit(OP_POPS, op2, NULL, NULL, &threeACcode);
+    if (generate_helper_call(HELPER_ADD))
+    {
+        return;
+    }
 
-    tOperand *op1 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, op1, NULL, NULL, &threeACcode);
-    emit(OP_POPS, op1, NULL, NULL, &threeACcode);
+    tOperand *op1;
+    tOperand *op2;
+    generate_pop_operands(&op1, &op2);
+    generate_add_values(NULL, op1, op2);
+}
 
-    tOperand *type1 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, type1, NULL, NULL, &threeACcode);
-    emit(OP_TYPE, type1, op1, NULL, &threeACcode);
+void generate_add_op_regs(tOperand *result, tOperand *op1, tOperand *op2)
+{
+    if (generate_helper_call_regs(HELPER_ADD, result, op1, op2))
+    {
+        return;
+    }
+    generate_add_values(result, op1, op2);
+}
 
-    tOperand *type2 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, type2, NULL, NULL, &threeACcode);
-    emit(OP_TYPE, type2, op2, NULL, &threeACcode);
+// Concatenates count copies of str into resultStr by doubling: every bit of
+// count appends the matching power of str, O(log count) CONCATs in total.
+// count is halved down to zero.
+static void generate_repetition_loop(tOperand *resultStr, tOperand *str, tOperand *count)
+{
+    tOperand *piece = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+    tOperand *half = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+    tOperand *even = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+    tOperand *condition = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+    emit(OP_DEFVAR, piece, NULL, NULL, &threeACcode);
+    emit(OP_DEFVAR, half, NULL, NULL, &threeACcode);
+    emit(OP_DEFVAR, even, NULL, NULL, &threeACcode);
+    emit(OP_DEFVAR, condition, NULL, NULL, &threeACcode);
+
+    // str first, resultStr may be the same variable
+    emit(OP_MOVE, piece, str, NULL, &threeACcode);
+    emit(OP_MOVE, resultStr, create_operand_from_constant_string(""), NULL, &threeACcode);
+
+    tOperand *loopStart = create_operand_from_label(threeAC_create_label(&threeACcode));
+    tOperand *loopEnd = create_operand_from_label(threeAC_create_label(&threeACcode));
+    tOperand *bitClear = create_operand_from_label(threeAC_create_label(&threeACcode));
+
+    emit(OP_LABEL, loopStart, NULL, NULL, &threeACcode);
+    emit(OP_GT, condition, count, create_operand_from_constant_int(0), &threeACcode);
+    emit(OP_JUMPIFNEQ, loopEnd, condition, create_operand_from_constant_bool(true), &threeACcode);
+
+    emit(OP_IDIV, half, count, create_operand_from_constant_int(2), &threeACcode);
+    emit(OP_MUL, even, half, create_operand_from_constant_int(2), &threeACcode);
+    emit(OP_JUMPIFEQ, bitClear, even, count, &threeACcode);
+    emit(OP_CONCAT, resultStr, resultStr, piece, &threeACcode);
+    emit(OP_LABEL, bitClear, NULL, NULL, &threeACcode);
+
+    // No doubling after the highest bit
+    emit(OP_MOVE, count, half, NULL, &threeACcode);
+    emit(OP_JUMPIFEQ, loopEnd, count, create_operand_from_constant_int(0), &threeACcode);
+    emit(OP_CONCAT, piece, piece, piece, &threeACcode);
+    emit(OP_JUMP, loopStart, NULL, NULL, &threeACcode);
+
+    emit(OP_LABEL, loopEnd, NULL, NULL, &threeACcode);
+}
+
+// Multiplication and string repetition with run-time type dispatch,
+// without a result the product is pushed
+static void generate_mult_values(tOperand *result, tOperand *op1, tOperand *op2)
+{
+    tOperand *type1;
+    tOperand *type2;
+    generate_cold_begin(generate_fast_arithmetic(OP_MUL, result, op1, op2, &type1, &type2));
 
     tOperand *endMultLabel = create_operand_from_label(threeAC_create_label(&threeACcode));
     tOperand *numMultLabelCheck = create_operand_from_label(threeAC_create_label(&threeACcode));
@@ -821,28 +1304,17 @@ void generate_mult_op()
 
     emit(OP_LABEL, op2IsIntLabel, NULL, NULL, &threeACcode);
 
-    tOperand *resultStr = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, resultStr, NULL, NULL, &threeACcode);
-    emit(OP_MOVE, resultStr, create_operand_from_constant_string(""), NULL, &threeACcode);
-
-    tOperand *loopStart = create_operand_from_label(threeAC_create_label(&threeACcode));
-    tOperand *loopEnd = create_operand_from_label(threeAC_create_label(&threeACcode));
-    tOperand *condition = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-
-    emit(OP_DEFVAR, condition, NULL, NULL, &threeACcode);
-
-    emit(OP_LABEL, loopStart, NULL, NULL, &threeACcode);
-
-    emit(OP_GT, condition, op2, create_operand_from_constant_int(0), &threeACcode);
-    emit(OP_JUMPIFNEQ, loopEnd, condition, create_operand_from_constant_bool(true), &threeACcode);
-
-    emit(OP_CONCAT, resultStr, resultStr, op1, &threeACcode);
-
-    emit(OP_SUB, op2, op2, create_operand_from_constant_int(1), &threeACcode);
-    emit(OP_JUMP, loopStart, NULL, NULL, &threeACcode);
-
-    emit(OP_LABEL, loopEnd, NULL, NULL, &threeACcode);
-    emit(OP_PUSHS, resultStr, NULL, NULL, &threeACcode);
+    tOperand *resultStr = result;
+    if (result == NULL)
+    {
+        resultStr = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+        emit(OP_DEFVAR, resultStr, NULL, NULL, &threeACcode);
+    }
+    generate_repetition_loop(resultStr, op1, op2);
+    if (result == NULL)
+    {
+        emit(OP_PUSHS, resultStr, NULL, NULL, &threeACcode);
+    }
 
     emit(OP_JUMP, endMultLabel, NULL, NULL, &threeACcode);
 
@@ -874,9 +1346,7 @@ void generate_mult_op()
 
     emit(OP_LABEL, numMultLabelType, NULL, NULL, &threeACcode);
 
-    emit(OP_PUSHS, op1, NULL, NULL, &threeACcode);
-    emit(OP_PUSHS, op2, NULL, NULL, &threeACcode);
-    emit(OP_MULS, NULL, NULL, NULL, &threeACcode);
+    generate_arithmetic(OP_MUL, result, op1, op2);
 
     emit(OP_JUMP, endMultLabel, NULL, NULL, &threeACcode);
 
@@ -885,25 +1355,38 @@ void generate_mult_op()
          &threeACcode);
 
     emit(OP_LABEL, endMultLabel, NULL, NULL, &threeACcode);
+    generate_cold_end();
 }
 
-void generate_numeric_op(char *op)
+void generate_mult_op()
 {
-    tOperand *op2 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, op2, NULL, NULL, &threeACcode);
-    emit(OP_POPS, op2, NULL, NULL, &threeACcode);
+    if (generate_helper_call(HELPER_MULT))
+    {
+        return;
+    }
 
-    tOperand *op1 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, op1, NULL, NULL, &threeACcode);
-    emit(OP_POPS, op1, NULL, NULL, &threeACcode);
+    tOperand *op1;
+    tOperand *op2;
+    generate_pop_operands(&op1, &op2);
+    generate_mult_values(NULL, op1, op2);
+}
 
-    tOperand *type1 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, type1, NULL, NULL, &threeACcode);
-    emit(OP_TYPE, type1, op1, NULL, &threeACcode);
+void generate_mult_op_regs(tOperand *result, tOperand *op1, tOperand *op2)
+{
+    if (generate_helper_call_regs(HELPER_MULT, result, op1, op2))
+    {
+        return;
+    }
+    generate_mult_values(result, op1, op2);
+}
 
-    tOperand *type2 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, type2, NULL, NULL, &threeACcode);
-    emit(OP_TYPE, type2, op2, NULL, &threeACcode);
+// Subtraction and division with run-time type checks, without a result the value is pushed
+static void generate_numeric_values(char *op, tOperand *result, tOperand *op1, tOperand *op2)
+{
+    tOperand *type1;
+    tOperand *type2;
+    tOperationType opType = strcmp(op, "-") == 0 ? OP_SUB : OP_DIV;
+    generate_cold_begin(generate_fast_arithmetic(opType, result, op1, op2, &type1, &type2));
 
     tOperand *typeErrorLabel = create_operand_from_label(threeAC_create_label(&threeACcode));
     tOperand *afterNumTypeCheckLabel =
@@ -956,37 +1439,35 @@ void generate_numeric_op(char *op)
     emit(OP_INT2FLOAT, op2, op2, NULL, &threeACcode);
     emit(OP_LABEL, op2OkLabel, NULL, NULL, &threeACcode);
 
-    emit(OP_PUSHS, op1, NULL, NULL, &threeACcode);
-    emit(OP_PUSHS, op2, NULL, NULL, &threeACcode);
+    generate_arithmetic(opType, result, op1, op2);
+    generate_cold_end();
+}
 
-    if (strcmp(op, "-") == 0)
-    {
-        emit(OP_SUBS, NULL, NULL, NULL, &threeACcode);
-    }
-    else if (strcmp(op, "/") == 0)
-    {
-        emit(OP_DIVS, NULL, NULL, NULL, &threeACcode);
-    }
-    else if (strcmp(op, "*") == 0)
+void generate_numeric_op(char *op)
+{
+    if (generate_helper_call(generate_operator_helper(op)))
     {
-        emit(OP_MULS, NULL, NULL, NULL, &threeACcode);
+        return;
     }
-    else if (strcmp(op, "+") == 0)
+
+    tOperand *op1;
+    tOperand *op2;
+    generate_pop_operands(&op1, &op2);
+    generate_numeric_values(op, NULL, op1, op2);
+}
+
+void generate_numeric_op_regs(char *op, tOperand *result, tOperand *op1, tOperand *op2)
+{
+    if (generate_helper_call_regs(generate_operator_helper(op), result, op1, op2))
     {
-        emit(OP_ADDS, NULL, NULL, NULL, &threeACcode);
+        return;
     }
+    generate_numeric_values(op, result, op1, op2);
 }
 
-void generate_relational_op(char *op)
+// Comparison with run-time type dispatch, without a result the bool is pushed
+static void generate_relational_values(char *op, tOperand *result, tOperand *op1, tOperand *op2)
 {
-    tOperand *op2 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, op2, NULL, NULL, &threeACcode);
-    emit(OP_POPS, op2, NULL, NULL, &threeACcode);
-
-    tOperand *op1 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, op1, NULL, NULL, &threeACcode);
-    emit(OP_POPS, op1, NULL, NULL, &threeACcode);
-
     tOperand *type1 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
     emit(OP_DEFVAR, type1, NULL, NULL, &threeACcode);
     emit(OP_TYPE, type1, op1, NULL, &threeACcode);
@@ -1059,50 +1540,327 @@ void generate_relational_op(char *op)
     tOperand *endRelOpLabel = create_operand_from_label(threeAC_create_label(&threeACcode));
 
     emit(OP_JUMPIFEQ, performOpLabelOnSameType, type1, type2, &threeACcode);
-    if (strcmp(op, "!=") == 0)
+    tOperand *differentTypes = create_operand_from_constant_bool(strcmp(op, "!=") == 0);
+    if (result == NULL)
     {
-        emit(OP_PUSHS, create_operand_from_constant_bool(true), NULL, NULL, &threeACcode);
+        emit(OP_PUSHS, differentTypes, NULL, NULL, &threeACcode);
     }
     else
     {
-        emit(OP_PUSHS, create_operand_from_constant_bool(false), NULL, NULL, &threeACcode);
+        emit(OP_MOVE, result, differentTypes, NULL, &threeACcode);
     }
 
     emit(OP_JUMP, endRelOpLabel, NULL, NULL, &threeACcode);
 
     emit(OP_LABEL, performOpLabelOnSameType, NULL, NULL, &threeACcode);
-    emit(OP_PUSHS, op1, NULL, NULL, &threeACcode);
+
+    generate_comparison(op, result, op1, op2);
+    emit(OP_LABEL, endRelOpLabel, NULL, NULL, &threeACcode);
+}
+
+void generate_relational_op(char *op)
+{
+    if (generate_helper_call(generate_operator_helper(op)))
+    {
+        return;
+    }
+
+    tOperand *op1;
+    tOperand *op2;
+    generate_pop_operands(&op1, &op2);
+    generate_relational_values(op, NULL, op1, op2);
+}
+
+void generate_relational_op_regs(char *op, tOperand *result, tOperand *op1, tOperand *op2)
+{
+    if (generate_helper_call_regs(generate_operator_helper(op), result, op1, op2))
+    {
+        return;
+    }
+    generate_relational_values(op, result, op1, op2);
+}
+
+// Converts a variable holding a number of the given type to float
+static void generate_var_to_float(tRtType type, tOperand *var)
+{
+    if (type == RT_INT)
+    {
+        emit(OP_INT2FLOAT, var, var, NULL, &threeACcode);
+    }
+    else if (type != RT_FLOAT)
+    {
+        tOperand *varType = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+        tOperand *isFloatLabel = create_operand_from_label(threeAC_create_label(&threeACcode));
+        emit(OP_DEFVAR, varType, NULL, NULL, &threeACcode);
+        emit(OP_TYPE, varType, var, NULL, &threeACcode);
+        emit(OP_JUMPIFNEQ, isFloatLabel, varType, create_operand_from_constant_string("int"),
+             &threeACcode);
+        emit(OP_INT2FLOAT, var, var, NULL, &threeACcode);
+        emit(OP_LABEL, isFloatLabel, NULL, NULL, &threeACcode);
+    }
+}
+
+// Converts the top of the data stack to float
+static void generate_top_to_float(tRtType type)
+{
+    if (type == RT_INT)
+    {
+        emit(OP_INT2FLOATS, NULL, NULL, NULL, &threeACcode);
+    }
+    else if (type != RT_FLOAT)
+    {
+        tOperand *top = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+        emit(OP_DEFVAR, top, NULL, NULL, &threeACcode);
+        emit(OP_POPS, top, NULL, NULL, &threeACcode);
+        generate_var_to_float(type, top);
+        emit(OP_PUSHS, top, NULL, NULL, &threeACcode);
+    }
+}
+
+// Converts both numeric operands on the data stack to float
+static void generate_operands_to_float(tRtType left, tRtType right)
+{
+    if (left == RT_FLOAT)
+    {
+        generate_top_to_float(right);
+        return;
+    }
+
+    tOperand *op2 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+    emit(OP_DEFVAR, op2, NULL, NULL, &threeACcode);
+    emit(OP_POPS, op2, NULL, NULL, &threeACcode);
+    generate_top_to_float(left);
+    generate_var_to_float(right, op2);
     emit(OP_PUSHS, op2, NULL, NULL, &threeACcode);
+}
 
-    tOperationType opType;
-    bool useNot = false;
+// String repetition with an int count, generate_mult_op() without the checks
+static void generate_typed_repetition()
+{
+    tOperand *count = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+    emit(OP_DEFVAR, count, NULL, NULL, &threeACcode);
+    emit(OP_POPS, count, NULL, NULL, &threeACcode);
 
-    if (strcmp(op, "<") == 0)
-        opType = OP_LTS;
-    else if (strcmp(op, ">") == 0)
-        opType = OP_GTS;
-    else if (strcmp(op, "==") == 0)
-        opType = OP_EQS;
-    else if (strcmp(op, "!=") == 0)
+    tOperand *str = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+    emit(OP_DEFVAR, str, NULL, NULL, &threeACcode);
+    emit(OP_POPS, str, NULL, NULL, &threeACcode);
+
+    tOperand *resultStr = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+    emit(OP_DEFVAR, resultStr, NULL, NULL, &threeACcode);
+    generate_repetition_loop(resultStr, str, count);
+    emit(OP_PUSHS, resultStr, NULL, NULL, &threeACcode);
+}
+
+bool generate_typed_binary_op(char *op, tRtType left, tRtType right)
+{
+    bool numeric = typeinfer_is(left, RT_NUM) && typeinfer_is(right, RT_NUM);
+    bool sameScalar = left == right && (left == RT_INT || left == RT_FLOAT || left == RT_STRING ||
+                                        left == RT_BOOL || left == RT_NIL);
+
+    if (strcmp(op, "+") == 0 && left == RT_STRING && right == RT_STRING)
     {
-        opType = OP_EQS;
-        useNot = true;
+        tOperand *op2 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+        emit(OP_DEFVAR, op2, NULL, NULL, &threeACcode);
+        emit(OP_POPS, op2, NULL, NULL, &threeACcode);
+
+        tOperand *op1 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+        emit(OP_DEFVAR, op1, NULL, NULL, &threeACcode);
+        emit(OP_POPS, op1, NULL, NULL, &threeACcode);
+
+        tOperand *resultStr =
+            create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+        emit(OP_DEFVAR, resultStr, NULL, NULL, &threeACcode);
+        emit(OP_CONCAT, resultStr, op1, op2, &threeACcode);
+        emit(OP_PUSHS, resultStr, NULL, NULL, &threeACcode);
+        return true;
     }
-    else if (strcmp(op, "<=") == 0)
+
+    if (strcmp(op, "*") == 0 && left == RT_STRING && right == RT_INT)
     {
-        opType = OP_GTS;
-        useNot = true;
+        generate_typed_repetition();
+        return true;
     }
-    else if (strcmp(op, ">=") == 0)
+
+    if (strcmp(op, "+") == 0 || strcmp(op, "-") == 0 || strcmp(op, "*") == 0 ||
+        strcmp(op, "/") == 0)
     {
-        opType = OP_LTS;
-        useNot = true;
+        if (!numeric)
+        {
+            return false;
+        }
+
+        generate_operands_to_float(left, right);
+        if (strcmp(op, "+") == 0)
+            emit(OP_ADDS, NULL, NULL, NULL, &threeACcode);
+        else if (strcmp(op, "-") == 0)
+            emit(OP_SUBS, NULL, NULL, NULL, &threeACcode);
+        else if (strcmp(op, "*") == 0)
+            emit(OP_MULS, NULL, NULL, NULL, &threeACcode);
+        else
+            emit(OP_DIVS, NULL, NULL, NULL, &threeACcode);
+        return true;
     }
 
-    emit(opType, NULL, NULL, NULL, &threeACcode);
-    if (useNot)
+    bool equality = strcmp(op, "==") == 0 || strcmp(op, "!=") == 0;
+    if (!numeric && !(equality && sameScalar))
     {
-        emit(OP_NOTS, NULL, NULL, NULL, &threeACcode);
+        return false;
     }
-    emit(OP_LABEL, endRelOpLabel, NULL, NULL, &threeACcode);
+
+    // Ints are compared directly, mixed numbers as floats like in generate_relational_op()
+    if (numeric && !sameScalar)
+    {
+        generate_operands_to_float(left, right);
+    }
+
+    generate_comparison(op, NULL, NULL, NULL);
+    return true;
+}
+
+// Value of a numeric operand as float, a new temporary unless it already is one
+static tOperand *generate_value_to_float(tRtType type, tOperand *value)
+{
+    if (type == RT_FLOAT)
+    {
+        return value;
+    }
+
+    tOperand *var = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+    emit(OP_DEFVAR, var, NULL, NULL, &threeACcode);
+    if (type == RT_INT)
+    {
+        emit(OP_INT2FLOAT, var, value, NULL, &threeACcode);
+    }
+    else
+    {
+        emit(OP_MOVE, var, value, NULL, &threeACcode);
+        generate_var_to_float(type, var);
+    }
+    return var;
+}
+
+bool generate_typed_binary_op_regs(char *op, tOperand *result, tOperand *left, tRtType leftType,
+                                   tOperand *right, tRtType rightType)
+{
+    bool numeric = typeinfer_is(leftType, RT_NUM) && typeinfer_is(rightType, RT_NUM);
+    bool sameScalar = leftType == rightType &&
+                      (leftType == RT_INT || leftType == RT_FLOAT || leftType == RT_STRING ||
+                       leftType == RT_BOOL || leftType == RT_NIL);
+
+    if (strcmp(op, "+") == 0 && leftType == RT_STRING && rightType == RT_STRING)
+    {
+        emit(OP_CONCAT, result, left, right, &threeACcode);
+        return true;
+    }
+
+    if (strcmp(op, "*") == 0 && leftType == RT_STRING && rightType == RT_INT)
+    {
+        tOperand *count = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+        emit(OP_DEFVAR, count, NULL, NULL, &threeACcode);
+        emit(OP_MOVE, count, right, NULL, &threeACcode);
+        generate_repetition_loop(result, left, count);
+        return true;
+    }
+
+    bool arithmetic = strcmp(op, "+") == 0 || strcmp(op, "-") == 0 || strcmp(op, "*") == 0 ||
+                      strcmp(op, "/") == 0;
+    bool equality = strcmp(op, "==") == 0 || strcmp(op, "!=") == 0;
+    if (!numeric && !(equality && sameScalar))
+    {
+        return false;
+    }
+
+    if (arithmetic || (numeric && !sameScalar))
+    {
+        left = generate_value_to_float(leftType, left);
+        right = generate_value_to_float(rightType, right);
+    }
+
+    if (strcmp(op, "+") == 0)
+        emit(OP_ADD, result, left, right, &threeACcode);
+    else if (strcmp(op, "-") == 0)
+        emit(OP_SUB, result, left, right, &threeACcode);
+    else if (strcmp(op, "*") == 0)
+        emit(OP_MUL, result, left, right, &threeACcode);
+    else if (strcmp(op, "/") == 0)
+        emit(OP_DIV, result, left, right, &threeACcode);
+    else
+        generate_comparison(op, result, left, right);
+    return true;
+}
+
+// Jumps to falseLabel when a value does not hold, fused with the EQ that computed it
+static void generate_value_jump(tOperand *falseLabel, tOperand *value, bool isBool)
+{
+    if (!isBool)
+    {
+        generate_truthiness_check(value);
+        value = threeACcode.active->result;
+        list_remove(&threeACcode, threeACcode.active);
+    }
+
+    tInstructionNode *last = threeACcode.active;
+    bool negated = false;
+    if (last != NULL && last->opType == OP_NOT && last->result == value && last->arg1 == value)
+    {
+        negated = true;
+        list_remove(&threeACcode, last);
+        last = threeACcode.active;
+    }
+
+    if (last != NULL && last->opType == OP_EQ && last->result == value)
+    {
+        tOperand *left = last->arg1;
+        tOperand *right = last->arg2;
+        list_remove(&threeACcode, last);
+        emit(negated ? OP_JUMPIFEQ : OP_JUMPIFNEQ, falseLabel, left, right, &threeACcode);
+        return;
+    }
+
+    emit(negated ? OP_JUMPIFEQ : OP_JUMPIFNEQ, falseLabel, value,
+         create_operand_from_constant_bool(true), &threeACcode);
+}
+
+void generate_condition_jump(tOperand *falseLabel, bool isBool)
+{
+    // A register-style expression pushes its value last, test it in place
+    if (codegenMode == CODEGEN_REGS && threeACcode.active != NULL &&
+        threeACcode.active->opType == OP_PUSHS)
+    {
+        tOperand *value = threeACcode.active->result;
+        list_remove(&threeACcode, threeACcode.active);
+        generate_value_jump(falseLabel, value, isBool);
+        return;
+    }
+
+    if (!isBool)
+    {
+        tOperand *exprVal = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+        emit(OP_DEFVAR, exprVal, NULL, NULL, &threeACcode);
+        emit(OP_POPS, exprVal, NULL, NULL, &threeACcode);
+        generate_truthiness_check(exprVal);
+        emit(OP_PUSHS, create_operand_from_constant_bool(false), NULL, NULL, &threeACcode);
+        emit(OP_JUMPIFEQS, falseLabel, NULL, NULL, &threeACcode);
+        return;
+    }
+
+    // The comparison that produced the bool is the last instruction, fuse it with the jump
+    tInstructionNode *last = threeACcode.active;
+    bool negated = false;
+    if (last != NULL && last->opType == OP_NOTS)
+    {
+        negated = true;
+        list_remove(&threeACcode, last);
+        last = threeACcode.active;
+    }
+
+    if (last != NULL && last->opType == OP_EQS)
+    {
+        list_remove(&threeACcode, last);
+        emit(negated ? OP_JUMPIFEQS : OP_JUMPIFNEQS, falseLabel, NULL, NULL, &threeACcode);
+        return;
+    }
+
+    emit(OP_PUSHS, create_operand_from_constant_bool(negated), NULL, NULL, &threeACcode);
+    emit(OP_JUMPIFEQS, falseLabel, NULL, NULL, &threeACcode);
 }
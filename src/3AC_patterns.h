@@ -3,9 +3,36 @@
 
 #include "3AC.h"
 #include "parser.h"
+#include "typeinfer.h"
+
+// How expressions are evaluated, selected by --codegen
+typedef enum
+{
+    CODEGEN_STACK, // Operands and results on the data stack
+    CODEGEN_REGS   // Three-address instructions on temporaries, only the final value is pushed
+} tCodegenMode;
+
+extern tCodegenMode codegenMode;
+
+// Generic operators and built-in calls become calls of shared subroutines (-Os)
+extern bool sharedHelpers;
 
 void generate_program_entrypoint();
 
+// Emits the subroutines of the patterns called with sharedHelpers, after the last function
+void generate_shared_helpers();
+
+// Moves the cold blocks of the generic operators behind the last instruction of the function
+void generate_cold_blocks();
+
+// Emits the label of a function, its result and the copies of its parameters, returns the
+// instruction the DEFVARs of the body are hoisted behind
+tInstructionNode *generate_function_prologue(const char *funcName, const char *label,
+                                             tSymTable *scope, char **paramNames, int paramCount);
+
+// Emits the return at the end of a function body and hoists its DEFVARs
+void generate_function_epilogue(tInstructionNode *prologueEnd);
+
 void generate_return(FILE *file, tToken *currentToken, tSymTableStack *stack, bool isOneLine);
 
 tDataType generate_ifj_write();
@@ -21,12 +48,27 @@ tDataType generate_ifj_chr();
 
 void generate_truthiness_check(tOperand *conditionResult);
 
+// Jumps to falseLabel when the condition on the data stack does not hold
+void generate_condition_jump(tOperand *falseLabel, bool isBool);
+
 void generate_numeric_op(char *op);
 void generate_mult_op();
 void generate_add_op();
 
 void generate_relational_op(char *op);
 
+// Operator on operands of statically known types, false if there is no such pattern
+bool generate_typed_binary_op(char *op, tRtType left, tRtType right);
+
 void generate_string_mult();
 
+// Register-style variants, the operator reads op1 and op2 and writes result.
+// The generic ones modify their operands, which have to be temporaries.
+void generate_numeric_op_regs(char *op, tOperand *result, tOperand *op1, tOperand *op2);
+void generate_mult_op_regs(tOperand *result, tOperand *op1, tOperand *op2);
+void generate_add_op_regs(tOperand *result, tOperand *op1, tOperand *op2);
+void generate_relational_op_regs(char *op, tOperand *result, tOperand *op1, tOperand *op2);
+bool generate_typed_binary_op_regs(char *op, tOperand *result, tOperand *left, tRtType leftType,
+                                   tOperand *right, tRtType rightType);
+
 #endif // IFJ_3AC_PATTERNS_H
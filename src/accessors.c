@@ -0,0 +1,566 @@
+/**
+ * @file accessors.c
+ *
+ * IFJ25 project
+ *
+ * Lowering of trivial getters and setters to direct global access (-O1).
+ *
+ * @author agent <agent@local>
+ */
+
+#include "accessors.h"
+#include "cfg.h"
+#include "helper.h"
+#include "stats.h"
+#include "strmap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Skips comments, empty lines and declarations of local variables.
+ *
+ * @param node The instruction to start at, may be NULL.
+ * @param end The instruction behind the range.
+ * @return The first other instruction, or end.
+ */
+static tInstructionNode *accessors_skip(tInstructionNode *node, tInstructionNode *end)
+{
+    while (node != end && (cfg_is_marker(node->opType) ||
+                           (node->opType == OP_DEFVAR && node->result->type == OPP_VAR)))
+    {
+        node = node->next;
+    }
+    return node;
+}
+
+/**
+ * Matches the copy of one value into another, either as MOVE or as PUSHS and POPS.
+ *
+ * @param node The first instruction of the copy.
+ * @param end The instruction behind the function.
+ * @param source Output for the copied operand.
+ * @param dest Output for the destination operand.
+ * @return The instruction behind the copy, or NULL if there is no copy.
+ */
+static tInstructionNode *accessors_match_copy(tInstructionNode *node, tInstructionNode *end,
+                                              const tOperand **source, const tOperand **dest)
+{
+    if (node == end)
+    {
+        return NULL;
+    }
+    if (node->opType == OP_MOVE)
+    {
+        *dest = node->result;
+        *source = node->arg1;
+        return accessors_skip(node->next, end);
+    }
+    if (node->opType != OP_PUSHS)
+    {
+        return NULL;
+    }
+    *source = node->result;
+    node = accessors_skip(node->next, end);
+    if (node == end || node->opType != OP_POPS)
+    {
+        return NULL;
+    }
+    *dest = node->result;
+    return accessors_skip(node->next, end);
+}
+
+/**
+ * Finds the global variable a trivial getter or setter accesses.
+ *
+ * A getter must be MOVE %retval nil, the copy of the global to %retval and
+ * RETURN. A setter must be MOVE %retval nil, the copy of %param0 to the
+ * parameter variable, the copy of that variable to the global and RETURN.
+ *
+ * @param first The label of the function.
+ * @param end The instruction behind the function.
+ * @param setter Whether the function is a setter.
+ * @return Name of the global variable, or NULL if the body does more.
+ */
+static const char *accessors_trivial_global(tInstructionNode *first, tInstructionNode *end,
+                                            bool setter)
+{
+    tInstructionNode *node = accessors_skip(first->next, end);
+    if (node == end || node->opType != OP_MOVE ||
+        !cfg_is_var(node->result, OPP_VAR, "%retval") || node->arg1->type != OPP_CONST_NIL)
+    {
+        return NULL;
+    }
+    node = accessors_skip(node->next, end);
+
+    const tOperand *source;
+    const tOperand *dest;
+    const char *param = NULL;
+    if (setter)
+    {
+        node = accessors_match_copy(node, end, &source, &dest);
+        if (node == NULL || !cfg_is_var(source, OPP_VAR, "%param0") ||
+            dest->type != OPP_VAR)
+        {
+            return NULL;
+        }
+        param = dest->value.varname;
+    }
+
+    node = accessors_match_copy(node, end, &source, &dest);
+    if (node == NULL || node == end || node->opType != OP_RETURN)
+    {
+        return NULL;
+    }
+    // The epilogue adds another RETURN behind a return statement
+    node = accessors_skip(node->next, end);
+    while (node != end && node->opType == OP_RETURN)
+    {
+        node = accessors_skip(node->next, end);
+    }
+    if (node != end)
+    {
+        return NULL;
+    }
+
+    if (setter)
+    {
+        return cfg_is_var(source, OPP_VAR, param) && dest->type == OPP_GLOBAL
+                   ? dest->value.varname
+                   : NULL;
+    }
+    return cfg_is_var(dest, OPP_VAR, "%retval") && source->type == OPP_GLOBAL
+               ? source->value.varname
+               : NULL;
+}
+
+/**
+ * The code that still runs with the frame of one call. It starts behind the
+ * POPFRAME and ends on every path at the next CREATEFRAME, CALL, RETURN or
+ * EXIT. A CALL ends it too, every callee leaves its own frame in TF (the
+ * shared -Os subroutines create one themselves).
+ */
+typedef struct
+{
+    tInstructionNode **reads; // Instructions that read TF@%retval
+    size_t readCount;
+    size_t readCapacity;
+    bool *entered; // Blocks the frame reaches at their first instruction
+    bool *flows;   // Entered blocks that keep the frame up to their end
+    bool *reaches; // Entered blocks from which a read of the frame is reachable
+} tAccessorsRegion;
+
+/**
+ * Appends an instruction to a growing array.
+ *
+ * @param nodes The array.
+ * @param count Number of instructions in the array.
+ * @param capacity Allocated size of the array.
+ * @param node The instruction.
+ */
+static void accessors_append(tInstructionNode ***nodes, size_t *count, size_t *capacity,
+                             tInstructionNode *node)
+{
+    if (*count == *capacity)
+    {
+        *capacity = *capacity == 0 ? 8 : *capacity * 2;
+        *nodes = safeRealloc(*nodes, sizeof(tInstructionNode *) * *capacity);
+    }
+    (*nodes)[(*count)++] = node;
+}
+
+/**
+ * Checks whether an operand is a variable of the temporary frame.
+ *
+ * @param operand The operand, may be NULL.
+ * @return true for TF variables.
+ */
+static bool accessors_in_frame(const tOperand *operand)
+{
+    return operand != NULL && operand->type == OPP_TF_VAR;
+}
+
+/**
+ * Scans the part of a block that runs with the frame and collects its reads.
+ *
+ * @param region The region.
+ * @param node The first instruction to scan.
+ * @param last The last instruction of the block.
+ * @param flows Output, whether the frame is kept up to the end of the block.
+ * @param reads Output, whether the part reads TF@%retval.
+ * @return false if the part uses the frame in another way than reading TF@%retval.
+ */
+static bool accessors_scan(tAccessorsRegion *region, tInstructionNode *node,
+                           const tInstructionNode *last, bool *flows, bool *reads)
+{
+    *flows = false;
+    *reads = false;
+    for (;; node = node->next)
+    {
+        tOperationType op = node->opType;
+        if (op == OP_CREATEFRAME || op == OP_CALL)
+        {
+            return true;
+        }
+        if (op == OP_PUSHFRAME || op == OP_POPFRAME)
+        {
+            return false;
+        }
+
+        bool inResult = accessors_in_frame(node->result);
+        if (inResult || accessors_in_frame(node->arg1) || accessors_in_frame(node->arg2))
+        {
+            // SETCHAR writes into its result, which must stay the copy in the frame
+            if ((inResult && (!cfg_reads_result(op) || op == OP_SETCHAR ||
+                              !cfg_is_var(node->result, OPP_TF_VAR, "%retval"))) ||
+                (accessors_in_frame(node->arg1) && !cfg_is_var(node->arg1, OPP_TF_VAR, "%retval")) ||
+                (accessors_in_frame(node->arg2) && !cfg_is_var(node->arg2, OPP_TF_VAR, "%retval")))
+            {
+                return false;
+            }
+            accessors_append(&region->reads, &region->readCount, &region->readCapacity, node);
+            *reads = true;
+        }
+
+        if (op == OP_RETURN || op == OP_EXIT)
+        {
+            return true;
+        }
+        if (node == last)
+        {
+            *flows = true;
+            return true;
+        }
+    }
+}
+
+/**
+ * Marks the successors of a block as entered and pushes them to the work stack.
+ *
+ * @param region The region.
+ * @param cfg Graph of the function.
+ * @param block The block.
+ * @param stack The work stack, with room for every block.
+ * @param top Number of blocks on the stack.
+ */
+static void accessors_enter_successors(tAccessorsRegion *region, const tCfg *cfg, int block,
+                                       int *stack, int *top)
+{
+    for (int i = 0; i < cfg->blocks[block].succCount; i++)
+    {
+        int succ = cfg->blocks[block].succ[i];
+        if (!region->entered[succ])
+        {
+            region->entered[succ] = true;
+            stack[(*top)++] = succ;
+        }
+    }
+}
+
+/**
+ * Finds the code that runs with the frame of a call, on every path.
+ *
+ * @param region Output for the region, free it with accessors_region_dispose().
+ * @param cfg Graph of the function.
+ * @param start The block of the call.
+ * @param popFrame The POPFRAME behind the call.
+ * @return false if the code uses the frame in another way than reading
+ *         TF@%retval, or if one of the reads can be reached from code that
+ *         does not run with the frame.
+ */
+static bool accessors_find_region(tAccessorsRegion *region, const tCfg *cfg, int start,
+                                  tInstructionNode *popFrame)
+{
+    region->reads = NULL;
+    region->readCount = 0;
+    region->readCapacity = 0;
+    region->entered = safeMalloc(sizeof(bool) * cfg->blockCount);
+    region->flows = safeMalloc(sizeof(bool) * cfg->blockCount);
+    region->reaches = safeMalloc(sizeof(bool) * cfg->blockCount);
+    for (int i = 0; i < cfg->blockCount; i++)
+    {
+        region->entered[i] = false;
+        region->flows[i] = false;
+        region->reaches[i] = false;
+    }
+
+    // The block of the call is scanned from the POPFRAME here, and from its
+    // first instruction only if a loop enters it again
+    bool startFlows = true;
+    bool startReads;
+    const tBasicBlock *startBlock = &cfg->blocks[start];
+    if (popFrame != startBlock->last &&
+        !accessors_scan(region, popFrame->next, startBlock->last, &startFlows, &startReads))
+    {
+        return false;
+    }
+
+    int *stack = safeMalloc(sizeof(int) * cfg->blockCount);
+    int top = 0;
+    if (startFlows)
+    {
+        accessors_enter_successors(region, cfg, start, stack, &top);
+    }
+    bool valid = true;
+    while (valid && top > 0)
+    {
+        int block = stack[--top];
+        valid = accessors_scan(region, cfg->blocks[block].first, cfg->blocks[block].last,
+                               &region->flows[block], &region->reaches[block]);
+        if (valid && region->flows[block])
+        {
+            accessors_enter_successors(region, cfg, block, stack, &top);
+        }
+    }
+    free(stack);
+    if (!valid)
+    {
+        return false;
+    }
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = 0; i < cfg->blockCount; i++)
+        {
+            for (int s = 0; region->flows[i] && !region->reaches[i] &&
+                            s < cfg->blocks[i].succCount;
+                 s++)
+            {
+                if (region->reaches[cfg->blocks[i].succ[s]])
+                {
+                    region->reaches[i] = true;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // A read behind a label that other code jumps to may belong to another frame
+    for (int i = 0; i < cfg->blockCount; i++)
+    {
+        if (!region->reaches[i])
+        {
+            continue;
+        }
+        if (i == 0)
+        {
+            return false;
+        }
+        for (int p = 0; p < cfg->blocks[i].predCount; p++)
+        {
+            int pred = cfg->blocks[i].preds[p];
+            if (!region->flows[pred] && !(pred == start && startFlows))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Frees a region found by accessors_find_region().
+ *
+ * @param region The region.
+ */
+static void accessors_region_dispose(tAccessorsRegion *region)
+{
+    free(region->reads);
+    free(region->entered);
+    free(region->flows);
+    free(region->reaches);
+}
+
+/**
+ * Replaces one getter call by reads of the global variable. Every read of
+ * TF@%retval that runs with the frame of the call is replaced.
+ *
+ * @param cfg Graph of the function.
+ * @param block The block of the call.
+ * @param call The CALL instruction.
+ * @param global Name of the global variable.
+ * @param removed Instructions to remove, the frame handling of the call is appended.
+ * @param removedCount Number of instructions to remove.
+ * @param removedCapacity Allocated size of removed.
+ * @return true if the call was replaced.
+ */
+static bool accessors_lower_get(const tCfg *cfg, int block, tInstructionNode *call,
+                                const char *global, tInstructionNode ***removed,
+                                size_t *removedCount, size_t *removedCapacity)
+{
+    tInstructionNode *pushFrame = call->prev;
+    tInstructionNode *createFrame = pushFrame != NULL ? pushFrame->prev : NULL;
+    tInstructionNode *popFrame = call->next;
+    if (pushFrame == NULL || pushFrame->opType != OP_PUSHFRAME || createFrame == NULL ||
+        createFrame->opType != OP_CREATEFRAME || popFrame == NULL ||
+        popFrame->opType != OP_POPFRAME)
+    {
+        return false;
+    }
+
+    tAccessorsRegion region;
+    bool lowered = accessors_find_region(&region, cfg, block, popFrame) && region.readCount > 0;
+    for (size_t i = 0; lowered && i < region.readCount; i++)
+    {
+        tInstructionNode *use = region.reads[i];
+        if (accessors_in_frame(use->result))
+        {
+            use->result = create_operand_from_variable(global, true);
+        }
+        if (accessors_in_frame(use->arg1))
+        {
+            use->arg1 = create_operand_from_variable(global, true);
+        }
+        if (accessors_in_frame(use->arg2))
+        {
+            use->arg2 = create_operand_from_variable(global, true);
+        }
+    }
+    accessors_region_dispose(&region);
+    if (!lowered)
+    {
+        return false;
+    }
+
+    accessors_append(removed, removedCount, removedCapacity, createFrame);
+    accessors_append(removed, removedCount, removedCapacity, pushFrame);
+    accessors_append(removed, removedCount, removedCapacity, call);
+    accessors_append(removed, removedCount, removedCapacity, popFrame);
+    return true;
+}
+
+/**
+ * Replaces one setter call by a write of the global variable.
+ *
+ * @param cfg Graph of the function.
+ * @param block The block of the call.
+ * @param call The CALL instruction.
+ * @param global Name of the global variable.
+ * @param removed Instructions to remove, the frame handling of the call is appended.
+ * @param removedCount Number of instructions to remove.
+ * @param removedCapacity Allocated size of removed.
+ * @return true if the call was replaced.
+ */
+static bool accessors_lower_set(const tCfg *cfg, int block, tInstructionNode *call,
+                                const char *global, tInstructionNode ***removed,
+                                size_t *removedCount, size_t *removedCapacity)
+{
+    tInstructionNode *pushFrame = call->prev;
+    tInstructionNode *store = pushFrame != NULL ? pushFrame->prev : NULL;
+    tInstructionNode *defvar = store != NULL ? store->prev : NULL;
+    tInstructionNode *createFrame = defvar != NULL ? defvar->prev : NULL;
+    tInstructionNode *popFrame = call->next;
+    if (pushFrame == NULL || pushFrame->opType != OP_PUSHFRAME || store == NULL ||
+        (store->opType != OP_POPS && store->opType != OP_MOVE) ||
+        !cfg_is_var(store->result, OPP_TF_VAR, "%param0") || defvar == NULL ||
+        defvar->opType != OP_DEFVAR || !cfg_is_var(defvar->result, OPP_TF_VAR, "%param0") ||
+        createFrame == NULL || createFrame->opType != OP_CREATEFRAME || popFrame == NULL ||
+        popFrame->opType != OP_POPFRAME)
+    {
+        return false;
+    }
+    if (store->opType == OP_MOVE && store->arg1->type == OPP_TF_VAR)
+    {
+        return false;
+    }
+
+    tAccessorsRegion region;
+    bool lowered = accessors_find_region(&region, cfg, block, popFrame) && region.readCount == 0;
+    accessors_region_dispose(&region);
+    if (!lowered)
+    {
+        return false;
+    }
+
+    store->result = create_operand_from_variable(global, true);
+    accessors_append(removed, removedCount, removedCapacity, createFrame);
+    accessors_append(removed, removedCount, removedCapacity, defvar);
+    accessors_append(removed, removedCount, removedCapacity, pushFrame);
+    accessors_append(removed, removedCount, removedCapacity, call);
+    accessors_append(removed, removedCount, removedCapacity, popFrame);
+    return true;
+}
+
+size_t accessors_run(tThreeACList *list)
+{
+    // Label of every trivial getter and setter, mapped to its global in names
+    tStrMap trivial;
+    strmap_init(&trivial);
+    const char **names = NULL;
+    size_t nameCount = 0;
+
+    tInstructionNode *end;
+    for (tInstructionNode *first = list->head; first != NULL; first = end)
+    {
+        end = cfg_function_end(first);
+        if (!cfg_starts_function(first))
+        {
+            continue;
+        }
+
+        const char *label = first->result->value.label;
+        bool getter = strstr(label, "%getter") != NULL;
+        bool setter = strstr(label, "%setter") != NULL;
+        const char *global = getter || setter ? accessors_trivial_global(first, end, setter)
+                                              : NULL;
+        if (global != NULL)
+        {
+            names = safeRealloc(names, sizeof(char *) * (nameCount + 1));
+            names[nameCount] = global;
+            strmap_put(&trivial, label, nameCount++);
+        }
+    }
+
+    size_t getters = 0;
+    size_t setters = 0;
+    tInstructionNode **removed = NULL;
+    size_t removedCount = 0;
+    size_t removedCapacity = 0;
+    int count = 0;
+    tCfg *cfgs = nameCount > 0 ? cfg_build_program(list, &count) : NULL;
+    for (int i = 0; i < count; i++)
+    {
+        for (int b = 0; b < cfgs[i].blockCount; b++)
+        {
+            for (tInstructionNode *node = cfgs[i].blocks[b].first;; node = node->next)
+            {
+                size_t index;
+                if (node->opType == OP_CALL &&
+                    strmap_get(&trivial, node->result->value.label, &index))
+                {
+                    if (strstr(node->result->value.label, "%getter") != NULL)
+                    {
+                        getters += accessors_lower_get(&cfgs[i], b, node, names[index], &removed,
+                                                       &removedCount, &removedCapacity);
+                    }
+                    else
+                    {
+                        setters += accessors_lower_set(&cfgs[i], b, node, names[index], &removed,
+                                                       &removedCount, &removedCapacity);
+                    }
+                }
+                if (node == cfgs[i].blocks[b].last)
+                {
+                    break;
+                }
+            }
+        }
+    }
+    cfg_dispose_program(cfgs, count);
+
+    // The graphs point into the list, so the lowered calls are only removed now
+    for (size_t i = 0; i < removedCount; i++)
+    {
+        list_remove(list, removed[i]);
+    }
+    free(removed);
+    free(names);
+    strmap_dispose(&trivial);
+    list->active = list->tail;
+
+    stats_rule_hits("accessors", "getter-call", getters);
+    stats_rule_hits("accessors", "setter-call", setters);
+    return getters + setters;
+}
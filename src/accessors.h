@@ -0,0 +1,38 @@
+/**
+ * @file accessors.h
+ *
+ * IFJ25 project
+ *
+ * Lowering of trivial getters and setters to direct global access (-O1).
+ *
+ * A getter whose body only returns one global variable, and a setter whose
+ * body only assigns its parameter to one global variable, need no frame.
+ * A getter call
+ *     CREATEFRAME, PUSHFRAME, CALL g, POPFRAME
+ * is removed and the reads of TF@%retval behind it, up to the next
+ * CREATEFRAME, CALL, RETURN or EXIT on every path, read GF@name instead.
+ * A setter call
+ *     CREATEFRAME, DEFVAR TF@%param0, POPS TF@%param0, PUSHFRAME, CALL s, POPFRAME
+ * becomes POPS GF@name (or MOVE GF@name when the argument was moved in).
+ * Getters and setters with any other body are still called.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_ACCESSORS_H
+#define IFJ_ACCESSORS_H
+
+#include "3AC.h"
+
+#include <stddef.h>
+
+/**
+ * Replaces the calls of trivial getters and setters by direct accesses of
+ * their global variables and reports them to the statistics.
+ *
+ * @param list The generated code.
+ * @return Number of replaced calls.
+ */
+size_t accessors_run(tThreeACList *list);
+
+#endif // IFJ_ACCESSORS_H
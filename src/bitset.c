@@ -0,0 +1,123 @@
+/**
+ * @file bitset.c
+ *
+ * IFJ25 project
+ *
+ * Fixed-size bit sets used by the dataflow analyses.
+ *
+ * @author agent <agent@local>
+ */
+
+#include "bitset.h"
+#include "helper.h"
+
+#define BITSET_WORD_BITS 64
+
+void bitset_init(tBitset *set, size_t bits)
+{
+    set->bits = bits;
+    set->wordCount = (bits + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS;
+    set->words = NULL;
+    if (set->wordCount > 0)
+    {
+        set->words = safeMalloc(sizeof(uint64_t) * set->wordCount);
+    }
+    bitset_clear_all(set);
+}
+
+void bitset_dispose(tBitset *set)
+{
+    free(set->words);
+    set->words = NULL;
+    set->bits = 0;
+    set->wordCount = 0;
+}
+
+void bitset_clear_all(tBitset *set)
+{
+    for (size_t i = 0; i < set->wordCount; i++)
+    {
+        set->words[i] = 0;
+    }
+}
+
+void bitset_set_all(tBitset *set)
+{
+    for (size_t i = 0; i < set->wordCount; i++)
+    {
+        set->words[i] = ~(uint64_t)0;
+    }
+    // Keep the bits past the universe cleared so that comparisons work
+    size_t tail = set->bits % BITSET_WORD_BITS;
+    if (tail != 0)
+    {
+        set->words[set->wordCount - 1] = ((uint64_t)1 << tail) - 1;
+    }
+}
+
+void bitset_set(tBitset *set, size_t bit)
+{
+    set->words[bit / BITSET_WORD_BITS] |= (uint64_t)1 << (bit % BITSET_WORD_BITS);
+}
+
+void bitset_clear(tBitset *set, size_t bit)
+{
+    set->words[bit / BITSET_WORD_BITS] &= ~((uint64_t)1 << (bit % BITSET_WORD_BITS));
+}
+
+bool bitset_test(const tBitset *set, size_t bit)
+{
+    return (set->words[bit / BITSET_WORD_BITS] >> (bit % BITSET_WORD_BITS)) & 1;
+}
+
+void bitset_copy(tBitset *dst, const tBitset *src)
+{
+    for (size_t i = 0; i < dst->wordCount; i++)
+    {
+        dst->words[i] = src->words[i];
+    }
+}
+
+bool bitset_union(tBitset *dst, const tBitset *src)
+{
+    bool changed = false;
+    for (size_t i = 0; i < dst->wordCount; i++)
+    {
+        uint64_t merged = dst->words[i] | src->words[i];
+        changed = changed || merged != dst->words[i];
+        dst->words[i] = merged;
+    }
+    return changed;
+}
+
+bool bitset_intersect(tBitset *dst, const tBitset *src)
+{
+    bool changed = false;
+    for (size_t i = 0; i < dst->wordCount; i++)
+    {
+        uint64_t merged = dst->words[i] & src->words[i];
+        changed = changed || merged != dst->words[i];
+        dst->words[i] = merged;
+    }
+    return changed;
+}
+
+void bitset_subtract(tBitset *dst, const tBitset *src)
+{
+    for (size_t i = 0; i < dst->wordCount; i++)
+    {
+        dst->words[i] &= ~src->words[i];
+    }
+}
+
+bool bitset_equals(const tBitset *a, const tBitset *b)
+{
+    for (size_t i = 0; i < a->wordCount; i++)
+    {
+        if (a->words[i] != b->words[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file bitset.h
+ *
+ * IFJ25 project
+ *
+ * Fixed-size bit sets used by the dataflow analyses.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_BITSET_H
+#define IFJ_BITSET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A set of integers in the range 0 .. bits - 1.
+ */
+typedef struct
+{
+    size_t bits;
+    size_t wordCount;
+    uint64_t *words;
+} tBitset;
+
+/**
+ * Allocates an empty set.
+ *
+ * @param set The set to initialize.
+ * @param bits Size of the universe.
+ */
+void bitset_init(tBitset *set, size_t bits);
+
+/**
+ * Frees the storage of a set.
+ *
+ * @param set The set to dispose.
+ */
+void bitset_dispose(tBitset *set);
+
+/**
+ * Removes all elements.
+ *
+ * @param set The set.
+ */
+void bitset_clear_all(tBitset *set);
+
+/**
+ * Adds all elements of the universe.
+ *
+ * @param set The set.
+ */
+void bitset_set_all(tBitset *set);
+
+/**
+ * Adds one element.
+ *
+ * @param set The set.
+ * @param bit The element.
+ */
+void bitset_set(tBitset *set, size_t bit);
+
+/**
+ * Removes one element.
+ *
+ * @param set The set.
+ * @param bit The element.
+ */
+void bitset_clear(tBitset *set, size_t bit);
+
+/**
+ * Checks whether an element is in the set.
+ *
+ * @param set The set.
+ * @param bit The element.
+ * @return true if the element is present.
+ */
+bool bitset_test(const tBitset *set, size_t bit);
+
+/**
+ * Copies src into dst, both sets must have the same size.
+ *
+ * @param dst Destination set.
+ * @param src Source set.
+ */
+void bitset_copy(tBitset *dst, const tBitset *src);
+
+/**
+ * Adds all elements of src to dst.
+ *
+ * @param dst Destination set.
+ * @param src Source set.
+ * @return true if dst changed.
+ */
+bool bitset_union(tBitset *dst, const tBitset *src);
+
+/**
+ * Removes from dst all elements that are not in src.
+ *
+ * @param dst Destination set.
+ * @param src Source set.
+ * @return true if dst changed.
+ */
+bool bitset_intersect(tBitset *dst, const tBitset *src);
+
+/**
+ * Removes all elements of src from dst.
+ *
+ * @param dst Destination set.
+ * @param src Source set.
+ */
+void bitset_subtract(tBitset *dst, const tBitset *src);
+
+/**
+ * Compares two sets of the same size.
+ *
+ * @param a First set.
+ * @param b Second set.
+ * @return true if both sets contain the same elements.
+ */
+bool bitset_equals(const tBitset *a, const tBitset *b);
+
+#endif // IFJ_BITSET_H
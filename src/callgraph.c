@@ -0,0 +1,141 @@
+/**
+ * @file callgraph.c
+ *
+ * IFJ25 project
+ *
+ * Call graph of the program and removal of unreachable functions (-O1).
+ *
+ * @author agent <agent@local>
+ */
+
+#include "callgraph.h"
+#include "cfg.h"
+#include "helper.h"
+#include "stats.h"
+#include "strmap.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * A function of the listing, or the program header.
+ */
+typedef struct
+{
+    tInstructionNode *first;
+    tInstructionNode *end; // First node of the next function, NULL at the end
+    bool reached;
+} tCallNode;
+
+/**
+ * Splits the listing into the program header and the functions.
+ *
+ * @param list The generated code.
+ * @param count Output for the number of nodes.
+ * @return The nodes in the order of the listing, the header first.
+ */
+static tCallNode *callgraph_split(tThreeACList *list, int *count)
+{
+    int capacity = 16;
+    tCallNode *nodes = safeMalloc(sizeof(tCallNode) * capacity);
+    *count = 0;
+
+    for (tInstructionNode *node = list->head; node != NULL; node = nodes[*count - 1].end)
+    {
+        if (*count == capacity)
+        {
+            capacity *= 2;
+            nodes = safeRealloc(nodes, sizeof(tCallNode) * capacity);
+        }
+        tCallNode *function = &nodes[(*count)++];
+        function->first = node;
+        function->end = cfg_function_end(node);
+        function->reached = false;
+    }
+    return nodes;
+}
+
+size_t callgraph_run(tThreeACList *list)
+{
+    int count;
+    tCallNode *nodes = callgraph_split(list, &count);
+    if (count == 0)
+    {
+        free(nodes);
+        return 0;
+    }
+
+    // Any label leads to its function, in case a jump ever leaves one
+    tStrMap owners;
+    strmap_init(&owners);
+    for (int i = 0; i < count; i++)
+    {
+        for (tInstructionNode *node = nodes[i].first; node != nodes[i].end; node = node->next)
+        {
+            if (node->opType == OP_LABEL && node->result != NULL &&
+                node->result->type == OPP_LABEL)
+            {
+                strmap_put(&owners, node->result->value.label, (size_t)i);
+            }
+        }
+    }
+
+    // Depth-first from the header, which jumps to %start
+    int *stack = safeMalloc(sizeof(int) * count);
+    int top = 0;
+    nodes[0].reached = true;
+    stack[top++] = 0;
+    size_t start;
+    if (strmap_get(&owners, "%start", &start) && !nodes[start].reached)
+    {
+        nodes[start].reached = true;
+        stack[top++] = (int)start;
+    }
+    while (top > 0)
+    {
+        tCallNode *caller = &nodes[stack[--top]];
+        for (tInstructionNode *node = caller->first; node != caller->end; node = node->next)
+        {
+            size_t callee;
+            if (cfg_has_target(node->opType) && node->result != NULL &&
+                node->result->type == OPP_LABEL &&
+                strmap_get(&owners, node->result->value.label, &callee) &&
+                !nodes[callee].reached)
+            {
+                nodes[callee].reached = true;
+                stack[top++] = (int)callee;
+            }
+        }
+    }
+
+    size_t functions = 0;
+    size_t removed = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (nodes[i].reached)
+        {
+            continue;
+        }
+        functions++;
+        tInstructionNode *node = nodes[i].first;
+        while (node != nodes[i].end)
+        {
+            tInstructionNode *next = node->next;
+            if (!cfg_is_marker(node->opType))
+            {
+                removed++;
+            }
+            list_remove(list, node);
+            node = next;
+        }
+    }
+
+    free(stack);
+    strmap_dispose(&owners);
+    free(nodes);
+
+    stats_rule_hits("callgraph", "unreachable-function", functions);
+    stats_rule_hits("callgraph", "removed-instruction", removed);
+    return removed;
+}
@@ -0,0 +1,33 @@
+/**
+ * @file callgraph.h
+ *
+ * IFJ25 project
+ *
+ * Call graph of the program and removal of unreachable functions (-O1).
+ *
+ * The listing is split into functions at their labels; the code in front of
+ * the first one is the program header. Every CALL, and the jump of the header
+ * to %start, is an edge to the function that defines the target label.
+ * Functions, getters, setters and helpers that cannot be reached from the
+ * header are removed together with their code.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_CALLGRAPH_H
+#define IFJ_CALLGRAPH_H
+
+#include "3AC.h"
+
+#include <stddef.h>
+
+/**
+ * Removes the functions that are never called from the entry point and
+ * reports the removed functions and instructions to the statistics.
+ *
+ * @param list The generated code.
+ * @return Number of removed instructions.
+ */
+size_t callgraph_run(tThreeACList *list);
+
+#endif // IFJ_CALLGRAPH_H
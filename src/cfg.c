@@ -0,0 +1,670 @@
+/**
+ * @file cfg.c
+ *
+ * IFJ25 project
+ *
+ * Control-flow graphs over the generated three-address code.
+ *
+ * @author agent <agent@local>
+ */
+
+#include "cfg.h"
+#include "helper.h"
+
+#include <string.h>
+
+bool cfg_is_function_label(const char *label)
+{
+    return strstr(label, "%func") != NULL || strstr(label, "%getter") != NULL ||
+           strstr(label, "%setter") != NULL || strstr(label, "%helper") != NULL ||
+           strcmp(label, "%start") == 0;
+}
+
+bool cfg_is_marker(tOperationType op)
+{
+    return op == OP_COMMENT || op == NO_OP;
+}
+
+bool cfg_is_jump(tOperationType op)
+{
+    return op == OP_JUMP || op == OP_JUMPIFEQ || op == OP_JUMPIFNEQ || op == OP_JUMPIFEQS ||
+           op == OP_JUMPIFNEQS;
+}
+
+bool cfg_has_target(tOperationType op)
+{
+    return cfg_is_jump(op) || op == OP_CALL;
+}
+
+bool cfg_starts_function(const tInstructionNode *node)
+{
+    return node->opType == OP_LABEL && node->result != NULL && node->result->type == OPP_LABEL &&
+           cfg_is_function_label(node->result->value.label);
+}
+
+bool cfg_is_var(const tOperand *operand, tOperandType type, const char *name)
+{
+    return operand != NULL && operand->type == type && strcmp(operand->value.varname, name) == 0;
+}
+
+bool cfg_is_local(const tOperand *operand)
+{
+    return operand != NULL && (operand->type == OPP_VAR || operand->type == OPP_TEMP);
+}
+
+tInstructionNode *cfg_function_end(tInstructionNode *first)
+{
+    tInstructionNode *node = first->next;
+    while (node != NULL && !cfg_starts_function(node))
+    {
+        node = node->next;
+    }
+    return node;
+}
+
+/**
+ * Checks whether control never falls through to the next instruction.
+ *
+ * @param op Operation type.
+ * @return true for JUMP, RETURN and EXIT.
+ */
+static bool cfg_ends_flow(tOperationType op)
+{
+    return op == OP_JUMP || op == OP_RETURN || op == OP_EXIT;
+}
+
+bool cfg_reads_result(tOperationType op)
+{
+    return op == OP_PUSHS || op == OP_WRITE || op == OP_EXIT || op == OP_SETCHAR;
+}
+
+bool cfg_writes_result(tOperationType op)
+{
+    switch (op)
+    {
+        case OP_DEFVAR:
+        case OP_MOVE:
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_IDIV:
+        case OP_AND:
+        case OP_OR:
+        case OP_NOT:
+        case OP_LT:
+        case OP_GT:
+        case OP_EQ:
+        case OP_CONCAT:
+        case OP_STRLEN:
+        case OP_GETCHAR:
+        case OP_SETCHAR:
+        case OP_POPS:
+        case OP_INT2FLOAT:
+        case OP_FLOAT2INT:
+        case OP_FLOAT2STR:
+        case OP_INT2CHAR:
+        case OP_STRI2INT:
+        case OP_INT2STR:
+        case OP_TYPE:
+        case OP_ISINT:
+        case OP_READ:
+            return true;
+        default:
+            return false;
+    }
+}
+
+int cfg_var_index(const tCfg *cfg, const tOperand *operand)
+{
+    size_t index;
+    if (!cfg_is_local(operand))
+    {
+        return -1;
+    }
+    if (!strmap_get(&cfg->varIndex, operand->value.varname, &index))
+    {
+        return -1;
+    }
+    return (int)index;
+}
+
+int cfg_instruction_uses(const tCfg *cfg, const tInstructionNode *node, int uses[3])
+{
+    int count = 0;
+    int index;
+
+    if (cfg_reads_result(node->opType) && (index = cfg_var_index(cfg, node->result)) >= 0)
+    {
+        uses[count++] = index;
+    }
+    if ((index = cfg_var_index(cfg, node->arg1)) >= 0)
+    {
+        uses[count++] = index;
+    }
+    if ((index = cfg_var_index(cfg, node->arg2)) >= 0)
+    {
+        uses[count++] = index;
+    }
+    if (node->opType == OP_RETURN)
+    {
+        size_t retval;
+        if (strmap_get(&cfg->varIndex, "%retval", &retval))
+        {
+            uses[count++] = (int)retval;
+        }
+    }
+    return count;
+}
+
+int cfg_instruction_def(const tCfg *cfg, const tInstructionNode *node)
+{
+    if (!cfg_writes_result(node->opType))
+    {
+        return -1;
+    }
+    return cfg_var_index(cfg, node->result);
+}
+
+tInstructionNode *cfg_block_terminator(const tBasicBlock *block)
+{
+    for (tInstructionNode *node = block->last; node != NULL; node = node->prev)
+    {
+        if (!cfg_is_marker(node->opType))
+        {
+            return node;
+        }
+        if (node == block->first)
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Numbers an operand if it is a local variable seen for the first time.
+ *
+ * @param cfg The graph.
+ * @param operand The operand, may be NULL.
+ */
+static void cfg_register_var(tCfg *cfg, const tOperand *operand)
+{
+    if (!cfg_is_local(operand))
+    {
+        return;
+    }
+    if (strmap_get(&cfg->varIndex, operand->value.varname, NULL))
+    {
+        return;
+    }
+    if (cfg->varCount == cfg->varCapacity)
+    {
+        cfg->varCapacity = cfg->varCapacity == 0 ? 16 : cfg->varCapacity * 2;
+        cfg->varNames = safeRealloc(cfg->varNames, sizeof(char *) * cfg->varCapacity);
+    }
+    cfg->varNames[cfg->varCount] = operand->value.varname;
+    strmap_put(&cfg->varIndex, operand->value.varname, (size_t)cfg->varCount);
+    cfg->varCount++;
+}
+
+/**
+ * Adds an edge between two blocks.
+ *
+ * @param cfg The graph.
+ * @param from Source block.
+ * @param to Target block.
+ */
+static void cfg_add_edge(tCfg *cfg, int from, int to)
+{
+    tBasicBlock *source = &cfg->blocks[from];
+    tBasicBlock *target = &cfg->blocks[to];
+
+    for (int i = 0; i < source->succCount; i++)
+    {
+        if (source->succ[i] == to)
+        {
+            return;
+        }
+    }
+    source->succ[source->succCount++] = to;
+
+    if (target->predCount == target->predCapacity)
+    {
+        target->predCapacity = target->predCapacity == 0 ? 2 : target->predCapacity * 2;
+        target->preds = safeRealloc(target->preds, sizeof(int) * target->predCapacity);
+    }
+    target->preds[target->predCount++] = from;
+}
+
+/**
+ * Splits the function into blocks and fills the label map.
+ *
+ * @param cfg The graph.
+ * @param labels Map from label names to block numbers.
+ */
+static void cfg_split_blocks(tCfg *cfg, tStrMap *labels)
+{
+    int capacity = 16;
+    cfg->blocks = safeMalloc(sizeof(tBasicBlock) * capacity);
+    cfg->blockCount = 0;
+
+    bool startNew = true;
+    bool hasCode = false;
+    for (tInstructionNode *node = cfg->first; node != NULL; node = node->next)
+    {
+        tOperationType op = node->opType;
+
+        // A label starts a block unless the current one only holds markers
+        if (startNew || (op == OP_LABEL && hasCode))
+        {
+            if (cfg->blockCount == capacity)
+            {
+                capacity *= 2;
+                cfg->blocks = safeRealloc(cfg->blocks, sizeof(tBasicBlock) * capacity);
+            }
+            tBasicBlock *block = &cfg->blocks[cfg->blockCount++];
+            memset(block, 0, sizeof(tBasicBlock));
+            block->first = node;
+            block->idom = -1;
+            block->rpoIndex = -1;
+            startNew = false;
+            hasCode = false;
+        }
+
+        tBasicBlock *current = &cfg->blocks[cfg->blockCount - 1];
+        current->last = node;
+
+        if (op == OP_LABEL)
+        {
+            strmap_put(labels, node->result->value.label, (size_t)(cfg->blockCount - 1));
+        }
+        if (!cfg_is_marker(op))
+        {
+            hasCode = true;
+        }
+        if (cfg_is_jump(op) || cfg_ends_flow(op))
+        {
+            startNew = true;
+        }
+
+        if (node == cfg->last)
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * Connects every block with its successors.
+ *
+ * @param cfg The graph.
+ * @param labels Map from label names to block numbers.
+ */
+static void cfg_connect_blocks(tCfg *cfg, const tStrMap *labels)
+{
+    for (int i = 0; i < cfg->blockCount; i++)
+    {
+        tInstructionNode *terminator = cfg_block_terminator(&cfg->blocks[i]);
+        tOperationType op = terminator != NULL ? terminator->opType : NO_OP;
+
+        if (cfg_is_jump(op))
+        {
+            size_t target;
+            if (strmap_get(labels, terminator->result->value.label, &target))
+            {
+                cfg_add_edge(cfg, i, (int)target);
+            }
+        }
+        if (!cfg_ends_flow(op) && i + 1 < cfg->blockCount)
+        {
+            cfg_add_edge(cfg, i, i + 1);
+        }
+    }
+}
+
+/**
+ * Computes the reverse postorder of the blocks reachable from the entry.
+ * Uses an explicit stack so that long functions cannot overflow the C stack.
+ *
+ * @param cfg The graph.
+ */
+static void cfg_compute_rpo(tCfg *cfg)
+{
+    int *stack = safeMalloc(sizeof(int) * cfg->blockCount);
+    int *nextSucc = safeMalloc(sizeof(int) * cfg->blockCount);
+    bool *visited = safeMalloc(sizeof(bool) * cfg->blockCount);
+    int *postorder = safeMalloc(sizeof(int) * cfg->blockCount);
+    int postCount = 0;
+    int top = 0;
+
+    for (int i = 0; i < cfg->blockCount; i++)
+    {
+        visited[i] = false;
+        nextSucc[i] = 0;
+    }
+
+    stack[top++] = 0;
+    visited[0] = true;
+    while (top > 0)
+    {
+        int block = stack[top - 1];
+        if (nextSucc[block] < cfg->blocks[block].succCount)
+        {
+            int succ = cfg->blocks[block].succ[nextSucc[block]++];
+            if (!visited[succ])
+            {
+                visited[succ] = true;
+                stack[top++] = succ;
+            }
+        }
+        else
+        {
+            postorder[postCount++] = block;
+            top--;
+        }
+    }
+
+    cfg->rpo = safeMalloc(sizeof(int) * (postCount > 0 ? postCount : 1));
+    cfg->rpoCount = postCount;
+    for (int i = 0; i < postCount; i++)
+    {
+        cfg->rpo[i] = postorder[postCount - 1 - i];
+        cfg->blocks[cfg->rpo[i]].rpoIndex = i;
+    }
+
+    free(stack);
+    free(nextSucc);
+    free(visited);
+    free(postorder);
+}
+
+/**
+ * Finds the nearest common dominator of two blocks.
+ *
+ * @param cfg The graph.
+ * @param a First block.
+ * @param b Second block.
+ * @return The common dominator.
+ */
+static int cfg_intersect(const tCfg *cfg, int a, int b)
+{
+    while (a != b)
+    {
+        while (cfg->blocks[a].rpoIndex > cfg->blocks[b].rpoIndex)
+        {
+            a = cfg->blocks[a].idom;
+        }
+        while (cfg->blocks[b].rpoIndex > cfg->blocks[a].rpoIndex)
+        {
+            b = cfg->blocks[b].idom;
+        }
+    }
+    return a;
+}
+
+/**
+ * Computes immediate dominators with the iterative algorithm of Cooper,
+ * Harvey and Kennedy, which converges in a few passes over the reverse postorder.
+ *
+ * @param cfg The graph.
+ */
+static void cfg_compute_dominators(tCfg *cfg)
+{
+    if (cfg->rpoCount == 0)
+    {
+        return;
+    }
+
+    cfg->blocks[0].idom = 0;
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = 1; i < cfg->rpoCount; i++)
+        {
+            tBasicBlock *block = &cfg->blocks[cfg->rpo[i]];
+            int newIdom = -1;
+            for (int p = 0; p < block->predCount; p++)
+            {
+                int pred = block->preds[p];
+                if (cfg->blocks[pred].idom < 0)
+                {
+                    continue;
+                }
+                newIdom = newIdom < 0 ? pred : cfg_intersect(cfg, pred, newIdom);
+            }
+            if (newIdom != block->idom)
+            {
+                block->idom = newIdom;
+                changed = true;
+            }
+        }
+    }
+
+    // Number the dominator tree so that dominance queries take constant time
+    int *childStart = safeMalloc(sizeof(int) * (cfg->blockCount + 1));
+    int *children = safeMalloc(sizeof(int) * (cfg->blockCount > 0 ? cfg->blockCount : 1));
+    int *fill = safeMalloc(sizeof(int) * cfg->blockCount);
+    int *stack = safeMalloc(sizeof(int) * cfg->blockCount);
+    int *nextChild = safeMalloc(sizeof(int) * cfg->blockCount);
+
+    for (int i = 0; i <= cfg->blockCount; i++)
+    {
+        childStart[i] = 0;
+    }
+    for (int i = 1; i < cfg->rpoCount; i++)
+    {
+        childStart[cfg->blocks[cfg->rpo[i]].idom + 1]++;
+    }
+    for (int i = 0; i < cfg->blockCount; i++)
+    {
+        childStart[i + 1] += childStart[i];
+        fill[i] = childStart[i];
+        nextChild[i] = childStart[i];
+    }
+    for (int i = 1; i < cfg->rpoCount; i++)
+    {
+        int block = cfg->rpo[i];
+        children[fill[cfg->blocks[block].idom]++] = block;
+    }
+
+    int counter = 0;
+    int top = 0;
+    stack[top++] = 0;
+    cfg->blocks[0].domPre = counter++;
+    while (top > 0)
+    {
+        int block = stack[top - 1];
+        if (nextChild[block] < childStart[block + 1])
+        {
+            int child = children[nextChild[block]++];
+            cfg->blocks[child].domPre = counter++;
+            stack[top++] = child;
+        }
+        else
+        {
+            cfg->blocks[block].domPost = counter++;
+            top--;
+        }
+    }
+
+    cfg->blocks[0].idom = -1;
+
+    free(childStart);
+    free(children);
+    free(fill);
+    free(stack);
+    free(nextChild);
+}
+
+void cfg_build(tCfg *cfg, const char *name, tInstructionNode *first, tInstructionNode *last)
+{
+    tStrMap labels;
+
+    cfg->name = name;
+    cfg->first = first;
+    cfg->last = last;
+    cfg->blocks = NULL;
+    cfg->blockCount = 0;
+    cfg->rpo = NULL;
+    cfg->rpoCount = 0;
+    cfg->varNames = NULL;
+    cfg->varCount = 0;
+    cfg->varCapacity = 0;
+    strmap_init(&cfg->varIndex);
+    strmap_init(&labels);
+
+    cfg_split_blocks(cfg, &labels);
+    cfg_connect_blocks(cfg, &labels);
+    cfg_compute_rpo(cfg);
+    cfg_compute_dominators(cfg);
+
+    for (tInstructionNode *node = first; node != NULL; node = node->next)
+    {
+        cfg_register_var(cfg, node->result);
+        cfg_register_var(cfg, node->arg1);
+        cfg_register_var(cfg, node->arg2);
+        if (node == last)
+        {
+            break;
+        }
+    }
+
+    strmap_dispose(&labels);
+}
+
+size_t cfg_count_instructions(const tInstructionNode *first, const tInstructionNode *end)
+{
+    size_t count = 0;
+    for (const tInstructionNode *node = first; node != end; node = node->next)
+    {
+        if (!cfg_is_marker(node->opType))
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+tCfg *cfg_build_program(tThreeACList *list, int *count)
+{
+    tCfg *cfgs = NULL;
+    int capacity = 0;
+    *count = 0;
+
+    tInstructionNode *end;
+    for (tInstructionNode *first = list->head; first != NULL; first = end)
+    {
+        end = cfg_function_end(first);
+        if (!cfg_starts_function(first))
+        {
+            // The program header in front of the first function
+            continue;
+        }
+
+        tInstructionNode *last = first;
+        while (last->next != end)
+        {
+            last = last->next;
+        }
+        if (*count == capacity)
+        {
+            capacity = capacity == 0 ? 8 : capacity * 2;
+            cfgs = safeRealloc(cfgs, sizeof(tCfg) * capacity);
+        }
+        cfg_build(&cfgs[*count], first->result->value.label, first, last);
+        (*count)++;
+    }
+
+    return cfgs;
+}
+
+void cfg_dispose(tCfg *cfg)
+{
+    for (int i = 0; i < cfg->blockCount; i++)
+    {
+        free(cfg->blocks[i].preds);
+    }
+    free(cfg->blocks);
+    free(cfg->rpo);
+    free(cfg->varNames);
+    strmap_dispose(&cfg->varIndex);
+    cfg->blocks = NULL;
+    cfg->rpo = NULL;
+    cfg->varNames = NULL;
+    cfg->blockCount = 0;
+    cfg->rpoCount = 0;
+    cfg->varCount = 0;
+    cfg->varCapacity = 0;
+}
+
+void cfg_dispose_program(tCfg *cfgs, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        cfg_dispose(&cfgs[i]);
+    }
+    free(cfgs);
+}
+
+bool cfg_dominates(const tCfg *cfg, int a, int b)
+{
+    const tBasicBlock *dominator = &cfg->blocks[a];
+    const tBasicBlock *dominated = &cfg->blocks[b];
+    return dominator->domPre <= dominated->domPre && dominated->domPost <= dominator->domPost;
+}
+
+void cfg_dump(const tCfg *cfg, FILE *out)
+{
+    fprintf(out, "function %s: %d blocks, %d reachable, %d variables\n", cfg->name,
+            cfg->blockCount, cfg->rpoCount, cfg->varCount);
+    for (int i = 0; i < cfg->blockCount; i++)
+    {
+        const tBasicBlock *block = &cfg->blocks[i];
+        size_t instructions = 0;
+        for (tInstructionNode *node = block->first; node != NULL; node = node->next)
+        {
+            if (!cfg_is_marker(node->opType))
+            {
+                instructions++;
+            }
+            if (node == block->last)
+            {
+                break;
+            }
+        }
+
+        fprintf(out, "  B%d", i);
+        if (block->first->opType == OP_LABEL)
+        {
+            fprintf(out, " (%s)", block->first->result->value.label);
+        }
+        fprintf(out, ": %zu instructions", instructions);
+        if (block->rpoIndex < 0)
+        {
+            fprintf(out, ", unreachable\n");
+            continue;
+        }
+        fprintf(out, ", idom ");
+        if (block->idom < 0)
+        {
+            fprintf(out, "-");
+        }
+        else
+        {
+            fprintf(out, "B%d", block->idom);
+        }
+        fprintf(out, ", succ");
+        for (int s = 0; s < block->succCount; s++)
+        {
+            fprintf(out, " B%d", block->succ[s]);
+        }
+        fprintf(out, ", pred");
+        for (int p = 0; p < block->predCount; p++)
+        {
+            fprintf(out, " B%d", block->preds[p]);
+        }
+        fprintf(out, "\n");
+    }
+}
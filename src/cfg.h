@@ -0,0 +1,251 @@
+/**
+ * @file cfg.h
+ *
+ * IFJ25 project
+ *
+ * Control-flow graphs over the generated three-address code.
+ *
+ * Every function (a "name$N%func", getter, setter or the "%start" entry
+ * point) is split into basic blocks. A block starts at a LABEL or after a
+ * jump, RETURN or EXIT and ends before the next such boundary, CALL does
+ * not end a block. Comments and empty lines belong to the surrounding
+ * block. Block 0 is the entry block of the function.
+ *
+ * The graph keeps the blocks in the order of the listing, a reverse
+ * postorder of the reachable blocks and their immediate dominators.
+ * Local variables and temporaries (the LF@ operands) are numbered so that
+ * dataflow analyses can represent sets of them as bit sets.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_CFG_H
+#define IFJ_CFG_H
+
+#include "3AC.h"
+#include "strmap.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * One basic block. first..last is a contiguous range of the listing.
+ */
+typedef struct
+{
+    tInstructionNode *first;
+    tInstructionNode *last;
+    int succ[2];
+    int succCount;
+    int *preds;
+    int predCount;
+    int predCapacity;
+    int idom;      // Immediate dominator, -1 for the entry and unreachable blocks
+    int rpoIndex;  // Position in the reverse postorder, -1 if unreachable
+    int domPre;    // Preorder number in the dominator tree
+    int domPost;   // Postorder number in the dominator tree
+} tBasicBlock;
+
+/**
+ * Control-flow graph of one function.
+ */
+typedef struct
+{
+    const char *name;
+    tInstructionNode *first;
+    tInstructionNode *last;
+    tBasicBlock *blocks;
+    int blockCount;
+    int *rpo;
+    int rpoCount;
+    tStrMap varIndex;
+    char **varNames;
+    int varCount;
+    int varCapacity;
+} tCfg;
+
+/**
+ * Checks whether a label starts a function, getter, setter, shared helper or the entry point.
+ *
+ * @param label Label name.
+ * @return true if the label opens a new function.
+ */
+bool cfg_is_function_label(const char *label);
+
+/**
+ * Checks whether an instruction is only a marker in the listing.
+ *
+ * @param op Operation type.
+ * @return true for comments and empty lines.
+ */
+bool cfg_is_marker(tOperationType op);
+
+/**
+ * Checks whether an instruction jumps to the label in its result operand.
+ *
+ * @param op Operation type.
+ * @return true for all jump instructions.
+ */
+bool cfg_is_jump(tOperationType op);
+
+/**
+ * Checks whether an instruction jumps to or calls the label in its result operand.
+ *
+ * @param op Operation type.
+ * @return true for all jumps and CALL.
+ */
+bool cfg_has_target(tOperationType op);
+
+/**
+ * Checks whether an instruction is the label of a function, getter, setter,
+ * shared helper or the entry point.
+ *
+ * @param node The instruction.
+ * @return true if the instruction opens a new function.
+ */
+bool cfg_starts_function(const tInstructionNode *node);
+
+/**
+ * Checks whether an operand is the given variable of the given frame.
+ *
+ * @param operand The operand, may be NULL.
+ * @param type OPP_VAR for LF, OPP_TF_VAR for TF.
+ * @param name Variable name.
+ * @return true if the operand names the variable.
+ */
+bool cfg_is_var(const tOperand *operand, tOperandType type, const char *name);
+
+/**
+ * Checks whether an operand is a variable of the local frame.
+ *
+ * @param operand The operand, may be NULL.
+ * @return true for local variables and temporaries.
+ */
+bool cfg_is_local(const tOperand *operand);
+
+/**
+ * Finds the end of the function, or of the program header, that starts at an
+ * instruction. Walking the listing with
+ *     for (first = list->head; first != NULL; first = cfg_function_end(first))
+ * visits the header (if there is one) and then every function.
+ *
+ * @param first The label of a function, or the head of the list.
+ * @return The label of the next function, or NULL at the end of the list.
+ */
+tInstructionNode *cfg_function_end(tInstructionNode *first);
+
+/**
+ * Counts the instructions of a part of the listing.
+ *
+ * @param first First instruction.
+ * @param end Instruction behind the last one, NULL for the end of the list.
+ * @return Number of instructions, not counting markers.
+ */
+size_t cfg_count_instructions(const tInstructionNode *first, const tInstructionNode *end);
+
+/**
+ * Builds the graph of one function.
+ *
+ * @param cfg The graph to build.
+ * @param name Name of the function (its label).
+ * @param first First instruction of the function.
+ * @param last Last instruction of the function.
+ */
+void cfg_build(tCfg *cfg, const char *name, tInstructionNode *first, tInstructionNode *last);
+
+/**
+ * Builds the graphs of all functions of a program.
+ *
+ * @param list The generated code.
+ * @param count Output for the number of functions.
+ * @return Array of graphs, free it with cfg_dispose_program().
+ */
+tCfg *cfg_build_program(tThreeACList *list, int *count);
+
+/**
+ * Frees a graph built by cfg_build().
+ *
+ * @param cfg The graph.
+ */
+void cfg_dispose(tCfg *cfg);
+
+/**
+ * Frees the graphs returned by cfg_build_program().
+ *
+ * @param cfgs The graphs.
+ * @param count Number of graphs.
+ */
+void cfg_dispose_program(tCfg *cfgs, int count);
+
+/**
+ * Checks whether block a dominates block b. Both blocks must be reachable.
+ *
+ * @param cfg The graph.
+ * @param a Index of the dominating block.
+ * @param b Index of the dominated block.
+ * @return true if every path from the entry to b goes through a.
+ */
+bool cfg_dominates(const tCfg *cfg, int a, int b);
+
+/**
+ * Returns the number of a local variable or temporary.
+ *
+ * @param cfg The graph.
+ * @param operand The operand, may be NULL.
+ * @return Index of the variable, or -1 if the operand is not a local variable.
+ */
+int cfg_var_index(const tCfg *cfg, const tOperand *operand);
+
+/**
+ * Checks whether an instruction reads its result operand (PUSHS, WRITE, EXIT, SETCHAR).
+ *
+ * @param op Operation type.
+ * @return true if the result operand is an input.
+ */
+bool cfg_reads_result(tOperationType op);
+
+/**
+ * Checks whether an instruction writes its result operand.
+ *
+ * @param op Operation type.
+ * @return true if the result operand is assigned.
+ */
+bool cfg_writes_result(tOperationType op);
+
+/**
+ * Collects the local variables read by an instruction. RETURN reads %retval,
+ * which the caller picks up from the popped frame.
+ *
+ * @param cfg The graph.
+ * @param node The instruction.
+ * @param uses Output array for the variable numbers.
+ * @return Number of variables stored in uses (at most 3).
+ */
+int cfg_instruction_uses(const tCfg *cfg, const tInstructionNode *node, int uses[3]);
+
+/**
+ * Returns the local variable written by an instruction.
+ *
+ * @param cfg The graph.
+ * @param node The instruction.
+ * @return Variable number, or -1 if no local variable is written.
+ */
+int cfg_instruction_def(const tCfg *cfg, const tInstructionNode *node);
+
+/**
+ * Finds the last instruction of a block that is not a comment or an empty line.
+ *
+ * @param block The block.
+ * @return The instruction, or NULL if the block has none.
+ */
+tInstructionNode *cfg_block_terminator(const tBasicBlock *block);
+
+/**
+ * Prints the blocks, edges and dominators of a graph.
+ *
+ * @param cfg The graph.
+ * @param out Output stream.
+ */
+void cfg_dump(const tCfg *cfg, FILE *out);
+
+#endif // IFJ_CFG_H
@@ -0,0 +1,276 @@
+/**
+ * @file dataflow.c
+ *
+ * IFJ25 project
+ *
+ * Iterative bit-vector dataflow analysis over a control-flow graph.
+ *
+ * @author agent <agent@local>
+ */
+
+#include "dataflow.h"
+#include "helper.h"
+
+#include <string.h>
+
+/**
+ * Allocates one empty set per block.
+ *
+ * @param count Number of blocks.
+ * @param bits Size of the universe.
+ * @return The sets.
+ */
+static tBitset *dataflow_alloc_sets(int count, size_t bits)
+{
+    tBitset *sets = safeMalloc(sizeof(tBitset) * (count > 0 ? count : 1));
+    for (int i = 0; i < count; i++)
+    {
+        bitset_init(&sets[i], bits);
+    }
+    return sets;
+}
+
+/**
+ * Frees the sets of all blocks.
+ *
+ * @param sets The sets.
+ * @param count Number of blocks.
+ */
+static void dataflow_free_sets(tBitset *sets, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        bitset_dispose(&sets[i]);
+    }
+    free(sets);
+}
+
+void dataflow_init(tDataflow *df, const tCfg *cfg, tDataflowDirection direction,
+                   tDataflowMeet meet, size_t bits)
+{
+    df->direction = direction;
+    df->meet = meet;
+    df->blockCount = cfg->blockCount;
+    df->bits = bits;
+    bitset_init(&df->boundary, bits);
+    df->gen = dataflow_alloc_sets(cfg->blockCount, bits);
+    df->kill = dataflow_alloc_sets(cfg->blockCount, bits);
+    df->in = dataflow_alloc_sets(cfg->blockCount, bits);
+    df->out = dataflow_alloc_sets(cfg->blockCount, bits);
+}
+
+void dataflow_dispose(tDataflow *df)
+{
+    bitset_dispose(&df->boundary);
+    dataflow_free_sets(df->gen, df->blockCount);
+    dataflow_free_sets(df->kill, df->blockCount);
+    dataflow_free_sets(df->in, df->blockCount);
+    dataflow_free_sets(df->out, df->blockCount);
+    df->gen = df->kill = df->in = df->out = NULL;
+    df->blockCount = 0;
+}
+
+/**
+ * Combines the facts flowing into a block from its neighbours.
+ *
+ * @param df The problem.
+ * @param cfg The graph.
+ * @param block The block.
+ * @param result Output set.
+ */
+static void dataflow_meet(const tDataflow *df, const tCfg *cfg, int block, tBitset *result)
+{
+    const tBasicBlock *b = &cfg->blocks[block];
+    bool forward = df->direction == DATAFLOW_FORWARD;
+    int count = forward ? b->predCount : b->succCount;
+    const int *neighbours = forward ? b->preds : b->succ;
+    bool first = true;
+
+    for (int i = 0; i < count; i++)
+    {
+        int n = neighbours[i];
+        if (cfg->blocks[n].rpoIndex < 0)
+        {
+            continue;
+        }
+        const tBitset *facts = forward ? &df->out[n] : &df->in[n];
+        if (first)
+        {
+            bitset_copy(result, facts);
+            first = false;
+        }
+        else if (df->meet == DATAFLOW_UNION)
+        {
+            bitset_union(result, facts);
+        }
+        else
+        {
+            bitset_intersect(result, facts);
+        }
+    }
+
+    if (first)
+    {
+        // The entry block (forward) or an exit block (backward)
+        bitset_copy(result, &df->boundary);
+    }
+    else if (forward && block == 0)
+    {
+        // The entry is also reached from outside the function
+        if (df->meet == DATAFLOW_UNION)
+        {
+            bitset_union(result, &df->boundary);
+        }
+        else
+        {
+            bitset_intersect(result, &df->boundary);
+        }
+    }
+}
+
+size_t dataflow_solve(tDataflow *df, const tCfg *cfg)
+{
+    bool forward = df->direction == DATAFLOW_FORWARD;
+    int capacity = cfg->rpoCount + 1;
+    int *queue = safeMalloc(sizeof(int) * capacity);
+    bool *queued = safeMalloc(sizeof(bool) * (cfg->blockCount > 0 ? cfg->blockCount : 1));
+    int head = 0;
+    int tail = 0;
+    size_t visits = 0;
+    tBitset merged;
+    tBitset transferred;
+
+    bitset_init(&merged, df->bits);
+    bitset_init(&transferred, df->bits);
+
+    for (int i = 0; i < cfg->blockCount; i++)
+    {
+        queued[i] = false;
+    }
+    for (int i = 0; i < cfg->rpoCount; i++)
+    {
+        int block = cfg->rpo[forward ? i : cfg->rpoCount - 1 - i];
+        if (df->meet == DATAFLOW_INTERSECT)
+        {
+            // Start from the top of the lattice so that loops do not lose facts
+            bitset_set_all(forward ? &df->out[block] : &df->in[block]);
+        }
+        queue[tail++] = block;
+        queued[block] = true;
+    }
+    tail %= capacity;
+
+    while (head != tail)
+    {
+        int block = queue[head];
+        head = (head + 1) % capacity;
+        queued[block] = false;
+        visits++;
+
+        dataflow_meet(df, cfg, block, &merged);
+
+        // transferred = gen | (merged & ~kill)
+        bitset_copy(&transferred, &merged);
+        bitset_subtract(&transferred, &df->kill[block]);
+        bitset_union(&transferred, &df->gen[block]);
+
+        tBitset *entrySet = forward ? &df->in[block] : &df->out[block];
+        tBitset *exitSet = forward ? &df->out[block] : &df->in[block];
+        bitset_copy(entrySet, &merged);
+        if (bitset_equals(exitSet, &transferred))
+        {
+            continue;
+        }
+        bitset_copy(exitSet, &transferred);
+
+        const tBasicBlock *b = &cfg->blocks[block];
+        int count = forward ? b->succCount : b->predCount;
+        const int *neighbours = forward ? b->succ : b->preds;
+        for (int i = 0; i < count; i++)
+        {
+            int n = neighbours[i];
+            if (!queued[n] && cfg->blocks[n].rpoIndex >= 0)
+            {
+                queue[tail] = n;
+                tail = (tail + 1) % capacity;
+                queued[n] = true;
+            }
+        }
+    }
+
+    bitset_dispose(&merged);
+    bitset_dispose(&transferred);
+    free(queue);
+    free(queued);
+    return visits;
+}
+
+/**
+ * Sets up the gen and kill sets of a liveness problem and solves it.
+ *
+ * @param df The problem, initialized by the caller.
+ * @param cfg The graph.
+ * @param defvarAssigns Whether DEFVAR counts as an assignment.
+ */
+static void dataflow_solve_liveness(tDataflow *df, const tCfg *cfg, bool defvarAssigns)
+{
+    for (int i = 0; i < cfg->blockCount; i++)
+    {
+        const tBasicBlock *block = &cfg->blocks[i];
+        for (tInstructionNode *node = block->first; node != NULL; node = node->next)
+        {
+            int uses[3];
+            int useCount = cfg_instruction_uses(cfg, node, uses);
+            for (int u = 0; u < useCount; u++)
+            {
+                if (!bitset_test(&df->kill[i], uses[u]))
+                {
+                    bitset_set(&df->gen[i], uses[u]);
+                }
+            }
+
+            int def = cfg_instruction_def(cfg, node);
+            if (def >= 0 && (defvarAssigns || node->opType != OP_DEFVAR))
+            {
+                bitset_set(&df->kill[i], def);
+            }
+
+            if (node == block->last)
+            {
+                break;
+            }
+        }
+    }
+
+    dataflow_solve(df, cfg);
+}
+
+void dataflow_liveness(tDataflow *df, const tCfg *cfg)
+{
+    dataflow_init(df, cfg, DATAFLOW_BACKWARD, DATAFLOW_UNION, (size_t)cfg->varCount);
+
+    size_t retval;
+    if (strmap_get(&cfg->varIndex, "%retval", &retval))
+    {
+        bitset_set(&df->boundary, retval);
+    }
+
+    dataflow_solve_liveness(df, cfg, true);
+}
+
+bool dataflow_reads_uninitialized(const tCfg *cfg)
+{
+    tDataflow df;
+    dataflow_init(&df, cfg, DATAFLOW_BACKWARD, DATAFLOW_UNION, (size_t)cfg->varCount);
+    dataflow_solve_liveness(&df, cfg, false);
+
+    // Parameters are assigned by the caller
+    bool uninitialized = false;
+    for (int v = 0; v < cfg->varCount && !uninitialized && cfg->blockCount > 0; v++)
+    {
+        uninitialized = bitset_test(&df.in[0], v) && strncmp(cfg->varNames[v], "%param", 6) != 0;
+    }
+
+    dataflow_dispose(&df);
+    return uninitialized;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file dataflow.h
+ *
+ * IFJ25 project
+ *
+ * Iterative bit-vector dataflow analysis over a control-flow graph.
+ *
+ * A problem is described by its direction, its meet operator and a gen
+ * and kill set for every block; the transfer function of a block is
+ * out = gen | (in & ~kill) (with in and out swapped for backward problems).
+ * The solver runs a worklist seeded in reverse postorder (forward) or
+ * postorder (backward), so typical problems converge in two or three
+ * passes. Unreachable blocks are left empty.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_DATAFLOW_H
+#define IFJ_DATAFLOW_H
+
+#include "bitset.h"
+#include "cfg.h"
+
+/**
+ * Direction in which facts propagate.
+ */
+typedef enum
+{
+    DATAFLOW_FORWARD,
+    DATAFLOW_BACKWARD
+} tDataflowDirection;
+
+/**
+ * How facts from several predecessors (successors) are combined.
+ */
+typedef enum
+{
+    DATAFLOW_UNION,
+    DATAFLOW_INTERSECT
+} tDataflowMeet;
+
+/**
+ * One dataflow problem and its solution.
+ */
+typedef struct
+{
+    tDataflowDirection direction;
+    tDataflowMeet meet;
+    int blockCount;
+    size_t bits;
+    tBitset boundary;  // Facts at the entry (forward) or at the exits (backward)
+    tBitset *gen;
+    tBitset *kill;
+    tBitset *in;
+    tBitset *out;
+} tDataflow;
+
+/**
+ * Allocates a problem with empty gen, kill and boundary sets.
+ *
+ * @param df The problem.
+ * @param cfg The graph it is solved on.
+ * @param direction Direction of the analysis.
+ * @param meet Meet operator.
+ * @param bits Size of the universe, e.g. cfg->varCount.
+ */
+void dataflow_init(tDataflow *df, const tCfg *cfg, tDataflowDirection direction,
+                   tDataflowMeet meet, size_t bits);
+
+/**
+ * Solves the problem, the result is stored in df->in and df->out.
+ *
+ * @param df The problem with gen, kill and boundary filled in.
+ * @param cfg The graph.
+ * @return Number of visited blocks until the fixed point was reached.
+ */
+size_t dataflow_solve(tDataflow *df, const tCfg *cfg);
+
+/**
+ * Frees all sets of a problem.
+ *
+ * @param df The problem.
+ */
+void dataflow_dispose(tDataflow *df);
+
+/**
+ * Computes live local variables: df->in[b] holds the variables live at the
+ * start of block b and df->out[b] those live at its end. %retval is live
+ * at the end of the function.
+ *
+ * @param df The problem, initialized by this function.
+ * @param cfg The graph.
+ */
+void dataflow_liveness(tDataflow *df, const tCfg *cfg);
+
+/**
+ * Checks whether a function may read one of its local variables before the
+ * first assignment to it. DEFVAR does not count as an assignment here and
+ * the %paramN variables are assigned by the caller.
+ *
+ * @param cfg Graph of the function.
+ * @return true if such a read exists on some path from the entry.
+ */
+bool dataflow_reads_uninitialized(const tCfg *cfg);
+
+#endif // IFJ_DATAFLOW_H
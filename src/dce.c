@@ -0,0 +1,213 @@
+/**
+ * @file dce.c
+ *
+ * IFJ25 project
+ *
+ * Dead code elimination over the generated three-address code (-O1).
+ *
+ * @author agent <agent@local>
+ */
+
+#include "dce.h"
+#include "cfg.h"
+#include "helper.h"
+#include "stats.h"
+#include "strmap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Checks whether an operand is a constant.
+ *
+ * @param operand The operand, may be NULL.
+ * @return true for int, float, string, bool and nil constants.
+ */
+static bool dce_is_constant(const tOperand *operand)
+{
+    return operand != NULL &&
+           (operand->type == OPP_CONST_INT || operand->type == OPP_CONST_FLOAT ||
+            operand->type == OPP_CONST_STRING || operand->type == OPP_CONST_BOOL ||
+            operand->type == OPP_CONST_NIL);
+}
+
+/**
+ * Removes the blocks of a function that cannot be reached from its entry.
+ * Jumps never leave their function, so no other function can reach them.
+ *
+ * @param list The generated code.
+ * @param cfg Graph of the function.
+ * @return Number of removed instructions, not counting markers.
+ */
+static size_t dce_remove_unreachable(tThreeACList *list, tCfg *cfg)
+{
+    size_t removed = 0;
+    for (int i = 0; i < cfg->blockCount; i++)
+    {
+        tBasicBlock *block = &cfg->blocks[i];
+        if (block->rpoIndex >= 0)
+        {
+            continue;
+        }
+
+        tInstructionNode *node = block->first;
+        tInstructionNode *end = block->last->next;
+        while (node != end)
+        {
+            tInstructionNode *next = node->next;
+            if (!cfg_is_marker(node->opType))
+            {
+                removed++;
+            }
+            list_remove(list, node);
+            node = next;
+        }
+    }
+    return removed;
+}
+
+/**
+ * Removes the labels that no jump or call refers to.
+ *
+ * @param list The generated code.
+ * @return Number of removed labels.
+ */
+static size_t dce_remove_labels(tThreeACList *list)
+{
+    tStrMap referenced;
+    strmap_init(&referenced);
+
+    for (tInstructionNode *node = list->head; node != NULL; node = node->next)
+    {
+        if (node->opType != OP_LABEL && node->result != NULL && node->result->type == OPP_LABEL)
+        {
+            strmap_put(&referenced, node->result->value.label, 0);
+        }
+    }
+
+    size_t removed = 0;
+    tInstructionNode *node = list->head;
+    while (node != NULL)
+    {
+        tInstructionNode *next = node->next;
+        if (node->opType == OP_LABEL && !cfg_is_function_label(node->result->value.label) &&
+            !strmap_get(&referenced, node->result->value.label, NULL))
+        {
+            list_remove(list, node);
+            removed++;
+        }
+        node = next;
+    }
+
+    strmap_dispose(&referenced);
+    return removed;
+}
+
+/**
+ * Removes the local variables of a function that are never read. Constant
+ * assignments to them cannot fail and go away, the DEFVAR is removed once
+ * nothing else mentions the variable.
+ *
+ * @param list The generated code.
+ * @param cfg Graph of the function.
+ * @param stores Output for the number of removed assignments.
+ * @return Number of removed DEFVARs.
+ */
+static size_t dce_remove_variables(tThreeACList *list, tCfg *cfg, size_t *stores)
+{
+    size_t *reads = safeMalloc(sizeof(size_t) * (cfg->varCount + 1));
+    size_t *mentions = safeMalloc(sizeof(size_t) * (cfg->varCount + 1));
+    for (int i = 0; i < cfg->varCount; i++)
+    {
+        reads[i] = mentions[i] = 0;
+    }
+
+    tInstructionNode *end = cfg->last->next;
+    for (tInstructionNode *node = cfg->first; node != end; node = node->next)
+    {
+        int uses[3];
+        int count = cfg_instruction_uses(cfg, node, uses);
+        for (int i = 0; i < count; i++)
+        {
+            reads[uses[i]]++;
+        }
+        if (node->opType == OP_DEFVAR)
+        {
+            continue;
+        }
+        const tOperand *operands[] = {node->result, node->arg1, node->arg2};
+        for (int i = 0; i < 3; i++)
+        {
+            int index = cfg_var_index(cfg, operands[i]);
+            if (index >= 0)
+            {
+                mentions[index]++;
+            }
+        }
+    }
+
+    // Dead constant stores first, their variables may then lose the DEFVAR too
+    tInstructionNode *node = cfg->first;
+    while (node != end)
+    {
+        tInstructionNode *next = node->next;
+        int index = cfg_instruction_def(cfg, node);
+        if (node->opType == OP_MOVE && index >= 0 && reads[index] == 0 &&
+            dce_is_constant(node->arg1))
+        {
+            list_remove(list, node);
+            mentions[index]--;
+            (*stores)++;
+        }
+        node = next;
+    }
+
+    size_t removed = 0;
+    node = cfg->first;
+    while (node != end)
+    {
+        tInstructionNode *next = node->next;
+        int index = cfg_var_index(cfg, node->result);
+        if (node->opType == OP_DEFVAR && index >= 0 && reads[index] == 0 && mentions[index] == 0)
+        {
+            list_remove(list, node);
+            removed++;
+        }
+        node = next;
+    }
+
+    free(reads);
+    free(mentions);
+    return removed;
+}
+
+size_t dce_run(tThreeACList *list)
+{
+    int count;
+    size_t unreachable = 0;
+    size_t labels = 0;
+    size_t stores = 0;
+    size_t defvars = 0;
+
+    tCfg *cfgs = cfg_build_program(list, &count);
+    for (int i = 0; i < count; i++)
+    {
+        unreachable += dce_remove_unreachable(list, &cfgs[i]);
+    }
+    cfg_dispose_program(cfgs, count);
+
+    labels = dce_remove_labels(list);
+
+    cfgs = cfg_build_program(list, &count);
+    for (int i = 0; i < count; i++)
+    {
+        defvars += dce_remove_variables(list, &cfgs[i], &stores);
+    }
+    cfg_dispose_program(cfgs, count);
+
+    stats_rule_hits("dce", "unreachable", unreachable);
+    stats_rule_hits("dce", "unused-label", labels);
+    stats_rule_hits("dce", "dead-store", stores);
+    stats_rule_hits("dce", "unused-defvar", defvars);
+    return unreachable + labels + stores + defvars;
+}
@@ -0,0 +1,32 @@
+/**
+ * @file dce.h
+ *
+ * IFJ25 project
+ *
+ * Dead code elimination over the generated three-address code (-O1).
+ *
+ * The pass removes the blocks that cannot be reached from the entry of
+ * their function (code behind RETURN or EXIT, the implicit return after an
+ * explicit one), labels no instruction refers to and local variables that
+ * are never read: their DEFVAR together with the constant assignments to
+ * them. Assignments that may fail at run time are always kept.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_DCE_H
+#define IFJ_DCE_H
+
+#include "3AC.h"
+
+#include <stddef.h>
+
+/**
+ * Removes dead code and reports the removals to the statistics.
+ *
+ * @param list The generated code.
+ * @return Number of removed instructions.
+ */
+size_t dce_run(tThreeACList *list);
+
+#endif // IFJ_DCE_H
@@ -11,6 +11,13 @@
 #include "3AC_patterns.h"
 #include "expr_parser.h"
 #include "parser.h"
+#include "stats.h"
+
+#include <limits.h>
+#include <math.h>
+
+// Folded strings longer than this are built at run time instead
+#define EXPR_FOLD_MAX_STRING 4096
 
 // clang-format off
 static tPrec precedence_table[12][12] = {
@@ -444,6 +451,12 @@ void expr_push(tExprStack *stack, tSymbol sym, bool isTerminal)
     node->next = stack->top;
     node->dataType = TYPE_UNDEF;
     node->value = NULL;
+    node->constPush = NULL;
+    node->rtType = RT_ANY;
+    node->varName = NULL;
+    node->place = NULL;
+    node->ownsPlace = false;
+    node->callee = -1;
     stack->top = node;
 }
 
@@ -494,6 +507,400 @@ int is_token_expr_end(tToken *token)
     }
 }
 
+/**
+ * Checks whether a constant operand is a number.
+ *
+ * @param op The operand.
+ * @return true for int and float constants.
+ */
+static bool expr_is_numeric_constant(const tOperand *op)
+{
+    return op->type == OPP_CONST_INT || op->type == OPP_CONST_FLOAT;
+}
+
+/**
+ * Converts a numeric constant to float, like the INT2FLOAT in the operator patterns.
+ *
+ * @param op Int or float constant.
+ * @return The value as a double.
+ */
+static double expr_constant_to_float(const tOperand *op)
+{
+    return op->type == OPP_CONST_INT ? (double)op->value.intval : op->value.floatval;
+}
+
+/**
+ * Creates a float constant if the value can be written as an IFJcode25 literal.
+ *
+ * @param value The value.
+ * @return The operand, or NULL for infinities and NaN.
+ */
+static tOperand *expr_fold_float(double value)
+{
+    if (!isfinite(value))
+    {
+        return NULL;
+    }
+    return create_operand_from_constant_float(value);
+}
+
+/**
+ * Evaluates string repetition the way generate_mult_op() does at run time.
+ *
+ * @param str The repeated string.
+ * @param count Int or float constant with the repetition count.
+ * @return String constant, or NULL if the count is not integral or the result is too long.
+ */
+static tOperand *expr_fold_repetition(const char *str, const tOperand *count)
+{
+    double n = expr_constant_to_float(count);
+    if (count->type == OPP_CONST_FLOAT && (n < INT_MIN || n > INT_MAX || n != (double)(int)n))
+    {
+        return NULL; // Runtime error, keep the pattern
+    }
+
+    size_t len = strlen(str);
+    size_t times = n > 0 ? (size_t)n : 0;
+    if (len > 0 && times > EXPR_FOLD_MAX_STRING / len)
+    {
+        return NULL;
+    }
+
+    char *result = safeMalloc(len * times + 1);
+    result[0] = '\0';
+    for (size_t i = 0; i < times; i++)
+    {
+        memcpy(result + i * len, str, len);
+    }
+    result[len * times] = '\0';
+
+    tOperand *op = create_operand_from_constant_string(result);
+    free(result);
+    return op;
+}
+
+/**
+ * Evaluates a binary operator on two constants with the IFJ25 run-time semantics:
+ * arithmetic always yields a float, relational operators need numbers and
+ * == / != compare values of different types as unequal.
+ *
+ * @param op The operator.
+ * @param left Left constant.
+ * @param right Right constant.
+ * @return The constant result, or NULL if the operation fails at run time
+ *         (type error, division by zero) and has to stay in the code.
+ */
+static tOperand *expr_fold_binary(const char *op, const tOperand *left, const tOperand *right)
+{
+    bool numbers = expr_is_numeric_constant(left) && expr_is_numeric_constant(right);
+    double a = numbers ? expr_constant_to_float(left) : 0.0;
+    double b = numbers ? expr_constant_to_float(right) : 0.0;
+
+    if (strcmp(op, "+") == 0)
+    {
+        if (left->type == OPP_CONST_STRING && right->type == OPP_CONST_STRING)
+        {
+            size_t leftLen = strlen(left->value.strval);
+            size_t rightLen = strlen(right->value.strval);
+            char *result = safeMalloc(leftLen + rightLen + 1);
+            memcpy(result, left->value.strval, leftLen);
+            memcpy(result + leftLen, right->value.strval, rightLen + 1);
+            tOperand *concat = create_operand_from_constant_string(result);
+            free(result);
+            return concat;
+        }
+        return numbers ? expr_fold_float(a + b) : NULL;
+    }
+    if (strcmp(op, "-") == 0)
+    {
+        return numbers ? expr_fold_float(a - b) : NULL;
+    }
+    if (strcmp(op, "*") == 0)
+    {
+        if (left->type == OPP_CONST_STRING && expr_is_numeric_constant(right))
+        {
+            return expr_fold_repetition(left->value.strval, right);
+        }
+        return numbers ? expr_fold_float(a * b) : NULL;
+    }
+    if (strcmp(op, "/") == 0)
+    {
+        // Division by zero stays a run-time error
+        return numbers && b != 0.0 ? expr_fold_float(a / b) : NULL;
+    }
+
+    bool result;
+    if (strcmp(op, "==") == 0 || strcmp(op, "!=") == 0)
+    {
+        if (numbers)
+        {
+            result = a == b;
+        }
+        else if (left->type != right->type)
+        {
+            result = false;
+        }
+        else if (left->type == OPP_CONST_STRING)
+        {
+            result = strcmp(left->value.strval, right->value.strval) == 0;
+        }
+        else if (left->type == OPP_CONST_BOOL)
+        {
+            result = left->value.boolval == right->value.boolval;
+        }
+        else if (left->type == OPP_CONST_NIL)
+        {
+            result = true;
+        }
+        else
+        {
+            return NULL;
+        }
+        return create_operand_from_constant_bool(strcmp(op, "==") == 0 ? result : !result);
+    }
+
+    if (!numbers)
+    {
+        return NULL;
+    }
+    if (strcmp(op, "<") == 0)
+    {
+        result = a < b;
+    }
+    else if (strcmp(op, ">") == 0)
+    {
+        result = a > b;
+    }
+    else if (strcmp(op, "<=") == 0)
+    {
+        result = !(a > b);
+    }
+    else if (strcmp(op, ">=") == 0)
+    {
+        result = !(a < b);
+    }
+    else
+    {
+        return NULL;
+    }
+    return create_operand_from_constant_bool(result);
+}
+
+/**
+ * Returns the run-time type of a constant operand.
+ *
+ * @param op The operand.
+ * @return Its type, RT_ANY for anything but a constant.
+ */
+static tRtType expr_constant_type(const tOperand *op)
+{
+    switch (op->type)
+    {
+        case OPP_CONST_INT:
+            return RT_INT;
+        case OPP_CONST_FLOAT:
+            return RT_FLOAT;
+        case OPP_CONST_STRING:
+            return RT_STRING;
+        case OPP_CONST_BOOL:
+            return RT_BOOL;
+        case OPP_CONST_NIL:
+            return RT_NIL;
+        default:
+            return RT_ANY;
+    }
+}
+
+/**
+ * Checks whether the typed pattern of an operator converts its operands
+ * to float.
+ *
+ * @param op The operator.
+ * @param left Type of the left operand.
+ * @param right Type of the right operand.
+ * @return true if both operands are numbers and at least one is converted.
+ */
+static bool expr_needs_float_operands(const char *op, tRtType left, tRtType right)
+{
+    if (!typeinfer_is(left, RT_NUM) || !typeinfer_is(right, RT_NUM))
+    {
+        return false;
+    }
+    bool arithmetic = strcmp(op, "+") == 0 || strcmp(op, "-") == 0 || strcmp(op, "*") == 0 ||
+                      strcmp(op, "/") == 0;
+    return arithmetic || left != right || left == RT_NUM;
+}
+
+/**
+ * Replaces an integer constant operand by the equal float constant, which
+ * saves its conversion at run time.
+ *
+ * @param node The operand.
+ */
+static void expr_promote_int_constant(tExprStackNode *node)
+{
+    if (node->constPush != NULL && node->constPush->result->type == OPP_CONST_INT)
+    {
+        node->constPush->result =
+            create_operand_from_constant_float((double)node->constPush->result->value.intval);
+        node->rtType = RT_FLOAT;
+    }
+    else if (node->place != NULL && node->place->type == OPP_CONST_INT)
+    {
+        node->place = create_operand_from_constant_float((double)node->place->value.intval);
+        node->rtType = RT_FLOAT;
+    }
+}
+
+/**
+ * Creates a temporary and emits its DEFVAR.
+ *
+ * @return The temporary.
+ */
+static tOperand *expr_new_temp(void)
+{
+    tOperand *temp = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+    emit(OP_DEFVAR, temp, NULL, NULL, &threeACcode);
+    return temp;
+}
+
+/**
+ * Sets the place of an operand in the register-style codegen. Constants and
+ * locals of a known type are used where they are, since nothing in an
+ * expression can change a local and a known type proves it is initialized.
+ * Other variables are copied right away, so that reading an uninitialized
+ * one fails at the same point as its PUSHS would.
+ *
+ * @param node The operand node.
+ * @param op The operand.
+ */
+static void expr_set_place(tExprStackNode *node, tOperand *op)
+{
+    if (expr_constant_type(op) != RT_ANY || (op->type == OPP_VAR && node->rtType != RT_ANY))
+    {
+        node->place = op;
+        return;
+    }
+
+    node->place = expr_new_temp();
+    node->ownsPlace = true;
+    emit(OP_MOVE, node->place, op, NULL, &threeACcode);
+}
+
+/**
+ * Returns a temporary with the value of an operand that the generic
+ * operator patterns may modify.
+ *
+ * @param node The operand node.
+ * @return Its own temporary, or a new copy.
+ */
+static tOperand *expr_owned_place(const tExprStackNode *node)
+{
+    if (node->ownsPlace)
+    {
+        return node->place;
+    }
+
+    tOperand *copy = expr_new_temp();
+    emit(OP_MOVE, copy, node->place, NULL, &threeACcode);
+    return copy;
+}
+
+/**
+ * Negates a number into a temporary in the register-style codegen.
+ *
+ * @param place The operand.
+ * @param owned Whether the operand is a temporary that may be modified.
+ * @param type Types the operand may have.
+ * @return The temporary with the negated value.
+ */
+static tOperand *expr_negate_place(tOperand *place, bool owned, tRtType type)
+{
+    tOperand *result = owned ? place : expr_new_temp();
+    tOperand *zeroFloat = create_operand_from_constant_float(0.0);
+
+    if (type == RT_FLOAT)
+    {
+        emit(OP_SUB, result, zeroFloat, place, &threeACcode);
+        return result;
+    }
+
+    if (type == RT_INT)
+    {
+        emit(OP_INT2FLOAT, result, place, NULL, &threeACcode);
+    }
+    else
+    {
+        if (!owned)
+        {
+            emit(OP_MOVE, result, place, NULL, &threeACcode);
+        }
+        tOperand *typeOp = expr_new_temp();
+        emit(OP_TYPE, typeOp, result, NULL, &threeACcode);
+
+        tOperand *isFloatLabel = create_operand_from_label(threeAC_create_label(&threeACcode));
+        emit(OP_JUMPIFNEQ, isFloatLabel, typeOp, create_operand_from_constant_string("int"),
+             &threeACcode);
+        emit(OP_INT2FLOAT, result, result, NULL, &threeACcode);
+        emit(OP_LABEL, isFloatLabel, NULL, NULL, &threeACcode);
+    }
+    emit(OP_SUB, result, zeroFloat, result, &threeACcode);
+    return result;
+}
+
+/**
+ * Emits a binary operator in the register-style codegen.
+ *
+ * @param op The operator.
+ * @param left Left operand node.
+ * @param right Right operand node.
+ * @return The temporary with the result.
+ */
+static tOperand *expr_binary_place(char *op, const tExprStackNode *left,
+                                   const tExprStackNode *right)
+{
+    tOperand *result = expr_new_temp();
+    if (generate_typed_binary_op_regs(op, result, left->place, left->rtType, right->place,
+                                      right->rtType))
+    {
+        return result;
+    }
+
+    tOperand *op1 = expr_owned_place(left);
+    tOperand *op2 = expr_owned_place(right);
+    if (strcmp(op, "+") == 0)
+    {
+        generate_add_op_regs(result, op1, op2);
+    }
+    else if (strcmp(op, "*") == 0)
+    {
+        generate_mult_op_regs(result, op1, op2);
+    }
+    else if (strcmp(op, "-") == 0 || strcmp(op, "/") == 0)
+    {
+        generate_numeric_op_regs(op, result, op1, op2);
+    }
+    else
+    {
+        generate_relational_op_regs(op, result, op1, op2);
+    }
+    return result;
+}
+
+/**
+ * Checks whether two operands of a binary operator are constants whose PUSHS
+ * are the last two emitted instructions, so they can be replaced by the result.
+ *
+ * @param left Left operand node.
+ * @param right Right operand node.
+ * @return true if the operation can be folded.
+ */
+static bool expr_can_fold(const tExprStackNode *left, const tExprStackNode *right)
+{
+    return left->constPush != NULL && right->constPush != NULL &&
+           right->constPush == threeACcode.active && right->constPush->prev == left->constPush;
+}
+
 int reduce_expr(tExprStack *stack)
 {
     tExprStackNode *n1 = stack->top;
@@ -527,10 +934,22 @@ int reduce_expr(tExprStack *stack)
         {
             tDataType type = n2->dataType;
             tSymbol n2Sym = n2->symbol;
+            tInstructionNode *constPush = n2->constPush;
+            tRtType rtType = n2->rtType;
+            const char *varName = n2->varName;
+            tOperand *place = n2->place;
+            bool ownsPlace = n2->ownsPlace;
+            int callee = n2->callee;
             expr_pop(stack);
             expr_pop(stack);
             expr_pop(stack);
             expr_push(stack, n2Sym, false);
+            stack->top->callee = callee;
+            stack->top->constPush = constPush;
+            stack->top->rtType = rtType;
+            stack->top->varName = varName;
+            stack->top->place = place;
+            stack->top->ownsPlace = ownsPlace;
 
             if (n2Sym == E_LITERAL || n2Sym == E_FUNC)
             {
@@ -561,26 +980,79 @@ int reduce_expr(tExprStack *stack)
             }
 
             tSymbol n3Sym = n3->symbol;
+            tInstructionNode *operandPush = n1->constPush;
+            tRtType operandType = n1->rtType;
+            tOperand *operandPlace = n1->place;
+            bool ownsOperand = n1->ownsPlace;
+            typeinfer_narrow(n1->varName, RT_NUM);
 
             expr_pop(stack);
             if (n2->value)
                 free(n2->value);
             expr_pop(stack);
 
+            // Negate a numeric constant at compile time
+            tOperand *folded = NULL;
+            if (operandPush != NULL && operandPush == threeACcode.active &&
+                expr_is_numeric_constant(operandPush->result))
+            {
+                folded = expr_fold_float(0.0 - expr_constant_to_float(operandPush->result));
+            }
+            else if (operandPlace != NULL && expr_is_numeric_constant(operandPlace))
+            {
+                folded = expr_fold_float(0.0 - expr_constant_to_float(operandPlace));
+            }
+            if (folded != NULL)
+            {
+                if (operandPush != NULL)
+                {
+                    list_remove(&threeACcode, operandPush);
+                    emit(OP_PUSHS, folded, NULL, NULL, &threeACcode);
+                }
+                expr_push(stack, n3Sym, false);
+                stack->top->dataType =
+                    (n3Sym == E_LITERAL || n3Sym == E_FUNC) ? TYPE_NUM : TYPE_UNDEF;
+                stack->top->constPush = operandPush != NULL ? threeACcode.active : NULL;
+                stack->top->rtType = RT_FLOAT;
+                stack->top->place = operandPlace != NULL ? folded : NULL;
+                return 1;
+            }
+
+            if (codegenMode == CODEGEN_REGS)
+            {
+                tOperand *negated = expr_negate_place(operandPlace, ownsOperand, operandType);
+                expr_push(stack, n3Sym, false);
+                stack->top->dataType =
+                    (n3Sym == E_LITERAL || n3Sym == E_FUNC) ? TYPE_NUM : TYPE_UNDEF;
+                stack->top->rtType = RT_FLOAT;
+                stack->top->place = negated;
+                stack->top->ownsPlace = true;
+                return 1;
+            }
+
             tOperand *op1 = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
             emit(OP_DEFVAR, op1, NULL, NULL, &threeACcode);
             emit(OP_POPS, op1, NULL, NULL, &threeACcode);
 
-            tOperand *typeOp1 =
-                create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-            emit(OP_DEFVAR, typeOp1, NULL, NULL, &threeACcode);
-            emit(OP_TYPE, typeOp1, op1, NULL, &threeACcode);
+            // The int check is only needed when the type is not known
+            if (operandType == RT_INT)
+            {
+                emit(OP_INT2FLOAT, op1, op1, NULL, &threeACcode);
+            }
+            else if (operandType != RT_FLOAT)
+            {
+                tOperand *typeOp1 =
+                    create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+                emit(OP_DEFVAR, typeOp1, NULL, NULL, &threeACcode);
+                emit(OP_TYPE, typeOp1, op1, NULL, &threeACcode);
 
-            tOperand *op1OkLabel = create_operand_from_label(threeAC_create_label(&threeACcode));
-            emit(OP_JUMPIFNEQ, op1OkLabel, typeOp1, create_operand_from_constant_string("int"),
-                 &threeACcode);
-            emit(OP_INT2FLOAT, op1, op1, NULL, &threeACcode);
-            emit(OP_LABEL, op1OkLabel, NULL, NULL, &threeACcode);
+                tOperand *op1OkLabel =
+                    create_operand_from_label(threeAC_create_label(&threeACcode));
+                emit(OP_JUMPIFNEQ, op1OkLabel, typeOp1, create_operand_from_constant_string("int"),
+                     &threeACcode);
+                emit(OP_INT2FLOAT, op1, op1, NULL, &threeACcode);
+                emit(OP_LABEL, op1OkLabel, NULL, NULL, &threeACcode);
+            }
 
             // Push 0.0 and op1, then subtract
             tOperand *zeroFloat = create_operand_from_constant_float(0.0);
@@ -589,6 +1061,7 @@ int reduce_expr(tExprStack *stack)
             emit(OP_SUBS, NULL, NULL, NULL, &threeACcode);
 
             expr_push(stack, n3Sym, false);
+            stack->top->rtType = RT_FLOAT;
             
             if (n3Sym == E_LITERAL || n3Sym == E_FUNC)
             {
@@ -610,14 +1083,18 @@ int reduce_expr(tExprStack *stack)
         {
 
             char *typeStr = n1->value;
+            tOperand *exprVal = n3->place;
             expr_pop(stack);
             expr_pop(stack);
             expr_pop(stack);
 
-            tOperand *exprVal =
-                create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-            emit(OP_DEFVAR, exprVal, NULL, NULL, &threeACcode);
-            emit(OP_POPS, exprVal, NULL, NULL, &threeACcode);
+            // A place is initialized, so its TYPE cannot hide an error
+            if (exprVal == NULL)
+            {
+                exprVal = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
+                emit(OP_DEFVAR, exprVal, NULL, NULL, &threeACcode);
+                emit(OP_POPS, exprVal, NULL, NULL, &threeACcode);
+            }
 
             tOperand *typeVal =
                 create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
@@ -661,13 +1138,22 @@ int reduce_expr(tExprStack *stack)
                 emit(OP_MOVE, result, create_operand_from_constant_bool(false), NULL, &threeACcode);
             }
 
-            emit(OP_PUSHS, result, NULL, NULL, &threeACcode);
+            if (codegenMode == CODEGEN_STACK)
+            {
+                emit(OP_PUSHS, result, NULL, NULL, &threeACcode);
+            }
 
             if (typeStr)
                 free(typeStr);
 
             expr_push(stack, E_ID, false);
             stack->top->dataType = TYPE_UNDEF;
+            stack->top->rtType = RT_BOOL;
+            if (codegenMode == CODEGEN_REGS)
+            {
+                stack->top->place = result;
+                stack->top->ownsPlace = true;
+            }
             return 1;
         }
     }
@@ -690,28 +1176,93 @@ int reduce_expr(tExprStack *stack)
             tSymbol op = n2->symbol;
             if (op == E_MUL_DIV || op == E_PLUS_MINUS || op == E_REL || op == E_EQ_NEQ)
             {
+                if (strcmp(n2->value, "-") == 0 || strcmp(n2->value, "/") == 0)
+                {
+                    resultType = TYPE_NUM;
+                }
 
-                if (strcmp(n2->value, "+") == 0)
+                // Both operands are constants, compute the result now
+                tOperand *folded = NULL;
+                tOperand *place = NULL;
+                if (expr_can_fold(n3, n1))
                 {
-                    generate_add_op();
+                    folded = expr_fold_binary(n2->value, n3->constPush->result,
+                                              n1->constPush->result);
                 }
-                else if (strcmp(n2->value, "*") == 0)
+                else if (n3->place != NULL && n1->place != NULL &&
+                         expr_constant_type(n3->place) != RT_ANY &&
+                         expr_constant_type(n1->place) != RT_ANY)
                 {
-                    generate_mult_op();
+                    folded = expr_fold_binary(n2->value, n3->place, n1->place);
                 }
-                else if (strcmp(n2->value, "-") == 0 || strcmp(n2->value, "/") == 0)
+
+                if (folded != NULL)
                 {
-                    generate_numeric_op(n2->value);
-                    resultType = TYPE_NUM;
+                    if (codegenMode == CODEGEN_STACK)
+                    {
+                        list_remove(&threeACcode, n1->constPush);
+                        list_remove(&threeACcode, n3->constPush);
+                        emit(OP_PUSHS, folded, NULL, NULL, &threeACcode);
+                    }
+                    place = folded;
                 }
                 else
                 {
-                    generate_relational_op(n2->value);
+                    tInstructionNode *patternStart = stats_pattern_begin();
+
+                    if (expr_needs_float_operands(n2->value, n3->rtType, n1->rtType))
+                    {
+                        expr_promote_int_constant(n3);
+                        expr_promote_int_constant(n1);
+                    }
+
+                    if (codegenMode == CODEGEN_REGS)
+                    {
+                        place = expr_binary_place(n2->value, n3, n1);
+                    }
+                    else if (generate_typed_binary_op(n2->value, n3->rtType, n1->rtType))
+                    {
+                        // Both operand types are known, no run-time dispatch
+                    }
+                    else if (strcmp(n2->value, "+") == 0)
+                    {
+                        generate_add_op();
+                    }
+                    else if (strcmp(n2->value, "*") == 0)
+                    {
+                        generate_mult_op();
+                    }
+                    else if (strcmp(n2->value, "-") == 0 || strcmp(n2->value, "/") == 0)
+                    {
+                        generate_numeric_op(n2->value);
+                    }
+                    else
+                    {
+                        generate_relational_op(n2->value);
+                    }
+
+                    if (statsEnabled)
+                    {
+                        char patternName[16];
+                        snprintf(patternName, sizeof(patternName), "operator %s", n2->value);
+                        stats_pattern_end(patternName, patternStart);
+                    }
                 }
 
                 tSymbol n1Sym = n1->symbol;
                 tSymbol n3Sym = n3->symbol;
 
+                // Reaching the code after the operator proves the operand types
+                tRtType rtType = typeinfer_binary_result(n2->value, n3->rtType, n1->rtType);
+                typeinfer_narrow(n3->varName,
+                                 typeinfer_binary_operand(n2->value, n3->rtType, n1->rtType, true));
+                typeinfer_narrow(n1->varName,
+                                 typeinfer_binary_operand(n2->value, n1->rtType, n3->rtType, false));
+                if (folded != NULL)
+                {
+                    rtType = expr_constant_type(folded);
+                }
+
                 expr_pop(stack);
                 if (n2->value)
                     free(n2->value);
@@ -728,6 +1279,14 @@ int reduce_expr(tExprStack *stack)
                 }
 
                 stack->top->dataType = resultType;
+                stack->top->constPush =
+                    folded != NULL && codegenMode == CODEGEN_STACK ? threeACcode.active : NULL;
+                stack->top->rtType = rtType;
+                if (codegenMode == CODEGEN_REGS)
+                {
+                    stack->top->place = place;
+                    stack->top->ownsPlace = folded == NULL;
+                }
                 return 1;
             }
         }
@@ -766,21 +1325,73 @@ tDataType parse_expression(FILE *file, tToken *currentToken, tSymTableStack *sta
             if (lookSym == E_ID || lookSym == E_LITERAL)
             {
                 tOperand *op = create_operand_from_token(lookahead, stack);
-                emit(OP_PUSHS, op, NULL, NULL, &threeACcode);
                 exprStack.top->dataType = get_data_type_from_token(lookahead, stack);
+                if (lookSym == E_LITERAL)
+                {
+                    exprStack.top->rtType = expr_constant_type(op);
+                }
+                else if (op->type == OPP_VAR)
+                {
+                    exprStack.top->varName = op->value.varname;
+                    exprStack.top->rtType = typeinfer_get(op->value.varname);
+                }
+
+                if (codegenMode == CODEGEN_REGS)
+                {
+                    expr_set_place(exprStack.top, op);
+                }
+                else
+                {
+                    emit(OP_PUSHS, op, NULL, NULL, &threeACcode);
+                    if (lookSym == E_LITERAL)
+                    {
+                        exprStack.top->constPush = threeACcode.active;
+                    }
+                }
             }
             else if (lookSym == E_FUNC)
             {
                 tDataType returnType = TYPE_UNDEF;
-                if (lookahead->type == T_KW_IFJ)
+                bool builtin = lookahead->type == T_KW_IFJ;
+                if (builtin)
                 {
                     returnType = parse_ifj_call(file, &lookahead, stack, false);
+                    exprStack.top->rtType = typeinfer_value();
                 }
                 else
                 {
-                    parse_function_call(file, &lookahead, stack, false);
+                    returnType = parse_function_call(file, &lookahead, stack, false);
+                    exprStack.top->rtType = typeinfer_value();
+                    exprStack.top->callee = typeinfer_value_callee();
                 }
                 exprStack.top->dataType = returnType;
+
+                // A call evaluated at compile time leaves only the push of its result
+                tInstructionNode *last = threeACcode.active;
+                bool folded = builtin && last != NULL &&
+                              last->opType == OP_PUSHS &&
+                              expr_constant_type(last->result) != RT_ANY;
+                if (folded)
+                {
+                    exprStack.top->rtType = expr_constant_type(last->result);
+                    if (codegenMode == CODEGEN_REGS)
+                    {
+                        exprStack.top->place = last->result;
+                        list_remove(&threeACcode, last);
+                    }
+                    else
+                    {
+                        exprStack.top->constPush = last;
+                    }
+                }
+
+                // The call leaves its value on the data stack
+                if (codegenMode == CODEGEN_REGS && !folded)
+                {
+                    exprStack.top->place = expr_new_temp();
+                    exprStack.top->ownsPlace = true;
+                    emit(OP_POPS, exprStack.top->place, NULL, NULL, &threeACcode);
+                }
             }
             else if (lookSym == E_TYPE)
             {
@@ -907,10 +1518,34 @@ tDataType parse_expression(FILE *file, tToken *currentToken, tSymTableStack *sta
     }
 
     tDataType resultType = TYPE_UNDEF;
+    typeinfer_set_value(RT_ANY);
 
     if (exprStack.top && !exprStack.top->isTerminal)
     {
         resultType = exprStack.top->dataType;
+        typeinfer_set_value(exprStack.top->rtType);
+        typeinfer_set_callee(exprStack.top->callee);
+
+        // A call result popped last is still where it belongs and a variable
+        // copied last is pushed directly
+        tOperand *place = exprStack.top->place;
+        tInstructionNode *last = threeACcode.active;
+        if (place != NULL && last != NULL && last->result == place &&
+            (last->opType == OP_POPS || last->opType == OP_MOVE))
+        {
+            tOperand *source = last->opType == OP_MOVE ? last->arg1 : NULL;
+            list_remove(&threeACcode, last);
+            last = threeACcode.active;
+            if (last->opType == OP_DEFVAR && last->result == place)
+            {
+                list_remove(&threeACcode, last);
+            }
+            place = source;
+        }
+        if (place != NULL)
+        {
+            emit(OP_PUSHS, place, NULL, NULL, &threeACcode);
+        }
 
         if (threeACcode.returnUsed == true)
         {
@@ -17,6 +17,7 @@
 #include "semantic.h"
 #include "symstack.h"
 #include "symtable.h"
+#include "typeinfer.h"
 
 #include <stdbool.h>
 #include <stdio.h>
@@ -62,6 +63,12 @@ typedef struct ExprStackNode
     bool isTerminal;
     char *value;
     tDataType dataType;
+    tInstructionNode *constPush; // PUSHS of the compile-time constant value, NULL if not constant
+    tRtType rtType;              // Types the value may have at run time
+    const char *varName;         // Local variable the value was read from, NULL otherwise
+    tOperand *place;             // Operand holding the value in --codegen=regs, NULL otherwise
+    bool ownsPlace;              // place is a temporary of this expression that may be modified
+    int callee;                  // User function the value is the result of, -1 otherwise
     struct ExprStackNode *next;
 } tExprStackNode;
 
@@ -10,9 +10,11 @@
 
 #include "error.h"
 #include "helper.h"
+#include "timing.h"
 
 void *safeMalloc(size_t size)
 {
+    TIMING_COUNT_ALLOC(size);
     void *ptr = malloc(size);
     if (ptr == NULL)
     {
@@ -24,6 +26,7 @@ void *safeMalloc(size_t size)
 
 void *safeRealloc(void *block, size_t size)
 {
+    TIMING_COUNT_ALLOC(size);
     void *ptr = realloc(block, size);
     if (ptr == NULL)
     {
@@ -0,0 +1,606 @@
+/**
+ * @file inliner.c
+ *
+ * IFJ25 project
+ *
+ * Inlining of small functions, getters and setters (-O1).
+ *
+ * @author agent <agent@local>
+ */
+
+#include "inliner.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "helper.h"
+#include "stats.h"
+#include "strmap.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * One function of the program with the functions it calls.
+ */
+typedef struct
+{
+    tInstructionNode *first; // Its LABEL
+    tInstructionNode *last;
+    int *callees;
+    int calleeCount;
+    bool callable;  // A function, getter or setter, not a helper or the entry point
+    bool recursive;
+    int inlinable; // -1 not decided yet, 0 no, 1 yes
+    int maxTemp;   // Highest temporary number used in the body
+} tInlinerFunction;
+
+/**
+ * Renaming of the copied body at one call site.
+ */
+typedef struct
+{
+    int site;        // Number of the call site, the suffix of renamed variables
+    int tempBase;    // Number added to the temporaries of the callee
+    tStrMap labels;  // Labels of the callee to indexes of newLabels
+    char **newLabels;
+} tInlinerSite;
+
+// Call sites inlined so far, keeps the names of all copies distinct
+static int inlinerSiteCounter = 0;
+
+/**
+ * Copies a string.
+ *
+ * @param text The string.
+ * @return A new copy.
+ */
+static char *inliner_strdup(const char *text)
+{
+    char *copy = safeMalloc(strlen(text) + 1);
+    strcpy(copy, text);
+    return copy;
+}
+
+/**
+ * Returns the number of a temporary made by threeAC_create_temp().
+ *
+ * @param name Variable name.
+ * @return N for names of the form "tN", -1 for other names.
+ */
+static int inliner_temp_number(const char *name)
+{
+    if (name[0] != 't' || name[1] == '\0')
+    {
+        return -1;
+    }
+    for (const char *c = name + 1; *c != '\0'; c++)
+    {
+        if (!isdigit((unsigned char)*c))
+        {
+            return -1;
+        }
+    }
+    return atoi(name + 1);
+}
+
+/**
+ * Inserts an instruction behind another one.
+ *
+ * @param list The generated code.
+ * @param after The instruction to insert behind.
+ * @param op Operation type.
+ * @param result Result operand.
+ * @param arg1 First argument.
+ * @param arg2 Second argument.
+ * @return The new instruction.
+ */
+static tInstructionNode *inliner_insert(tThreeACList *list, tInstructionNode *after,
+                                        tOperationType op, tOperand *result, tOperand *arg1,
+                                        tOperand *arg2)
+{
+    list->active = after;
+    list_InsertAfter(list, op, result, arg1, arg2);
+    return list->active;
+}
+
+/**
+ * Returns the name a local variable of the callee has in the caller.
+ *
+ * @param site The call site.
+ * @param name Name in the callee.
+ * @return New local variable operand.
+ */
+static tOperand *inliner_rename(const tInlinerSite *site, const char *name)
+{
+    char buffer[32];
+    int temp = inliner_temp_number(name);
+    if (temp >= 0)
+    {
+        snprintf(buffer, sizeof(buffer), "t%d", site->tempBase + temp);
+        return create_operand_from_variable(buffer, false);
+    }
+
+    char *renamed = safeMalloc(strlen(name) + 16);
+    sprintf(renamed, "%s%%i%d", name, site->site);
+    tOperand *operand = create_operand_from_variable(renamed, false);
+    free(renamed);
+    return operand;
+}
+
+/**
+ * Copies an operand of the callee into the caller.
+ *
+ * @param site The call site.
+ * @param operand The operand, may be NULL.
+ * @return The copy, or NULL.
+ */
+static tOperand *inliner_copy_operand(const tInlinerSite *site, const tOperand *operand)
+{
+    if (operand == NULL)
+    {
+        return NULL;
+    }
+    if (cfg_is_local(operand))
+    {
+        return inliner_rename(site, operand->value.varname);
+    }
+
+    tOperand *copy = safeMalloc(sizeof(tOperand));
+    *copy = *operand;
+    size_t index;
+    switch (operand->type)
+    {
+        case OPP_LABEL:
+            copy->value.label = strmap_get(&site->labels, operand->value.label, &index)
+                                    ? inliner_strdup(site->newLabels[index])
+                                    : inliner_strdup(operand->value.label);
+            break;
+        case OPP_CONST_STRING:
+        case OPP_COMMENT_TEXT:
+            copy->value.strval = inliner_strdup(operand->value.strval);
+            break;
+        case OPP_TF_VAR:
+        case OPP_GLOBAL:
+            copy->value.varname = inliner_strdup(operand->value.varname);
+            break;
+        case OPP_TYPE:
+            copy->value.typeName = inliner_strdup(operand->value.typeName);
+            break;
+        default:
+            break;
+    }
+    return copy;
+}
+
+/**
+ * Finds the functions of the program and the calls between them.
+ *
+ * @param list The generated code.
+ * @param names Output map from labels to function indexes, initialized by this function.
+ * @param count Output for the number of functions.
+ * @return The functions.
+ */
+static tInlinerFunction *inliner_collect(tThreeACList *list, tStrMap *names, int *count)
+{
+    tInlinerFunction *functions = NULL;
+    *count = 0;
+    strmap_init(names);
+
+    for (tInstructionNode *node = list->head; node != NULL; node = node->next)
+    {
+        if (node->opType == OP_LABEL && cfg_is_function_label(node->result->value.label))
+        {
+            functions = safeRealloc(functions, sizeof(tInlinerFunction) * (*count + 1));
+            tInlinerFunction *function = &functions[(*count)++];
+            const char *label = node->result->value.label;
+            function->first = node;
+            function->callees = NULL;
+            function->calleeCount = 0;
+            function->callable = strstr(label, "%func") != NULL ||
+                                 strstr(label, "%getter") != NULL ||
+                                 strstr(label, "%setter") != NULL;
+            function->recursive = false;
+            function->inlinable = -1;
+            function->maxTemp = -1;
+            strmap_put(names, label, (size_t)(*count - 1));
+        }
+        if (*count > 0)
+        {
+            functions[*count - 1].last = node;
+        }
+    }
+
+    for (int f = 0; f < *count; f++)
+    {
+        tInlinerFunction *function = &functions[f];
+        for (tInstructionNode *node = function->first;; node = node->next)
+        {
+            size_t callee;
+            if (node->opType == OP_CALL && strmap_get(names, node->result->value.label, &callee))
+            {
+                function->callees =
+                    safeRealloc(function->callees, sizeof(int) * (function->calleeCount + 1));
+                function->callees[function->calleeCount++] = (int)callee;
+            }
+            if (node->opType == OP_DEFVAR && cfg_is_local(node->result))
+            {
+                int temp = inliner_temp_number(node->result->value.varname);
+                function->maxTemp = temp > function->maxTemp ? temp : function->maxTemp;
+            }
+            if (node == function->last)
+            {
+                break;
+            }
+        }
+    }
+
+    return functions;
+}
+
+/**
+ * Marks the functions that can reach themselves through calls and orders
+ * the functions so that callees come before their callers.
+ *
+ * @param functions The functions.
+ * @param count Number of functions.
+ * @return The order, an array of function indexes.
+ */
+static int *inliner_order(tInlinerFunction *functions, int count)
+{
+    int *order = safeMalloc(sizeof(int) * (count + 1));
+    int *stack = safeMalloc(sizeof(int) * (count + 1));
+    int *nextCallee = safeMalloc(sizeof(int) * (count + 1));
+    bool *seen = safeMalloc(sizeof(bool) * (count + 1));
+
+    for (int f = 0; f < count; f++)
+    {
+        for (int g = 0; g < count; g++)
+        {
+            seen[g] = false;
+        }
+        int top = 0;
+        for (int c = 0; c < functions[f].calleeCount; c++)
+        {
+            int callee = functions[f].callees[c];
+            if (!seen[callee])
+            {
+                seen[callee] = true;
+                stack[top++] = callee;
+            }
+        }
+        while (top > 0 && !seen[f])
+        {
+            const tInlinerFunction *function = &functions[stack[--top]];
+            for (int c = 0; c < function->calleeCount; c++)
+            {
+                int callee = function->callees[c];
+                if (!seen[callee])
+                {
+                    seen[callee] = true;
+                    stack[top++] = callee;
+                }
+            }
+        }
+        functions[f].recursive = seen[f];
+    }
+
+    // Depth-first postorder of the call graph
+    int orderCount = 0;
+    for (int g = 0; g < count; g++)
+    {
+        seen[g] = false;
+    }
+    for (int f = 0; f < count; f++)
+    {
+        if (seen[f])
+        {
+            continue;
+        }
+        int top = 0;
+        stack[top] = f;
+        nextCallee[top++] = 0;
+        seen[f] = true;
+        while (top > 0)
+        {
+            const tInlinerFunction *function = &functions[stack[top - 1]];
+            if (nextCallee[top - 1] < function->calleeCount)
+            {
+                int callee = function->callees[nextCallee[top - 1]++];
+                if (!seen[callee])
+                {
+                    seen[callee] = true;
+                    stack[top] = callee;
+                    nextCallee[top++] = 0;
+                }
+            }
+            else
+            {
+                order[orderCount++] = stack[--top];
+            }
+        }
+    }
+
+    free(stack);
+    free(nextCallee);
+    free(seen);
+    return order;
+}
+
+/**
+ * Checks whether a function may read one of its local variables before it
+ * is assigned.
+ *
+ * @param function The function.
+ * @return true if such a read exists.
+ */
+static bool inliner_reads_uninitialized(const tInlinerFunction *function)
+{
+    tCfg cfg;
+    cfg_build(&cfg, function->first->result->value.label, function->first, function->last);
+    bool uninitialized = dataflow_reads_uninitialized(&cfg);
+    cfg_dispose(&cfg);
+    return uninitialized;
+}
+
+/**
+ * Decides whether the calls of a function may be replaced by its body.
+ *
+ * @param function The function.
+ * @return true if the function is small, not recursive and reads no
+ *         variable before assigning it.
+ */
+static bool inliner_is_inlinable(tInlinerFunction *function)
+{
+    if (function->inlinable < 0)
+    {
+        int size = 0;
+        for (tInstructionNode *node = function->first;; node = node->next)
+        {
+            if (node->opType != OP_COMMENT && node->opType != NO_OP &&
+                node->opType != OP_DEFVAR && node->opType != OP_LABEL)
+            {
+                size++;
+            }
+            if (node == function->last)
+            {
+                break;
+            }
+        }
+        function->inlinable = function->callable && !function->recursive &&
+                              size <= INLINER_MAX_SIZE && !inliner_reads_uninitialized(function);
+    }
+    return function->inlinable == 1;
+}
+
+/**
+ * Replaces one call by the body of the callee if the call has the shape
+ * the parser emits and only TF@%retval is read from the popped frame.
+ *
+ * @param list The generated code.
+ * @param caller The calling function.
+ * @param callee The called function.
+ * @param call The CALL instruction.
+ * @return The last instruction of the copy, or NULL if the call was kept.
+ */
+static tInstructionNode *inliner_inline_call(tThreeACList *list, tInlinerFunction *caller,
+                                             const tInlinerFunction *callee,
+                                             tInstructionNode *call)
+{
+    // CREATEFRAME, DEFVAR TF@%paramN..., POPS TF@%paramN..., PUSHFRAME, CALL, POPFRAME
+    tInstructionNode *pushFrame = call->prev;
+    tInstructionNode *popFrame = call->next;
+    if (pushFrame == NULL || pushFrame->opType != OP_PUSHFRAME || popFrame == NULL ||
+        popFrame->opType != OP_POPFRAME)
+    {
+        return NULL;
+    }
+    int pops = 0;
+    tInstructionNode *node = pushFrame->prev;
+    while (node != NULL && node->opType == OP_POPS && node->result->type == OPP_TF_VAR)
+    {
+        pops++;
+        node = node->prev;
+    }
+    int defvars = 0;
+    while (node != NULL && node->opType == OP_DEFVAR && node->result->type == OPP_TF_VAR)
+    {
+        defvars++;
+        node = node->prev;
+    }
+    if (node == NULL || node->opType != OP_CREATEFRAME || pops != defvars)
+    {
+        return NULL;
+    }
+    tInstructionNode *createFrame = node;
+
+    // Reads of the popped frame behind the call, up to the next frame
+    bool crossed = false;
+    for (node = popFrame->next; node != NULL && node->opType != OP_CREATEFRAME;
+         node = node->next)
+    {
+        tOperand *operands[3] = {node->result, node->arg1, node->arg2};
+        for (int o = 0; o < 3; o++)
+        {
+            if (operands[o] != NULL && operands[o]->type == OPP_TF_VAR &&
+                (crossed || strcmp(operands[o]->value.varname, "%retval") != 0))
+            {
+                return NULL;
+            }
+        }
+        tOperationType op = node->opType;
+        crossed = crossed || op == OP_LABEL || cfg_has_target(op) || op == OP_RETURN ||
+                  op == OP_EXIT;
+        if (node == caller->last)
+        {
+            break;
+        }
+    }
+
+    tInlinerSite site;
+    site.site = inlinerSiteCounter++;
+    site.tempBase = caller->maxTemp + 1;
+    site.newLabels = NULL;
+    strmap_init(&site.labels);
+    size_t labelCount = 0;
+    for (node = callee->first->next; node != NULL; node = node->next)
+    {
+        if (node->opType == OP_LABEL)
+        {
+            site.newLabels = safeRealloc(site.newLabels, sizeof(char *) * (labelCount + 1));
+            site.newLabels[labelCount] = threeAC_create_label(list);
+            strmap_put(&site.labels, node->result->value.label, labelCount++);
+        }
+        if (node == callee->last)
+        {
+            break;
+        }
+    }
+    char *endLabel = threeAC_create_label(list);
+
+    // The DEFVARs of the caller are at its beginning
+    tInstructionNode *defvarTail = caller->first;
+    for (node = caller->first->next; node != createFrame; node = node->next)
+    {
+        if (node->opType == OP_DEFVAR && cfg_is_local(node->result))
+        {
+            defvarTail = node;
+        }
+    }
+
+    // The arguments go to the renamed parameters
+    for (node = createFrame->next; node != pushFrame; node = node->next)
+    {
+        if (node->opType == OP_POPS)
+        {
+            const char *name = node->result->value.varname;
+            defvarTail = inliner_insert(list, defvarTail, OP_DEFVAR, inliner_rename(&site, name),
+                                        NULL, NULL);
+            node->result = inliner_rename(&site, name);
+        }
+    }
+
+    char comment[300];
+    snprintf(comment, sizeof(comment), "Inlined call of %s", callee->first->result->value.label);
+    tOperand *commentText = safeMalloc(sizeof(tOperand));
+    commentText->type = OPP_COMMENT_TEXT;
+    commentText->value.strval = inliner_strdup(comment);
+    tInstructionNode *tail = inliner_insert(list, popFrame, OP_COMMENT, commentText, NULL, NULL);
+
+    for (node = callee->first->next; node != NULL; node = node->next)
+    {
+        if (node->opType == OP_DEFVAR && cfg_is_local(node->result))
+        {
+            defvarTail = inliner_insert(list, defvarTail, OP_DEFVAR,
+                                        inliner_copy_operand(&site, node->result), NULL, NULL);
+        }
+        else if (node->opType == OP_RETURN)
+        {
+            tail = inliner_insert(list, tail, OP_JUMP, create_operand_from_label(endLabel), NULL,
+                                  NULL);
+        }
+        else if (node->opType != OP_COMMENT && node->opType != NO_OP)
+        {
+            tail = inliner_insert(list, tail, node->opType,
+                                  inliner_copy_operand(&site, node->result),
+                                  inliner_copy_operand(&site, node->arg1),
+                                  inliner_copy_operand(&site, node->arg2));
+        }
+        if (node == callee->last)
+        {
+            break;
+        }
+    }
+    tail = inliner_insert(list, tail, OP_LABEL, create_operand_from_label(endLabel), NULL, NULL);
+
+    // The caller reads the return value from the copy
+    for (node = tail->next; node != NULL && node->opType != OP_CREATEFRAME; node = node->next)
+    {
+        tOperand **operands[3] = {&node->result, &node->arg1, &node->arg2};
+        for (int o = 0; o < 3; o++)
+        {
+            if (*operands[o] != NULL && (*operands[o])->type == OPP_TF_VAR)
+            {
+                *operands[o] = inliner_rename(&site, "%retval");
+            }
+        }
+        if (node == caller->last)
+        {
+            break;
+        }
+    }
+
+    // Drop the frame handling
+    tInstructionNode *next;
+    for (node = createFrame; node != tail; node = next)
+    {
+        next = node->next;
+        if (node == createFrame || node == pushFrame || node == call || node == popFrame ||
+            (node->opType == OP_DEFVAR && node->result->type == OPP_TF_VAR))
+        {
+            list_remove(list, node);
+        }
+        if (node == popFrame)
+        {
+            break;
+        }
+    }
+
+    caller->maxTemp = site.tempBase + callee->maxTemp;
+    for (size_t l = 0; l < labelCount; l++)
+    {
+        free(site.newLabels[l]);
+    }
+    free(site.newLabels);
+    free(endLabel);
+    strmap_dispose(&site.labels);
+    return tail;
+}
+
+size_t inliner_run(tThreeACList *list)
+{
+    int count;
+    tStrMap names;
+    tInlinerFunction *functions = inliner_collect(list, &names, &count);
+    int *order = inliner_order(functions, count);
+
+    size_t inlined = 0;
+    for (int o = 0; o < count; o++)
+    {
+        tInlinerFunction *caller = &functions[order[o]];
+        if (!caller->callable)
+        {
+            continue;
+        }
+
+        for (tInstructionNode *node = caller->first; node != caller->last; node = node->next)
+        {
+            size_t callee;
+            if (node->opType != OP_CALL ||
+                !strmap_get(&names, node->result->value.label, &callee) ||
+                (int)callee == order[o] || !inliner_is_inlinable(&functions[callee]))
+            {
+                continue;
+            }
+            tInstructionNode *tail = inliner_inline_call(list, caller, &functions[callee], node);
+            if (tail != NULL)
+            {
+                node = tail;
+                inlined++;
+            }
+        }
+    }
+
+    for (int f = 0; f < count; f++)
+    {
+        free(functions[f].callees);
+    }
+    free(functions);
+    free(order);
+    strmap_dispose(&names);
+    // Insertions moved the active instruction into the middle of the code
+    list->active = list->tail;
+
+    stats_rule_hits("inliner", "inlined", inlined);
+    return inlined;
+}
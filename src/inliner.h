@@ -0,0 +1,44 @@
+/**
+ * @file inliner.h
+ *
+ * IFJ25 project
+ *
+ * Inlining of small functions, getters and setters (-O1).
+ *
+ * A call site
+ *     CREATEFRAME, DEFVAR TF@%paramN, POPS TF@%paramN, PUSHFRAME, CALL f, POPFRAME
+ * is replaced by a copy of the body of f when the body has at most
+ * INLINER_MAX_SIZE instructions and f cannot reach itself through calls.
+ * The arguments are popped into local variables of the caller, RETURN
+ * becomes a jump behind the copy and the reads of TF@%retval behind the call
+ * read the copied %retval instead. Every local variable of the copy is
+ * renamed with the suffix %i<N> of its call site, temporaries get fresh
+ * numbers of the caller, and its DEFVARs join the DEFVARs of the caller.
+ * A callee that may read one of its variables before assigning it is not
+ * inlined, because a DEFVAR moved out of a loop would keep the value from
+ * the previous iteration instead of failing.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_INLINER_H
+#define IFJ_INLINER_H
+
+#include "3AC.h"
+
+#include <stddef.h>
+
+// Largest body that is inlined, not counting DEFVARs, comments and labels
+#define INLINER_MAX_SIZE 128
+
+/**
+ * Inlines the calls of small non-recursive functions and reports them to
+ * the statistics. Callees are handled before their callers, so a function
+ * that became small enough after inlining into it is inlined as well.
+ *
+ * @param list The generated code.
+ * @return Number of inlined call sites.
+ */
+size_t inliner_run(tThreeACList *list);
+
+#endif // IFJ_INLINER_H
@@ -0,0 +1,597 @@
+/**
+ * @file ir_serialize.c
+ *
+ * IFJ25 project
+ *
+ * Binary serialization of the three-address code list.
+ *
+ * @author agent <agent@local>
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "ir_serialize.h"
+#include "error.h"
+#include "helper.h"
+#include "strmap.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define IR_ALIGNMENT 8
+
+/**
+ * Growable byte buffer used while building a section.
+ */
+typedef struct
+{
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+} tIrBuffer;
+
+/**
+ * State of the writer: one buffer per section and the interning maps.
+ */
+typedef struct
+{
+    tIrBuffer constants;
+    tIrBuffer operands;
+    tIrBuffer globals;
+    tIrBuffer code;
+    tIrBuffer strings;
+    tStrMap stringMap;
+    tStrMap constantMap;
+    tStrMap operandMap;
+} tIrWriter;
+
+/**
+ * Appends raw bytes to a buffer.
+ *
+ * @param buffer The buffer.
+ * @param data Bytes to append.
+ * @param size Number of bytes.
+ */
+static void ir_buffer_append(tIrBuffer *buffer, const void *data, size_t size)
+{
+    if (buffer->size + size > buffer->capacity)
+    {
+        size_t newCapacity = buffer->capacity ? buffer->capacity : 256;
+        while (buffer->size + size > newCapacity)
+        {
+            newCapacity *= 2;
+        }
+        buffer->data = safeRealloc(buffer->data, newCapacity);
+        buffer->capacity = newCapacity;
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+}
+
+/**
+ * Computes the CRC-32 (IEEE 802.3) of a block of memory.
+ *
+ * @param data The block.
+ * @param size Its size in bytes.
+ * @return The checksum.
+ */
+static uint32_t ir_crc32(const unsigned char *data, size_t size)
+{
+    static uint32_t table[256];
+    static bool tableReady = false;
+
+    if (!tableReady)
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+/**
+ * Interns a string into the string section.
+ *
+ * @param writer The writer.
+ * @param text The string.
+ * @return Offset of the string inside the string section.
+ */
+static uint32_t ir_intern_string(tIrWriter *writer, const char *text)
+{
+    size_t offset;
+    if (!strmap_get(&writer->stringMap, text, &offset))
+    {
+        offset = writer->strings.size;
+        ir_buffer_append(&writer->strings, text, strlen(text) + 1);
+        strmap_put(&writer->stringMap, text, offset);
+    }
+    return (uint32_t)offset;
+}
+
+/**
+ * Interns a constant operand into the constant pool.
+ *
+ * @param writer The writer.
+ * @param operand A constant operand.
+ * @return Index of the constant in the pool.
+ */
+static uint32_t ir_intern_constant(tIrWriter *writer, const tOperand *operand)
+{
+    tIrConstant constant;
+    memset(&constant, 0, sizeof(constant));
+    constant.kind = operand->type;
+
+    char key[64];
+    switch (operand->type)
+    {
+        case OPP_CONST_INT:
+            constant.value.intValue = operand->value.intval;
+            snprintf(key, sizeof(key), "i%d", operand->value.intval);
+            break;
+        case OPP_CONST_FLOAT:
+            constant.value.floatValue = operand->value.floatval;
+            snprintf(key, sizeof(key), "f%a", operand->value.floatval);
+            break;
+        case OPP_CONST_BOOL:
+            constant.value.boolValue = operand->value.boolval ? 1 : 0;
+            snprintf(key, sizeof(key), "b%d", operand->value.boolval ? 1 : 0);
+            break;
+        case OPP_CONST_STRING:
+            constant.value.stringOffset = ir_intern_string(writer, operand->value.strval);
+            snprintf(key, sizeof(key), "s%lu", (unsigned long)constant.value.stringOffset);
+            break;
+        default:
+            snprintf(key, sizeof(key), "n");
+            break;
+    }
+
+    size_t index;
+    if (!strmap_get(&writer->constantMap, key, &index))
+    {
+        index = writer->constants.size / sizeof(tIrConstant);
+        ir_buffer_append(&writer->constants, &constant, sizeof(constant));
+        strmap_put(&writer->constantMap, key, index);
+    }
+    return (uint32_t)index;
+}
+
+/**
+ * Interns an operand into the operand table.
+ *
+ * @param writer The writer.
+ * @param operand The operand, may be NULL.
+ * @return Operand table index plus one, or 0 for a NULL operand.
+ */
+static uint32_t ir_intern_operand(tIrWriter *writer, const tOperand *operand)
+{
+    if (operand == NULL)
+    {
+        return 0;
+    }
+
+    tIrOperand record;
+    memset(&record, 0, sizeof(record));
+    record.type = (uint16_t)operand->type;
+
+    switch (operand->type)
+    {
+        case OPP_CONST_INT:
+        case OPP_CONST_FLOAT:
+        case OPP_CONST_STRING:
+        case OPP_CONST_BOOL:
+        case OPP_CONST_NIL:
+            record.ref = ir_intern_constant(writer, operand);
+            break;
+        case OPP_TYPE:
+        case OPP_COMMENT_TEXT:
+        case OPP_VAR:
+        case OPP_TF_VAR:
+        case OPP_TEMP:
+        case OPP_GLOBAL:
+        case OPP_LABEL:
+            // All name-carrying members of the union alias the same char pointer
+            record.ref = ir_intern_string(writer, operand->value.varname);
+            break;
+        default:
+            break;
+    }
+
+    char key[32];
+    snprintf(key, sizeof(key), "%u:%lu", (unsigned)record.type, (unsigned long)record.ref);
+
+    size_t index;
+    if (!strmap_get(&writer->operandMap, key, &index))
+    {
+        index = writer->operands.size / sizeof(tIrOperand);
+        ir_buffer_append(&writer->operands, &record, sizeof(record));
+        strmap_put(&writer->operandMap, key, index);
+    }
+    return (uint32_t)index + 1;
+}
+
+/**
+ * Serializes a chain of instruction nodes into a section buffer.
+ *
+ * @param writer The writer.
+ * @param buffer Target section buffer.
+ * @param node First node of the chain.
+ */
+static void ir_write_instructions(tIrWriter *writer, tIrBuffer *buffer, tInstructionNode *node)
+{
+    for (; node != NULL; node = node->next)
+    {
+        tIrInstruction record;
+        memset(&record, 0, sizeof(record));
+        record.opType = (uint16_t)node->opType;
+        record.result = ir_intern_operand(writer, node->result);
+        record.arg1 = ir_intern_operand(writer, node->arg1);
+        record.arg2 = ir_intern_operand(writer, node->arg2);
+        ir_buffer_append(buffer, &record, sizeof(record));
+    }
+}
+
+/**
+ * Places a section at the current end of the image, keeping records aligned.
+ *
+ * @param section Section table entry to fill.
+ * @param offset Running file offset, advanced past the section.
+ * @param size Size of the section in bytes.
+ * @param count Number of records in the section.
+ */
+static void ir_layout_section(tIrSection *section, size_t *offset, size_t size, size_t count)
+{
+    *offset = (*offset + IR_ALIGNMENT - 1) & ~(size_t)(IR_ALIGNMENT - 1);
+    section->offset = (uint32_t)*offset;
+    section->count = (uint32_t)count;
+    *offset += size;
+}
+
+int ir_write_file(tThreeACList *list, const char *path)
+{
+    tIrWriter writer;
+    memset(&writer, 0, sizeof(writer));
+    strmap_init(&writer.stringMap);
+    strmap_init(&writer.constantMap);
+    strmap_init(&writer.operandMap);
+
+    ir_write_instructions(&writer, &writer.globals, list->globalDefHead);
+    ir_write_instructions(&writer, &writer.code, list->head);
+
+    tIrHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IR_MAGIC, sizeof(IR_MAGIC));
+    header.version = IR_VERSION;
+    header.byteOrder = IR_BYTE_ORDER_MARK;
+    header.tempCounter = list->tempCounter;
+    header.loopCounter = list->loopCounter;
+    header.varCounter = list->varCounter;
+
+    size_t offset = sizeof(tIrHeader);
+    ir_layout_section(&header.constants, &offset, writer.constants.size,
+                      writer.constants.size / sizeof(tIrConstant));
+    ir_layout_section(&header.operands, &offset, writer.operands.size,
+                      writer.operands.size / sizeof(tIrOperand));
+    ir_layout_section(&header.globals, &offset, writer.globals.size,
+                      writer.globals.size / sizeof(tIrInstruction));
+    ir_layout_section(&header.code, &offset, writer.code.size,
+                      writer.code.size / sizeof(tIrInstruction));
+    ir_layout_section(&header.strings, &offset, writer.strings.size, writer.strings.size);
+    header.fileSize = offset;
+
+    // Assemble the payload so the checksum can be computed over the exact bytes written
+    unsigned char *image = safeMalloc(offset);
+    memset(image, 0, offset);
+    memcpy(image + header.constants.offset, writer.constants.data, writer.constants.size);
+    memcpy(image + header.operands.offset, writer.operands.data, writer.operands.size);
+    memcpy(image + header.globals.offset, writer.globals.data, writer.globals.size);
+    memcpy(image + header.code.offset, writer.code.data, writer.code.size);
+    memcpy(image + header.strings.offset, writer.strings.data, writer.strings.size);
+    header.checksum = ir_crc32(image + sizeof(tIrHeader), offset - sizeof(tIrHeader));
+    memcpy(image, &header, sizeof(header));
+
+    int status = 0;
+    FILE *file = fopen(path, "wb");
+    if (file == NULL || fwrite(image, 1, offset, file) != offset)
+    {
+        fprintf(stderr, "[IR] Error: Cannot write IR file '%s'\n", path);
+        status = INTERNAL_ERROR;
+    }
+    if (file != NULL && fclose(file) != 0 && status == 0)
+    {
+        fprintf(stderr, "[IR] Error: Cannot write IR file '%s'\n", path);
+        status = INTERNAL_ERROR;
+    }
+
+    free(image);
+    free(writer.constants.data);
+    free(writer.operands.data);
+    free(writer.globals.data);
+    free(writer.code.data);
+    free(writer.strings.data);
+    strmap_dispose(&writer.stringMap);
+    strmap_dispose(&writer.constantMap);
+    strmap_dispose(&writer.operandMap);
+    return status;
+}
+
+/**
+ * Checks that a section lies inside the image and is properly aligned.
+ *
+ * @param section The section table entry.
+ * @param recordSize Size of one record of the section.
+ * @param fileSize Size of the whole image.
+ * @return true if the section is valid.
+ */
+static bool ir_section_valid(const tIrSection *section, size_t recordSize, size_t fileSize)
+{
+    if (section->offset < sizeof(tIrHeader) || section->offset % IR_ALIGNMENT != 0)
+    {
+        return false;
+    }
+    if (section->offset > fileSize)
+    {
+        return false;
+    }
+    return (uint64_t)section->count * recordSize <= fileSize - section->offset;
+}
+
+/**
+ * Resolves a string offset against the string section.
+ *
+ * @param image The mapped image.
+ * @param header Its header.
+ * @param offset Offset inside the string section.
+ * @return Pointer to the string, or NULL if the offset is out of range.
+ */
+static const char *ir_string_at(const unsigned char *image, const tIrHeader *header,
+                                uint64_t offset)
+{
+    if (offset >= header->strings.count)
+    {
+        return NULL;
+    }
+    return (const char *)image + header->strings.offset + offset;
+}
+
+/**
+ * Rebuilds a heap operand from its table entry.
+ *
+ * @param image The mapped image.
+ * @param header Its header.
+ * @param record Operand table entry.
+ * @return The new operand, or NULL if the entry is malformed.
+ */
+static tOperand *ir_decode_operand(const unsigned char *image, const tIrHeader *header,
+                                   const tIrOperand *record)
+{
+    switch (record->type)
+    {
+        case OPP_CONST_INT:
+        case OPP_CONST_FLOAT:
+        case OPP_CONST_STRING:
+        case OPP_CONST_BOOL:
+        case OPP_CONST_NIL:
+        {
+            if (record->ref >= header->constants.count)
+            {
+                return NULL;
+            }
+            const tIrConstant *constant =
+                (const tIrConstant *)(image + header->constants.offset) + record->ref;
+            if (constant->kind != record->type)
+            {
+                return NULL;
+            }
+            if (record->type == OPP_CONST_INT)
+            {
+                return create_operand_from_constant_int((int)constant->value.intValue);
+            }
+            if (record->type == OPP_CONST_FLOAT)
+            {
+                return create_operand_from_constant_float(constant->value.floatValue);
+            }
+            if (record->type == OPP_CONST_BOOL)
+            {
+                return create_operand_from_constant_bool(constant->value.boolValue != 0);
+            }
+            if (record->type == OPP_CONST_NIL)
+            {
+                return create_operand_from_constant_nil();
+            }
+            const char *text = ir_string_at(image, header, constant->value.stringOffset);
+            return text ? create_operand_from_constant_string(text) : NULL;
+        }
+        case OPP_TYPE:
+        case OPP_COMMENT_TEXT:
+        case OPP_VAR:
+        case OPP_TF_VAR:
+        case OPP_TEMP:
+        case OPP_GLOBAL:
+        case OPP_LABEL:
+        {
+            const char *text = ir_string_at(image, header, record->ref);
+            if (text == NULL)
+            {
+                return NULL;
+            }
+            tOperand *operand = create_operand_from_variable(text, false);
+            operand->type = (tOperandType)record->type;
+            return operand;
+        }
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * Decodes one instruction section, handing every instruction to the list.
+ *
+ * @param image The mapped image.
+ * @param section The instruction section.
+ * @param operands Decoded operand table.
+ * @param operandCount Number of entries in the operand table.
+ * @param list Target list.
+ * @param globals Whether the section is the global definitions block.
+ * @return true on success, false if an instruction is malformed.
+ */
+static bool ir_decode_instructions(const unsigned char *image, const tIrSection *section,
+                                   tOperand **operands, uint32_t operandCount,
+                                   tThreeACList *list, bool globals)
+{
+    const tIrInstruction *records = (const tIrInstruction *)(image + section->offset);
+    for (uint32_t i = 0; i < section->count; i++)
+    {
+        const tIrInstruction *record = &records[i];
+        if (record->opType > NO_OP || record->result > operandCount ||
+            record->arg1 > operandCount || record->arg2 > operandCount)
+        {
+            return false;
+        }
+
+        tOperand *result = record->result ? operands[record->result - 1] : NULL;
+        tOperand *arg1 = record->arg1 ? operands[record->arg1 - 1] : NULL;
+        tOperand *arg2 = record->arg2 ? operands[record->arg2 - 1] : NULL;
+
+        if (globals)
+        {
+            list_add_global_def(list, (tOperationType)record->opType, result, arg1, arg2);
+        }
+        else
+        {
+            emit((tOperationType)record->opType, result, arg1, arg2, list);
+        }
+    }
+    return true;
+}
+
+/**
+ * Validates a mapped image and decodes it into the list.
+ *
+ * @param image The mapped image.
+ * @param size Size of the image.
+ * @param list Target list.
+ * @return NULL on success, otherwise a description of the problem.
+ */
+static const char *ir_decode_image(const unsigned char *image, size_t size, tThreeACList *list)
+{
+    if (size < sizeof(tIrHeader))
+    {
+        return "file is truncated";
+    }
+
+    const tIrHeader *header = (const tIrHeader *)image;
+    if (memcmp(header->magic, IR_MAGIC, sizeof(IR_MAGIC)) != 0)
+    {
+        return "not an IFJ25 IR file";
+    }
+    if (header->version != IR_VERSION)
+    {
+        return "unsupported format version";
+    }
+    if (header->byteOrder != IR_BYTE_ORDER_MARK)
+    {
+        return "byte order does not match this machine";
+    }
+    if (header->fileSize != size)
+    {
+        return "file size does not match header";
+    }
+    if (ir_crc32(image + sizeof(tIrHeader), size - sizeof(tIrHeader)) != header->checksum)
+    {
+        return "checksum mismatch";
+    }
+    if (!ir_section_valid(&header->constants, sizeof(tIrConstant), size) ||
+        !ir_section_valid(&header->operands, sizeof(tIrOperand), size) ||
+        !ir_section_valid(&header->globals, sizeof(tIrInstruction), size) ||
+        !ir_section_valid(&header->code, sizeof(tIrInstruction), size) ||
+        !ir_section_valid(&header->strings, 1, size))
+    {
+        return "section table is out of range";
+    }
+    if (header->strings.count > 0 &&
+        image[header->strings.offset + header->strings.count - 1] != '\0')
+    {
+        return "string section is not terminated";
+    }
+
+    uint32_t operandCount = header->operands.count;
+    tOperand **operands = safeMalloc((operandCount ? operandCount : 1) * sizeof(tOperand *));
+    const tIrOperand *records = (const tIrOperand *)(image + header->operands.offset);
+    for (uint32_t i = 0; i < operandCount; i++)
+    {
+        operands[i] = ir_decode_operand(image, header, &records[i]);
+        if (operands[i] == NULL)
+        {
+            free(operands);
+            return "malformed operand table";
+        }
+    }
+
+    const char *problem = NULL;
+    if (!ir_decode_instructions(image, &header->globals, operands, operandCount, list, true) ||
+        !ir_decode_instructions(image, &header->code, operands, operandCount, list, false))
+    {
+        problem = "malformed instruction";
+    }
+    else
+    {
+        list->tempCounter = header->tempCounter;
+        list->loopCounter = header->loopCounter;
+        list->varCounter = header->varCounter;
+    }
+
+    free(operands);
+    return problem;
+}
+
+int ir_load_file(const char *path, tThreeACList *list)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "[IR] Error: Cannot open IR file '%s'\n", path);
+        return INTERNAL_ERROR;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        close(fd);
+        fprintf(stderr, "[IR] Error: Invalid IR file '%s': file is truncated\n", path);
+        return INTERNAL_ERROR;
+    }
+
+    size_t size = (size_t)info.st_size;
+    void *image = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED)
+    {
+        fprintf(stderr, "[IR] Error: Cannot map IR file '%s'\n", path);
+        return INTERNAL_ERROR;
+    }
+
+    const char *problem = ir_decode_image(image, size, list);
+    munmap(image, size);
+
+    if (problem != NULL)
+    {
+        fprintf(stderr, "[IR] Error: Invalid IR file '%s': %s\n", path, problem);
+        return INTERNAL_ERROR;
+    }
+    return 0;
+}
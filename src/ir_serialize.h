@@ -0,0 +1,126 @@
+/**
+ * @file ir_serialize.h
+ *
+ * IFJ25 project
+ *
+ * Binary serialization of the three-address code list.
+ *
+ * The file is a fixed header followed by five sections. Every reference
+ * inside the file is an index or an offset relative to its section, so the
+ * image can be mapped read-only and walked in place without relocation:
+ *
+ *   header      tIrHeader, holds the section table and a CRC-32 of the rest
+ *   constants   tIrConstant[]    interned constant pool
+ *   operands    tIrOperand[]     interned operand table
+ *   globals     tIrInstruction[] global definitions block
+ *   code        tIrInstruction[] instruction stream
+ *   strings     NUL-terminated interned names, labels and string literals
+ *
+ * Records are stored in host byte order; the byte order marker in the
+ * header is checked when loading.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_IR_SERIALIZE_H
+#define IFJ_IR_SERIALIZE_H
+
+#include "3AC.h"
+
+#include <stdint.h>
+
+#define IR_MAGIC "IFJ25IR"
+#define IR_VERSION 1
+#define IR_BYTE_ORDER_MARK 0x01020304u
+
+/**
+ * Location of one section in the file.
+ */
+typedef struct
+{
+    uint32_t offset;
+    uint32_t count;
+} tIrSection;
+
+/**
+ * File header. The checksum covers every byte after the header.
+ */
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t checksum;
+    uint32_t reserved;
+    uint64_t fileSize;
+    int32_t tempCounter;
+    int32_t loopCounter;
+    int32_t varCounter;
+    int32_t reserved2;
+    tIrSection constants;
+    tIrSection operands;
+    tIrSection globals;
+    tIrSection code;
+    tIrSection strings;
+} tIrHeader;
+
+/**
+ * Entry of the constant pool. Kind is one of the OPP_CONST_* operand types,
+ * string constants store an offset into the string section.
+ */
+typedef struct
+{
+    uint32_t kind;
+    uint32_t reserved;
+    union
+    {
+        int64_t intValue;
+        double floatValue;
+        uint64_t boolValue;
+        uint64_t stringOffset;
+    } value;
+} tIrConstant;
+
+/**
+ * Entry of the operand table. Ref is a constant pool index for constants
+ * and a string offset for everything else.
+ */
+typedef struct
+{
+    uint16_t type;
+    uint16_t reserved;
+    uint32_t ref;
+} tIrOperand;
+
+/**
+ * One instruction. Operands are operand table indices plus one, zero means
+ * the operand is absent.
+ */
+typedef struct
+{
+    uint16_t opType;
+    uint16_t reserved;
+    uint32_t result;
+    uint32_t arg1;
+    uint32_t arg2;
+} tIrInstruction;
+
+/**
+ * Writes the list, including its global definitions and counters, to a file.
+ *
+ * @param list The list to serialize.
+ * @param path Path of the output file.
+ * @return 0 on success, INTERNAL_ERROR if the file cannot be written.
+ */
+int ir_write_file(tThreeACList *list, const char *path);
+
+/**
+ * Maps a serialized file, validates it and appends its contents to an empty list.
+ *
+ * @param path Path of the input file.
+ * @param list Initialized empty list to fill.
+ * @return 0 on success, INTERNAL_ERROR if the file is missing, truncated or corrupted.
+ */
+int ir_load_file(const char *path, tThreeACList *list);
+
+#endif // IFJ_IR_SERIALIZE_H
@@ -0,0 +1,641 @@
+/**
+ * @file licm.c
+ *
+ * IFJ25 project
+ *
+ * Loop-invariant code motion (-O1).
+ *
+ * @author agent <agent@local>
+ */
+
+#include "licm.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "helper.h"
+#include "stats.h"
+
+#include <stdlib.h>
+
+// Functions with more blocks * facts are skipped to bound the memory of the analysis
+#define LICM_MAX_BITS ((size_t)1 << 26)
+
+/**
+ * Facts about a local variable, one bit of the type analysis each.
+ */
+typedef enum
+{
+    FACT_ASSIGNED, // Holds a value, reading it cannot fail
+    FACT_INT,
+    FACT_FLOAT,
+    FACT_STRING,
+    FACT_BOOL,
+    FACT_NIL,
+    FACT_COUNT // Used as "nothing is known"
+} tLicmFact;
+
+/**
+ * A natural loop, all back edges to one header merged.
+ */
+typedef struct
+{
+    int header;
+    bool *blocks; // Membership of every block of the function
+    int size;
+} tLicmLoop;
+
+/**
+ * Returns what is known about the value of an operand.
+ *
+ * @param cfg Graph of the function.
+ * @param facts Facts about the variables, NULL if nothing is known.
+ * @param operand The operand.
+ * @return The type, FACT_ASSIGNED for an initialized variable of unknown
+ *         type, FACT_COUNT if the operand may be uninitialized or global.
+ */
+static tLicmFact licm_operand_fact(const tCfg *cfg, const tBitset *facts, const tOperand *operand)
+{
+    switch (operand->type)
+    {
+        case OPP_CONST_INT:
+            return FACT_INT;
+        case OPP_CONST_FLOAT:
+            return FACT_FLOAT;
+        case OPP_CONST_STRING:
+            return FACT_STRING;
+        case OPP_CONST_BOOL:
+            return FACT_BOOL;
+        case OPP_CONST_NIL:
+            return FACT_NIL;
+        default:
+            break;
+    }
+
+    int index = cfg_var_index(cfg, operand);
+    if (facts == NULL || index < 0 ||
+        !bitset_test(facts, (size_t)index * FACT_COUNT + FACT_ASSIGNED))
+    {
+        return FACT_COUNT;
+    }
+    for (int fact = FACT_INT; fact < FACT_COUNT; fact++)
+    {
+        if (bitset_test(facts, (size_t)index * FACT_COUNT + fact))
+        {
+            return (tLicmFact)fact;
+        }
+    }
+    return FACT_ASSIGNED;
+}
+
+/**
+ * Returns the type of the value an instruction assigns.
+ *
+ * @param cfg Graph of the function.
+ * @param facts Facts before the instruction, NULL if nothing is known.
+ * @param node The instruction.
+ * @return The type, or FACT_ASSIGNED if it is not known.
+ */
+static tLicmFact licm_result_fact(const tCfg *cfg, const tBitset *facts,
+                                  const tInstructionNode *node)
+{
+    tLicmFact fact;
+    switch (node->opType)
+    {
+        case OP_MOVE:
+            fact = licm_operand_fact(cfg, facts, node->arg1);
+            return fact == FACT_COUNT ? FACT_ASSIGNED : fact;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+            // Both operands have the type of the result, or the instruction fails
+            fact = licm_operand_fact(cfg, facts, node->arg1);
+            return fact == FACT_INT || fact == FACT_FLOAT ? fact : FACT_ASSIGNED;
+        case OP_DIV:
+        case OP_INT2FLOAT:
+            return FACT_FLOAT;
+        case OP_IDIV:
+        case OP_STRLEN:
+        case OP_FLOAT2INT:
+        case OP_STRI2INT:
+            return FACT_INT;
+        case OP_AND:
+        case OP_OR:
+        case OP_NOT:
+        case OP_LT:
+        case OP_GT:
+        case OP_EQ:
+        case OP_ISINT:
+            return FACT_BOOL;
+        case OP_CONCAT:
+        case OP_GETCHAR:
+        case OP_INT2CHAR:
+        case OP_INT2STR:
+        case OP_FLOAT2STR:
+        case OP_TYPE:
+            return FACT_STRING;
+        default:
+            return FACT_ASSIGNED;
+    }
+}
+
+/**
+ * Records the facts about a variable after an assignment.
+ *
+ * @param facts The facts.
+ * @param index The variable.
+ * @param fact Its type, FACT_ASSIGNED if unknown, FACT_COUNT if it is uninitialized.
+ */
+static void licm_set_fact(tBitset *facts, int index, tLicmFact fact)
+{
+    for (int f = 0; f < FACT_COUNT; f++)
+    {
+        bitset_clear(facts, (size_t)index * FACT_COUNT + f);
+    }
+    if (fact != FACT_COUNT)
+    {
+        bitset_set(facts, (size_t)index * FACT_COUNT + FACT_ASSIGNED);
+        bitset_set(facts, (size_t)index * FACT_COUNT + fact);
+    }
+}
+
+/**
+ * Computes which variables are initialized and of which type at the start
+ * and at the end of every block. A fact holds when it holds on every path.
+ *
+ * @param df The problem, initialized by this function.
+ * @param cfg Graph of the function.
+ */
+static void licm_type_facts(tDataflow *df, const tCfg *cfg)
+{
+    dataflow_init(df, cfg, DATAFLOW_FORWARD, DATAFLOW_INTERSECT,
+                  (size_t)cfg->varCount * FACT_COUNT);
+
+    for (int i = 0; i < cfg->blockCount; i++)
+    {
+        const tBasicBlock *block = &cfg->blocks[i];
+        for (tInstructionNode *node = block->first; node != NULL; node = node->next)
+        {
+            int def = cfg_instruction_def(cfg, node);
+            if (def >= 0)
+            {
+                // Only facts made earlier in the block are known here
+                tLicmFact fact = node->opType == OP_DEFVAR
+                                     ? FACT_COUNT
+                                     : licm_result_fact(cfg, &df->gen[i], node);
+                licm_set_fact(&df->gen[i], def, fact);
+                for (int f = 0; f < FACT_COUNT; f++)
+                {
+                    bitset_set(&df->kill[i], (size_t)def * FACT_COUNT + f);
+                }
+            }
+            if (node == block->last)
+            {
+                break;
+            }
+        }
+    }
+
+    dataflow_solve(df, cfg);
+}
+
+/**
+ * Checks whether an instruction can be executed without a run-time error.
+ * Only instructions that may be moved are considered.
+ *
+ * @param cfg Graph of the function.
+ * @param facts Facts before the instruction.
+ * @param node The instruction.
+ * @return true if the instruction cannot fail.
+ */
+static bool licm_cannot_fail(const tCfg *cfg, const tBitset *facts, const tInstructionNode *node)
+{
+    tLicmFact a = node->arg1 != NULL ? licm_operand_fact(cfg, facts, node->arg1) : FACT_COUNT;
+    tLicmFact b = node->arg2 != NULL ? licm_operand_fact(cfg, facts, node->arg2) : FACT_COUNT;
+    bool typed = a != FACT_ASSIGNED && a != FACT_COUNT;
+    bool nonzero =
+        node->arg2 != NULL && ((node->arg2->type == OPP_CONST_INT && node->arg2->value.intval != 0) ||
+                               (node->arg2->type == OPP_CONST_FLOAT && node->arg2->value.floatval != 0));
+
+    switch (node->opType)
+    {
+        case OP_TYPE:
+            return true;
+        case OP_MOVE:
+            return a != FACT_COUNT;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+            return a == b && (a == FACT_INT || a == FACT_FLOAT);
+        case OP_DIV:
+            return a == FACT_FLOAT && b == FACT_FLOAT && nonzero;
+        case OP_IDIV:
+            return a == FACT_INT && b == FACT_INT && nonzero;
+        case OP_LT:
+        case OP_GT:
+            return a == b && (a == FACT_INT || a == FACT_FLOAT || a == FACT_STRING);
+        case OP_EQ:
+            return (typed && a == b) || (a == FACT_NIL && b != FACT_COUNT) ||
+                   (b == FACT_NIL && a != FACT_COUNT);
+        case OP_AND:
+        case OP_OR:
+            return a == FACT_BOOL && b == FACT_BOOL;
+        case OP_NOT:
+            return a == FACT_BOOL;
+        case OP_CONCAT:
+            return a == FACT_STRING && b == FACT_STRING;
+        case OP_STRLEN:
+            return a == FACT_STRING;
+        case OP_INT2FLOAT:
+        case OP_INT2STR:
+            return a == FACT_INT;
+        case OP_FLOAT2INT:
+        case OP_FLOAT2STR:
+            return a == FACT_FLOAT;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Checks whether an operand has the same value in every iteration.
+ *
+ * @param cfg Graph of the function.
+ * @param defCount Number of assignments in the loop of every variable.
+ * @param operand The operand, may be NULL.
+ * @return true for constants and local variables the loop does not assign.
+ */
+static bool licm_is_invariant(const tCfg *cfg, const int *defCount, const tOperand *operand)
+{
+    if (operand == NULL || licm_operand_fact(cfg, NULL, operand) != FACT_COUNT)
+    {
+        return true;
+    }
+    int index = cfg_var_index(cfg, operand);
+    return index >= 0 && defCount[index] == 0;
+}
+
+/**
+ * Orders loops by their size for qsort, so inner loops come first.
+ *
+ * @param a First loop.
+ * @param b Second loop.
+ * @return Negative, zero or positive like strcmp.
+ */
+static int licm_compare(const void *a, const void *b)
+{
+    const tLicmLoop *x = a;
+    const tLicmLoop *y = b;
+    if (x->size != y->size)
+    {
+        return x->size - y->size;
+    }
+    return x->header - y->header;
+}
+
+/**
+ * Finds the natural loops of a function.
+ *
+ * @param cfg Graph of the function.
+ * @param count Output for the number of loops.
+ * @return The loops ordered from the smallest, free them with licm_free_loops().
+ */
+static tLicmLoop *licm_find_loops(const tCfg *cfg, int *count)
+{
+    tLicmLoop *loops = NULL;
+    int *stack = safeMalloc(sizeof(int) * (cfg->blockCount + 1));
+    *count = 0;
+
+    for (int b = 0; b < cfg->blockCount; b++)
+    {
+        const tBasicBlock *latch = &cfg->blocks[b];
+        for (int s = 0; s < latch->succCount; s++)
+        {
+            int header = latch->succ[s];
+            if (latch->rpoIndex < 0 || !cfg_dominates(cfg, header, b))
+            {
+                continue;
+            }
+
+            tLicmLoop *loop = NULL;
+            for (int i = 0; i < *count; i++)
+            {
+                if (loops[i].header == header)
+                {
+                    loop = &loops[i];
+                }
+            }
+            if (loop == NULL)
+            {
+                loops = safeRealloc(loops, sizeof(tLicmLoop) * (*count + 1));
+                loop = &loops[(*count)++];
+                loop->header = header;
+                loop->blocks = safeMalloc(sizeof(bool) * cfg->blockCount);
+                for (int i = 0; i < cfg->blockCount; i++)
+                {
+                    loop->blocks[i] = false;
+                }
+                loop->blocks[header] = true;
+                loop->size = 1;
+            }
+
+            // Everything that reaches the latch without passing the header
+            int top = 0;
+            if (!loop->blocks[b])
+            {
+                loop->blocks[b] = true;
+                loop->size++;
+                stack[top++] = b;
+            }
+            while (top > 0)
+            {
+                const tBasicBlock *block = &cfg->blocks[stack[--top]];
+                for (int p = 0; p < block->predCount; p++)
+                {
+                    int pred = block->preds[p];
+                    if (cfg->blocks[pred].rpoIndex >= 0 && !loop->blocks[pred])
+                    {
+                        loop->blocks[pred] = true;
+                        loop->size++;
+                        stack[top++] = pred;
+                    }
+                }
+            }
+        }
+    }
+
+    free(stack);
+    if (*count > 1)
+    {
+        qsort(loops, *count, sizeof(tLicmLoop), licm_compare);
+    }
+    return loops;
+}
+
+/**
+ * Frees the loops returned by licm_find_loops().
+ *
+ * @param loops The loops.
+ * @param count Number of loops.
+ */
+static void licm_free_loops(tLicmLoop *loops, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        free(loops[i].blocks);
+    }
+    free(loops);
+}
+
+/**
+ * Finds the block the moved instructions can be appended to: the block
+ * right before the header in the listing, which falls through into it and
+ * is its only predecessor outside the loop.
+ *
+ * @param cfg Graph of the function.
+ * @param loop The loop.
+ * @return The block, or -1 if the loop has no such block.
+ */
+static int licm_preheader(const tCfg *cfg, const tLicmLoop *loop)
+{
+    int header = loop->header;
+    int preheader = header - 1;
+    if (preheader < 0 || loop->blocks[preheader] || cfg->blocks[preheader].rpoIndex < 0)
+    {
+        return -1;
+    }
+
+    bool fallsThrough = false;
+    const tBasicBlock *block = &cfg->blocks[header];
+    for (int p = 0; p < block->predCount; p++)
+    {
+        int pred = block->preds[p];
+        if (pred == preheader)
+        {
+            fallsThrough = true;
+        }
+        else if (!loop->blocks[pred] && cfg->blocks[pred].rpoIndex >= 0)
+        {
+            return -1;
+        }
+    }
+
+    // Code behind a jump would only run on the fall-through edge or not at all
+    tInstructionNode *terminator = cfg_block_terminator(&cfg->blocks[preheader]);
+    if (terminator != NULL && (cfg_is_jump(terminator->opType) ||
+                               terminator->opType == OP_RETURN || terminator->opType == OP_EXIT))
+    {
+        return -1;
+    }
+    return fallsThrough ? preheader : -1;
+}
+
+/**
+ * Moves the invariant instructions of one loop to its preheader.
+ *
+ * @param list The generated code.
+ * @param cfg Graph of the function.
+ * @param loop The loop.
+ * @param preheader Its preheader block.
+ * @param live Live variables of the function.
+ * @param types Type facts of the function.
+ * @param defCount Scratch array with an entry for every variable.
+ * @return Number of moved instructions.
+ */
+static size_t licm_loop(tThreeACList *list, tCfg *cfg, const tLicmLoop *loop, int preheader,
+                        const tDataflow *live, const tDataflow *types, int *defCount)
+{
+    for (int v = 0; v < cfg->varCount; v++)
+    {
+        defCount[v] = 0;
+    }
+
+    tBitset liveAfter;
+    bitset_init(&liveAfter, (size_t)cfg->varCount);
+    int *exiting = safeMalloc(sizeof(int) * cfg->blockCount);
+    int exitingCount = 0;
+
+    for (int i = 0; i < cfg->blockCount; i++)
+    {
+        if (!loop->blocks[i])
+        {
+            continue;
+        }
+        const tBasicBlock *block = &cfg->blocks[i];
+        for (tInstructionNode *node = block->first; node != NULL; node = node->next)
+        {
+            int def = cfg_instruction_def(cfg, node);
+            if (def >= 0)
+            {
+                defCount[def]++;
+            }
+            if (node == block->last)
+            {
+                break;
+            }
+        }
+
+        bool exits = false;
+        for (int s = 0; s < block->succCount; s++)
+        {
+            if (!loop->blocks[block->succ[s]])
+            {
+                bitset_union(&liveAfter, &live->in[block->succ[s]]);
+                exits = true;
+            }
+        }
+        if (exits)
+        {
+            exitingCount++;
+            exiting[exitingCount - 1] = i;
+        }
+    }
+
+    tBitset facts;
+    bitset_init(&facts, types->bits);
+    bitset_copy(&facts, &types->out[preheader]);
+
+    tInstructionNode *tail = cfg->blocks[preheader].last;
+    size_t moved = 0;
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = 0; i < cfg->blockCount; i++)
+        {
+            if (!loop->blocks[i])
+            {
+                continue;
+            }
+
+            tBasicBlock *block = &cfg->blocks[i];
+            bool dominatesExits = true;
+            for (int e = 0; e < exitingCount; e++)
+            {
+                dominatesExits = dominatesExits && cfg_dominates(cfg, i, exiting[e]);
+            }
+
+            tInstructionNode *node = block->first;
+            while (true)
+            {
+                tInstructionNode *next = node->next;
+                bool last = node == block->last;
+                int def = cfg_instruction_def(cfg, node);
+
+                if (def >= 0 && node->opType != OP_DEFVAR && defCount[def] == 1 &&
+                    !bitset_test(&live->in[loop->header], def) &&
+                    (dominatesExits || !bitset_test(&liveAfter, def)) &&
+                    licm_is_invariant(cfg, defCount, node->arg1) &&
+                    licm_is_invariant(cfg, defCount, node->arg2) &&
+                    licm_cannot_fail(cfg, &facts, node) && !(node == block->first && last))
+                {
+                    if (node == block->first)
+                    {
+                        block->first = next;
+                    }
+                    if (last)
+                    {
+                        block->last = node->prev;
+                    }
+                    licm_set_fact(&facts, def, licm_result_fact(cfg, &facts, node));
+                    list_move_after(list, node, node, tail);
+                    tail = node;
+                    defCount[def] = 0;
+                    moved++;
+                    changed = true;
+                }
+
+                if (last)
+                {
+                    break;
+                }
+                node = next;
+            }
+        }
+    }
+
+    bitset_dispose(&facts);
+    bitset_dispose(&liveAfter);
+    free(exiting);
+    return moved;
+}
+
+/**
+ * Moves the invariant instructions of the loops of one function. A loop is
+ * skipped when a loop inside it has changed, the next call handles it.
+ *
+ * @param list The generated code.
+ * @param cfg Graph of the function.
+ * @return Number of moved instructions.
+ */
+static size_t licm_function(tThreeACList *list, tCfg *cfg)
+{
+    int loopCount;
+    tLicmLoop *loops = licm_find_loops(cfg, &loopCount);
+    if (loopCount == 0 ||
+        (size_t)cfg->blockCount * (size_t)cfg->varCount * FACT_COUNT > LICM_MAX_BITS)
+    {
+        licm_free_loops(loops, loopCount);
+        return 0;
+    }
+
+    tDataflow live;
+    tDataflow types;
+    dataflow_liveness(&live, cfg);
+    licm_type_facts(&types, cfg);
+
+    bool *touched = safeMalloc(sizeof(bool) * cfg->blockCount);
+    int *defCount = safeMalloc(sizeof(int) * (cfg->varCount + 1));
+    for (int i = 0; i < cfg->blockCount; i++)
+    {
+        touched[i] = false;
+    }
+
+    size_t moved = 0;
+    for (int l = 0; l < loopCount; l++)
+    {
+        const tLicmLoop *loop = &loops[l];
+        bool skip = false;
+        for (int i = 0; i < cfg->blockCount && !skip; i++)
+        {
+            skip = loop->blocks[i] && touched[i];
+        }
+        int preheader = skip ? -1 : licm_preheader(cfg, loop);
+        if (preheader < 0)
+        {
+            continue;
+        }
+
+        size_t loopMoved = licm_loop(list, cfg, loop, preheader, &live, &types, defCount);
+        if (loopMoved > 0)
+        {
+            for (int i = 0; i < cfg->blockCount; i++)
+            {
+                touched[i] = touched[i] || loop->blocks[i];
+            }
+            touched[preheader] = true;
+            moved += loopMoved;
+        }
+    }
+
+    dataflow_dispose(&live);
+    dataflow_dispose(&types);
+    free(touched);
+    free(defCount);
+    licm_free_loops(loops, loopCount);
+    return moved;
+}
+
+size_t licm_run(tThreeACList *list)
+{
+    int count;
+    size_t moved = 0;
+
+    tCfg *cfgs = cfg_build_program(list, &count);
+    for (int i = 0; i < count; i++)
+    {
+        moved += licm_function(list, &cfgs[i]);
+    }
+    cfg_dispose_program(cfgs, count);
+
+    stats_rule_hits("licm", "hoisted", moved);
+    return moved;
+}
@@ -0,0 +1,44 @@
+/**
+ * @file licm.h
+ *
+ * IFJ25 project
+ *
+ * Loop-invariant code motion (-O1).
+ *
+ * Natural loops are found from the back edges of the control-flow graph.
+ * An instruction in a loop is invariant when it computes a local variable
+ * from constants and from variables the loop never assigns, or from the
+ * results of other invariant instructions. Such an instruction is moved to
+ * the preheader, the end of the block that falls through into the loop
+ * header, when
+ *  - it is the only assignment to its variable in the loop,
+ *  - the variable is not live at the header, so no read in the loop sees
+ *    the value from before the loop or from the previous iteration,
+ *  - its block dominates every exit of the loop, or the variable is dead
+ *    behind the loop,
+ *  - it cannot fail in the preheader. A forward analysis tracks which
+ *    variables are initialized and which hold a known type, e.g. STRLEN is
+ *    only moved when its operand is known to be a string.
+ * Stack instructions, calls, input and output stay where they are, and so
+ * do global variables, which a called function may change.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_LICM_H
+#define IFJ_LICM_H
+
+#include "3AC.h"
+
+#include <stddef.h>
+
+/**
+ * Moves loop-invariant instructions in front of their loops and reports
+ * them to the statistics. Nested loops are handled one level per call.
+ *
+ * @param list The generated code.
+ * @return Number of moved instructions.
+ */
+size_t licm_run(tThreeACList *list);
+
+#endif // IFJ_LICM_H
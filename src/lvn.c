@@ -0,0 +1,753 @@
+/**
+ * @file lvn.c
+ *
+ * IFJ25 project
+ *
+ * Local value numbering and copy propagation (-O2).
+ *
+ * @author agent <agent@local>
+ */
+
+#include "lvn.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "helper.h"
+#include "stats.h"
+#include "strmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Value numbers of one basic block.
+ */
+typedef struct
+{
+    const tCfg *cfg;
+    int *varValue;             // Value held by every variable, -1 if not known yet
+    int *touched;              // Variables whose value is known
+    int touchedCount;
+    int *home;                 // First variable that received each value
+    const tOperand **constant; // The constant of each value, NULL for computed values
+    int valueCount;
+    int valueCapacity;
+    tStrMap keys;              // Constants and computations to their values
+    int *stack;                // Values on the modelled data stack
+    int stackCount;
+    int stackCapacity;
+    size_t redundant;
+    size_t copies;
+} tLvnState;
+
+/**
+ * Checks whether an instruction computes its result from its arguments only.
+ *
+ * @param op Operation type.
+ * @return true for arithmetic, comparisons, conversions and string queries.
+ */
+static bool lvn_is_pure(tOperationType op)
+{
+    switch (op)
+    {
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_IDIV:
+        case OP_AND:
+        case OP_OR:
+        case OP_NOT:
+        case OP_LT:
+        case OP_GT:
+        case OP_EQ:
+        case OP_CONCAT:
+        case OP_STRLEN:
+        case OP_GETCHAR:
+        case OP_INT2FLOAT:
+        case OP_FLOAT2INT:
+        case OP_FLOAT2STR:
+        case OP_INT2CHAR:
+        case OP_STRI2INT:
+        case OP_INT2STR:
+        case OP_TYPE:
+        case OP_ISINT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Checks whether the order of the arguments of an instruction does not matter.
+ *
+ * @param op Operation type.
+ * @return true for ADD, MUL, EQ, AND and OR.
+ */
+static bool lvn_is_commutative(tOperationType op)
+{
+    return op == OP_ADD || op == OP_MUL || op == OP_EQ || op == OP_AND || op == OP_OR;
+}
+
+/**
+ * Maps a pure stack instruction to the three-address instruction computing
+ * the same value.
+ *
+ * @param op Operation type.
+ * @param arity Output for the number of popped operands.
+ * @return The three-address operation, or NO_OP if op is not a pure stack instruction.
+ */
+static tOperationType lvn_stack_equivalent(tOperationType op, int *arity)
+{
+    *arity = 2;
+    switch (op)
+    {
+        case OP_ADDS:
+            return OP_ADD;
+        case OP_SUBS:
+            return OP_SUB;
+        case OP_MULS:
+            return OP_MUL;
+        case OP_DIVS:
+            return OP_DIV;
+        case OP_IDIVS:
+            return OP_IDIV;
+        case OP_ANDS:
+            return OP_AND;
+        case OP_ORS:
+            return OP_OR;
+        case OP_LTS:
+            return OP_LT;
+        case OP_GTS:
+            return OP_GT;
+        case OP_EQS:
+            return OP_EQ;
+        case OP_STRI2INTS:
+            return OP_STRI2INT;
+        default:
+            break;
+    }
+
+    *arity = 1;
+    switch (op)
+    {
+        case OP_NOTS:
+            return OP_NOT;
+        case OP_INT2FLOATS:
+            return OP_INT2FLOAT;
+        case OP_FLOAT2INTS:
+            return OP_FLOAT2INT;
+        case OP_INT2CHARS:
+            return OP_INT2CHAR;
+        case OP_FLOAT2STRS:
+            return OP_FLOAT2STR;
+        case OP_INT2STRS:
+            return OP_INT2STR;
+        case OP_TYPES:
+            return OP_TYPE;
+        case OP_ISINTS:
+            return OP_ISINT;
+        default:
+            *arity = 0;
+            return NO_OP;
+    }
+}
+
+/**
+ * Creates a value.
+ *
+ * @param state The numbering.
+ * @param home Variable holding the value, -1 if none.
+ * @param constant The constant, NULL for computed values.
+ * @return The new value number.
+ */
+static int lvn_new_value(tLvnState *state, int home, const tOperand *constant)
+{
+    if (state->valueCount == state->valueCapacity)
+    {
+        state->valueCapacity = state->valueCapacity == 0 ? 64 : state->valueCapacity * 2;
+        state->home = safeRealloc(state->home, sizeof(int) * state->valueCapacity);
+        state->constant =
+            safeRealloc(state->constant, sizeof(tOperand *) * state->valueCapacity);
+    }
+    state->home[state->valueCount] = home;
+    state->constant[state->valueCount] = constant;
+    return state->valueCount++;
+}
+
+/**
+ * Sets the value held by a variable.
+ *
+ * @param state The numbering.
+ * @param var The variable.
+ * @param value The value.
+ */
+static void lvn_set_value(tLvnState *state, int var, int value)
+{
+    if (state->varValue[var] < 0)
+    {
+        state->touched[state->touchedCount++] = var;
+    }
+    state->varValue[var] = value;
+}
+
+/**
+ * Returns the value number of an operand, numbering it on the first read.
+ *
+ * @param state The numbering.
+ * @param operand The operand, may be NULL.
+ * @return The value, -1 for NULL. Global and TF variables get a new value
+ *         on every read.
+ */
+static int lvn_operand_value(tLvnState *state, const tOperand *operand)
+{
+    if (operand == NULL)
+    {
+        return -1;
+    }
+
+    int index = cfg_var_index(state->cfg, operand);
+    if (index >= 0)
+    {
+        if (state->varValue[index] < 0)
+        {
+            lvn_set_value(state, index, lvn_new_value(state, index, NULL));
+        }
+        return state->varValue[index];
+    }
+
+    char key[64];
+    switch (operand->type)
+    {
+        case OPP_CONST_INT:
+            snprintf(key, sizeof(key), "i%d", operand->value.intval);
+            break;
+        case OPP_CONST_FLOAT:
+            snprintf(key, sizeof(key), "f%a", operand->value.floatval);
+            break;
+        case OPP_CONST_BOOL:
+            snprintf(key, sizeof(key), "b%d", operand->value.boolval ? 1 : 0);
+            break;
+        case OPP_CONST_NIL:
+            snprintf(key, sizeof(key), "n");
+            break;
+        case OPP_CONST_STRING:
+        {
+            char *stringKey = safeMalloc(strlen(operand->value.strval) + 2);
+            sprintf(stringKey, "s%s", operand->value.strval);
+            size_t value;
+            if (!strmap_get(&state->keys, stringKey, &value))
+            {
+                value = (size_t)lvn_new_value(state, -1, operand);
+                strmap_put(&state->keys, stringKey, value);
+            }
+            free(stringKey);
+            return (int)value;
+        }
+        default:
+            return lvn_new_value(state, -1, NULL);
+    }
+
+    size_t value;
+    if (!strmap_get(&state->keys, key, &value))
+    {
+        value = (size_t)lvn_new_value(state, -1, operand);
+        strmap_put(&state->keys, key, value);
+    }
+    return (int)value;
+}
+
+/**
+ * Returns the variable that still holds a value.
+ *
+ * @param state The numbering.
+ * @param value The value.
+ * @return The variable, or -1 if it was overwritten.
+ */
+static int lvn_holder(const tLvnState *state, int value)
+{
+    int home = state->home[value];
+    return home >= 0 && state->varValue[home] == value ? home : -1;
+}
+
+/**
+ * Records an assignment of a value to a variable.
+ *
+ * @param state The numbering.
+ * @param var The variable.
+ * @param value The value.
+ */
+static void lvn_assign(tLvnState *state, int var, int value)
+{
+    lvn_set_value(state, var, value);
+    if (lvn_holder(state, value) < 0)
+    {
+        state->home[value] = var;
+    }
+}
+
+/**
+ * Creates the operand that reads a value most directly: its constant, or the
+ * variable it was first stored to.
+ *
+ * @param state The numbering.
+ * @param value The value.
+ * @param current Variable read now, -1 if the read is not a variable.
+ * @return New operand, or NULL if nothing better than current exists.
+ */
+static tOperand *lvn_representative(const tLvnState *state, int value, int current)
+{
+    const tOperand *constant = state->constant[value];
+    if (constant != NULL)
+    {
+        tOperand *copy = safeMalloc(sizeof(tOperand));
+        *copy = *constant;
+        if (constant->type == OPP_CONST_STRING)
+        {
+            copy->value.strval = safeMalloc(strlen(constant->value.strval) + 1);
+            strcpy(copy->value.strval, constant->value.strval);
+        }
+        return copy;
+    }
+
+    int holder = lvn_holder(state, value);
+    if (holder < 0 || holder == current)
+    {
+        return NULL;
+    }
+    return create_operand_from_variable(state->cfg->varNames[holder], false);
+}
+
+/**
+ * Redirects a read of a local variable holding a copy to the origin of the value.
+ *
+ * @param state The numbering.
+ * @param operand The read operand, replaced in place.
+ */
+static void lvn_rewrite_read(tLvnState *state, tOperand **operand)
+{
+    int index = cfg_var_index(state->cfg, *operand);
+    if (index < 0)
+    {
+        return;
+    }
+    tOperand *representative =
+        lvn_representative(state, lvn_operand_value(state, *operand), index);
+    if (representative != NULL)
+    {
+        *operand = representative;
+        state->copies++;
+    }
+}
+
+/**
+ * Returns the value of a computation, numbering it if it is new.
+ *
+ * @param state The numbering.
+ * @param op The three-address operation.
+ * @param a Value of the first argument.
+ * @param b Value of the second argument, -1 if none.
+ * @param known Output, true if the computation was numbered before.
+ * @return The value.
+ */
+static int lvn_computation(tLvnState *state, tOperationType op, int a, int b, bool *known)
+{
+    if (lvn_is_commutative(op) && b >= 0 && b < a)
+    {
+        int swap = a;
+        a = b;
+        b = swap;
+    }
+
+    char key[48];
+    snprintf(key, sizeof(key), "%d:%d:%d", (int)op, a, b);
+    size_t value;
+    *known = strmap_get(&state->keys, key, &value);
+    if (!*known)
+    {
+        value = (size_t)lvn_new_value(state, -1, NULL);
+        strmap_put(&state->keys, key, value);
+    }
+    return (int)value;
+}
+
+/**
+ * Pushes a value on the modelled data stack.
+ *
+ * @param state The numbering.
+ * @param value The value.
+ */
+static void lvn_push(tLvnState *state, int value)
+{
+    if (state->stackCount == state->stackCapacity)
+    {
+        state->stackCapacity = state->stackCapacity == 0 ? 16 : state->stackCapacity * 2;
+        state->stack = safeRealloc(state->stack, sizeof(int) * state->stackCapacity);
+    }
+    state->stack[state->stackCount++] = value;
+}
+
+/**
+ * Pops a value from the modelled data stack.
+ *
+ * @param state The numbering.
+ * @return The value, or a new one if it was pushed before the block.
+ */
+static int lvn_pop(tLvnState *state)
+{
+    if (state->stackCount == 0)
+    {
+        return lvn_new_value(state, -1, NULL);
+    }
+    return state->stack[--state->stackCount];
+}
+
+/**
+ * Removes an instruction from a block. The only instruction of a block is kept.
+ *
+ * @param list The generated code.
+ * @param block The block.
+ * @param node The instruction.
+ * @return true if the instruction was removed.
+ */
+static bool lvn_remove(tThreeACList *list, tBasicBlock *block, tInstructionNode *node)
+{
+    if (node == block->first && node == block->last)
+    {
+        return false;
+    }
+    if (node == block->first)
+    {
+        block->first = node->next;
+    }
+    if (node == block->last)
+    {
+        block->last = node->prev;
+    }
+    list_remove(list, node);
+    return true;
+}
+
+/**
+ * Forgets the values of all local variables, e.g. when the frame changes.
+ *
+ * @param state The numbering.
+ */
+static void lvn_forget_vars(tLvnState *state)
+{
+    for (int i = 0; i < state->touchedCount; i++)
+    {
+        state->varValue[state->touched[i]] = -1;
+    }
+    state->touchedCount = 0;
+}
+
+/**
+ * Numbers the values of one block and replaces repeated computations.
+ *
+ * @param list The generated code.
+ * @param state The numbering, reset by this function.
+ * @param block The block.
+ */
+static void lvn_block(tThreeACList *list, tLvnState *state, tBasicBlock *block)
+{
+    lvn_forget_vars(state);
+    state->valueCount = 0;
+    state->stackCount = 0;
+    strmap_clear(&state->keys);
+
+    tInstructionNode *node = block->first;
+    while (node != NULL)
+    {
+        tInstructionNode *next = node->next;
+        bool last = node == block->last;
+        tOperationType op = node->opType;
+        int result = cfg_var_index(state->cfg, node->result);
+
+        if (op != OP_DEFVAR)
+        {
+            if (node->arg1 != NULL)
+            {
+                lvn_rewrite_read(state, &node->arg1);
+            }
+            if (node->arg2 != NULL)
+            {
+                lvn_rewrite_read(state, &node->arg2);
+            }
+            if (cfg_reads_result(op) && op != OP_SETCHAR)
+            {
+                lvn_rewrite_read(state, &node->result);
+            }
+        }
+
+        int arity;
+        tOperationType stackOp = lvn_stack_equivalent(op, &arity);
+        if (op == OP_MOVE)
+        {
+            int value = lvn_operand_value(state, node->arg1);
+            if (result >= 0 && state->varValue[result] == value && lvn_remove(list, block, node))
+            {
+                state->redundant++;
+            }
+            else if (result >= 0)
+            {
+                lvn_assign(state, result, value);
+            }
+        }
+        else if (lvn_is_pure(op))
+        {
+            bool known;
+            int value = lvn_computation(state, op, lvn_operand_value(state, node->arg1),
+                                        lvn_operand_value(state, node->arg2), &known);
+            tOperand *representative = known ? lvn_representative(state, value, -1) : NULL;
+            if (result >= 0 && known && lvn_holder(state, value) == result &&
+                state->constant[value] == NULL && lvn_remove(list, block, node))
+            {
+                state->redundant++;
+            }
+            else if (representative != NULL)
+            {
+                // The same computation on the same values ran before in this block
+                node->opType = OP_MOVE;
+                node->arg1 = representative;
+                node->arg2 = NULL;
+                state->redundant++;
+            }
+            if (result >= 0)
+            {
+                lvn_assign(state, result, value);
+            }
+        }
+        else if (op == OP_PUSHS)
+        {
+            lvn_push(state, lvn_operand_value(state, node->result));
+        }
+        else if (op == OP_POPS)
+        {
+            int value = lvn_pop(state);
+            if (result >= 0)
+            {
+                lvn_assign(state, result, value);
+            }
+        }
+        else if (stackOp != NO_OP)
+        {
+            int b = arity == 2 ? lvn_pop(state) : -1;
+            int a = lvn_pop(state);
+            bool known;
+            lvn_push(state, lvn_computation(state, stackOp, a, b, &known));
+        }
+        else if (op == OP_JUMPIFEQS || op == OP_JUMPIFNEQS)
+        {
+            lvn_pop(state);
+            lvn_pop(state);
+        }
+        else if (op == OP_CALL)
+        {
+            // The callee may leave anything on the data stack
+            state->stackCount = 0;
+        }
+        else if (op == OP_PUSHFRAME || op == OP_POPFRAME)
+        {
+            lvn_forget_vars(state);
+        }
+        else if (result >= 0 && cfg_writes_result(op))
+        {
+            lvn_set_value(state, result, lvn_new_value(state, result, NULL));
+        }
+
+        if (last)
+        {
+            break;
+        }
+        node = next;
+    }
+}
+
+/**
+ * Computes which variables have been assigned on every path to the start
+ * and the end of every block.
+ *
+ * @param df The problem, initialized by this function.
+ * @param cfg Graph of the function.
+ */
+static void lvn_assigned(tDataflow *df, const tCfg *cfg)
+{
+    dataflow_init(df, cfg, DATAFLOW_FORWARD, DATAFLOW_INTERSECT, (size_t)cfg->varCount);
+    for (int i = 0; i < cfg->blockCount; i++)
+    {
+        const tBasicBlock *block = &cfg->blocks[i];
+        for (tInstructionNode *node = block->first; node != NULL; node = node->next)
+        {
+            int def = cfg_instruction_def(cfg, node);
+            if (def >= 0 && node->opType != OP_DEFVAR)
+            {
+                bitset_set(&df->gen[i], def);
+            }
+            if (node == block->last)
+            {
+                break;
+            }
+        }
+    }
+    dataflow_solve(df, cfg);
+}
+
+/**
+ * Removes the copies to local variables that are not read afterwards.
+ *
+ * @param list The generated code.
+ * @param cfg Graph of the function.
+ * @return Number of removed instructions.
+ */
+static size_t lvn_remove_dead_copies(tThreeACList *list, tCfg *cfg)
+{
+    tDataflow live;
+    tDataflow assigned;
+    dataflow_liveness(&live, cfg);
+    lvn_assigned(&assigned, cfg);
+
+    tBitset set;
+    bitset_init(&set, (size_t)cfg->varCount);
+    tInstructionNode **candidates = NULL;
+    size_t candidateCapacity = 0;
+    size_t removed = 0;
+
+    for (int i = 0; i < cfg->blockCount; i++)
+    {
+        tBasicBlock *block = &cfg->blocks[i];
+        if (block->rpoIndex < 0)
+        {
+            continue;
+        }
+
+        // A copy of a variable that may be uninitialized fails, so it stays
+        size_t candidateCount = 0;
+        bitset_copy(&set, &assigned.in[i]);
+        for (tInstructionNode *node = block->first; node != NULL; node = node->next)
+        {
+            int source = cfg_var_index(cfg, node->arg1);
+            if (node->opType == OP_MOVE && cfg_var_index(cfg, node->result) >= 0 &&
+                (source >= 0 ? bitset_test(&set, source)
+                             : node->arg1->type >= OPP_CONST_INT &&
+                                   node->arg1->type <= OPP_CONST_NIL))
+            {
+                if (candidateCount == candidateCapacity)
+                {
+                    candidateCapacity = candidateCapacity == 0 ? 16 : candidateCapacity * 2;
+                    candidates =
+                        safeRealloc(candidates, sizeof(tInstructionNode *) * candidateCapacity);
+                }
+                candidates[candidateCount++] = node;
+            }
+            int def = cfg_instruction_def(cfg, node);
+            if (def >= 0 && node->opType != OP_DEFVAR)
+            {
+                bitset_set(&set, def);
+            }
+            if (node == block->last)
+            {
+                break;
+            }
+        }
+        if (candidateCount == 0)
+        {
+            continue;
+        }
+
+        bitset_copy(&set, &live.out[i]);
+        tInstructionNode *node = block->last;
+        while (node != NULL)
+        {
+            tInstructionNode *prev = node->prev;
+            bool first = node == block->first;
+            int def = cfg_instruction_def(cfg, node);
+
+            if (candidateCount > 0 && candidates[candidateCount - 1] == node)
+            {
+                candidateCount--;
+                if (!bitset_test(&set, def) && lvn_remove(list, block, node))
+                {
+                    removed++;
+                    node = first ? NULL : prev;
+                    continue;
+                }
+            }
+
+            if (def >= 0)
+            {
+                bitset_clear(&set, def);
+            }
+            int uses[3];
+            int useCount = cfg_instruction_uses(cfg, node, uses);
+            for (int u = 0; u < useCount; u++)
+            {
+                bitset_set(&set, uses[u]);
+            }
+            node = first ? NULL : prev;
+        }
+    }
+
+    free(candidates);
+    bitset_dispose(&set);
+    dataflow_dispose(&live);
+    dataflow_dispose(&assigned);
+    return removed;
+}
+
+size_t lvn_run(tThreeACList *list)
+{
+    int count;
+    tLvnState state;
+    state.home = NULL;
+    state.constant = NULL;
+    state.valueCapacity = 0;
+    state.stack = NULL;
+    state.stackCapacity = 0;
+    state.redundant = 0;
+    state.copies = 0;
+    strmap_init(&state.keys);
+
+    size_t deadCopies = 0;
+    size_t changed = 0;
+    tCfg *cfgs = cfg_build_program(list, &count);
+    for (int i = 0; i < count; i++)
+    {
+        tCfg *cfg = &cfgs[i];
+        state.cfg = cfg;
+        state.varValue = safeMalloc(sizeof(int) * (cfg->varCount + 1));
+        state.touched = safeMalloc(sizeof(int) * (cfg->varCount + 1));
+        state.touchedCount = cfg->varCount;
+        for (int v = 0; v < cfg->varCount; v++)
+        {
+            state.touched[v] = v;
+        }
+        for (int b = 0; b < cfg->blockCount; b++)
+        {
+            if (cfg->blocks[b].rpoIndex >= 0)
+            {
+                lvn_block(list, &state, &cfg->blocks[b]);
+            }
+        }
+        free(state.varValue);
+        free(state.touched);
+
+        // Only the rewritten functions can have gained dead copies
+        if (state.redundant + state.copies > changed)
+        {
+            deadCopies += lvn_remove_dead_copies(list, cfg);
+        }
+        changed = state.redundant + state.copies;
+    }
+    cfg_dispose_program(cfgs, count);
+
+    strmap_dispose(&state.keys);
+    free(state.home);
+    free(state.constant);
+    free(state.stack);
+
+    stats_rule_hits("lvn", "redundant", state.redundant);
+    stats_rule_hits("lvn", "copy-propagated", state.copies);
+    stats_rule_hits("lvn", "dead-copy", deadCopies);
+    return state.redundant + state.copies + deadCopies;
+}
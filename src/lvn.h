@@ -0,0 +1,40 @@
+/**
+ * @file lvn.h
+ *
+ * IFJ25 project
+ *
+ * Local value numbering and copy propagation (-O2).
+ *
+ * Every basic block is walked once. Each value a local variable, constant or
+ * computation holds gets a number. The operands of pure instructions and of
+ * the pure stack instructions, tracked on a model of the data stack, form a
+ * key for the number of the result. When a key repeats in the same block,
+ * the computation is replaced by a MOVE from the variable that still holds
+ * the earlier result. The earlier computation ran without failing, so the
+ * same computation on the same values cannot fail either. Reads of a
+ * variable that holds a copy, after MOVE or PUSHS/POPS, are redirected to
+ * the constant or the variable the value came from. Copies that are then
+ * never read are removed, unless the copied variable may be uninitialized,
+ * in which case the MOVE is what fails.
+ * Global and TF variables are read anew every time.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_LVN_H
+#define IFJ_LVN_H
+
+#include "3AC.h"
+
+#include <stddef.h>
+
+/**
+ * Numbers the values of every basic block, removes redundant computations
+ * and dead copies, and reports them to the statistics.
+ *
+ * @param list The generated code.
+ * @return Number of changed or removed instructions.
+ */
+size_t lvn_run(tThreeACList *list);
+
+#endif // IFJ_LVN_H
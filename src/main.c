@@ -9,54 +9,382 @@
  */
 
 #include "3AC.h"
+#include "3AC_patterns.h"
+#include "cfg.h"
 #include "error.h"
+#include "ir_serialize.h"
 #include "parser.h"
+#include "passes.h"
+#include "specialize.h"
+#include "stats.h"
+#include "timing.h"
+#include "typeinfer.h"
 
 #include <stdio.h>
+#include <string.h>
 
 // Global 3AC code list
 tThreeACList threeACcode;
 
+/**
+ * Prints the command line usage to stderr.
+ *
+ * @param program Name of the executable.
+ */
+static void print_usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [options] [<source_file>]\n", program);
+    fprintf(stderr, "       %s [options] --load-ir <file>\n", program);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -O0, -O1, -O2            optimization level (default -O0)\n");
+    fprintf(stderr, "  -Os                      -O1 with generic operators and built-ins called\n");
+    fprintf(stderr, "                           as shared subroutines, for smaller code\n");
+    fprintf(stderr, "  --passes=<list>          run these passes instead of the level's, e.g.\n");
+    fprintf(stderr, "                           'inline,tailcall,[peephole,dce,licm],tempalloc'\n");
+    fprintf(stderr, "                           (a bracketed group repeats until nothing changes)\n");
+    fprintf(stderr, "  --verify-ir              check the code after the front end and every pass\n");
+    fprintf(stderr, "  --codegen=stack|regs     evaluate expressions on the data stack (default)\n");
+    fprintf(stderr, "                           or with three-address code on temporaries\n");
+    fprintf(stderr, "  --emit-ir <file>         store the generated code as binary IR\n");
+    fprintf(stderr, "  --dump-cfg               print basic blocks and dominators to stderr\n");
+    fprintf(stderr, "  --stats[=<file>]         write generated code statistics as JSON\n");
+    fprintf(stderr, "                           (to stderr when no file is given)\n");
+    fprintf(stderr, "  --time-report[=json]     print compile time per phase to stderr\n");
+}
+
+/**
+ * Returns the value of an option given either as "--name=value" or "--name value".
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @param index Index of the option, advanced when the value is a separate argument.
+ * @param name Option name including the leading dashes.
+ * @return The value, or NULL if the argument is not this option or the value is missing.
+ */
+static const char *option_value(int argc, char *argv[], int *index, const char *name)
+{
+    size_t nameLen = strlen(name);
+    if (strncmp(argv[*index], name, nameLen) != 0)
+    {
+        return NULL;
+    }
+    if (argv[*index][nameLen] == '=')
+    {
+        return argv[*index] + nameLen + 1;
+    }
+    if (argv[*index][nameLen] == '\0' && *index + 1 < argc)
+    {
+        return argv[++*index];
+    }
+    return NULL;
+}
+
+/**
+ * Runs the optimization pipeline.
+ *
+ * @param list The generated code.
+ * @param pipeline The passes, empty leaves the code as generated.
+ * @param verify Check the code before and after every pass.
+ * @return 0, or INTERNAL_ERROR if the verification failed.
+ */
+static int optimize(tThreeACList *list, const tPipeline *pipeline, bool verify)
+{
+    if (pipeline->count == 0 && !verify)
+    {
+        return 0;
+    }
+
+    TIMING_BEGIN(PHASE_OPTIMIZE);
+    int result = passes_run(list, pipeline, verify);
+    TIMING_END(PHASE_OPTIMIZE);
+    return result;
+}
+
+/**
+ * Prints the control-flow graph of every function to stderr.
+ *
+ * @param list The generated code.
+ */
+static void dump_cfg(tThreeACList *list)
+{
+    int count;
+    tCfg *cfgs = cfg_build_program(list, &count);
+
+    fflush(stdout);
+    for (int i = 0; i < count; i++)
+    {
+        cfg_dump(&cfgs[i], stderr);
+    }
+    cfg_dispose_program(cfgs, count);
+}
+
+/**
+ * Writes the generated code statistics if they were requested.
+ *
+ * @param statsPath Output file, "-" for stderr, or NULL if --stats was not given.
+ * @return 0 on success, INTERNAL_ERROR if the file cannot be written.
+ */
+static int report_stats(const char *statsPath)
+{
+    if (statsPath == NULL)
+    {
+        return 0;
+    }
+
+    int result = 0;
+    if (strcmp(statsPath, "-") == 0)
+    {
+        fflush(stdout);
+        stats_report(&threeACcode, stderr);
+    }
+    else
+    {
+        FILE *out = fopen(statsPath, "w");
+        if (out == NULL)
+        {
+            fprintf(stderr, "Error: Cannot open file '%s'\n", statsPath);
+            result = INTERNAL_ERROR;
+        }
+        else
+        {
+            stats_report(&threeACcode, out);
+            fclose(out);
+        }
+    }
+    stats_dispose();
+    return result;
+}
+
+/**
+ * Prints the time report to stderr if it was requested.
+ *
+ * @param enabled Whether --time-report was given.
+ * @param json Whether the JSON format was requested.
+ */
+static void report_timing(bool enabled, bool json)
+{
+#ifdef IFJ_INSTRUMENT
+    if (enabled)
+    {
+        fflush(stdout);
+        timing_report(stderr, json);
+    }
+#else
+    (void)enabled;
+    (void)json;
+#endif
+}
+
 int main(int argc, char *argv[])
 {
     FILE *file = NULL;
+    const char *sourcePath = NULL;
+    const char *emitIrPath = NULL;
+    const char *loadIrPath = NULL;
+    const char *statsPath = NULL;
+    bool dumpCfg = false;
+    bool timeReport = false;
+    bool timeReportJson = false;
+    bool verifyIr = false;
+    const char *passesSpec = NULL;
+    int optLevel = 0;
 
-    if (argc == 1)
+    for (int i = 1; i < argc; i++)
+    {
+        const char *value;
+        if ((value = option_value(argc, argv, &i, "--emit-ir")) != NULL)
+        {
+            emitIrPath = value;
+        }
+        else if ((value = option_value(argc, argv, &i, "--load-ir")) != NULL)
+        {
+            loadIrPath = value;
+        }
+        else if ((value = option_value(argc, argv, &i, "--codegen")) != NULL)
+        {
+            if (strcmp(value, "stack") == 0)
+            {
+                codegenMode = CODEGEN_STACK;
+            }
+            else if (strcmp(value, "regs") == 0)
+            {
+                codegenMode = CODEGEN_REGS;
+            }
+            else
+            {
+                print_usage(argv[0]);
+                return INTERNAL_ERROR;
+            }
+        }
+        else if (strcmp(argv[i], "-O0") == 0 || strcmp(argv[i], "-O1") == 0 ||
+                 strcmp(argv[i], "-O2") == 0)
+        {
+            optLevel = argv[i][2] - '0';
+            sharedHelpers = false;
+        }
+        else if (strcmp(argv[i], "-Os") == 0)
+        {
+            optLevel = 1;
+            sharedHelpers = true;
+        }
+        else if (strncmp(argv[i], "--passes=", strlen("--passes=")) == 0)
+        {
+            passesSpec = argv[i] + strlen("--passes=");
+        }
+        else if (strcmp(argv[i], "--verify-ir") == 0)
+        {
+            verifyIr = true;
+        }
+        else if (strcmp(argv[i], "--dump-cfg") == 0)
+        {
+            dumpCfg = true;
+        }
+        else if (strcmp(argv[i], "--stats") == 0)
+        {
+            statsPath = "-";
+        }
+        else if (strncmp(argv[i], "--stats=", strlen("--stats=")) == 0)
+        {
+            statsPath = argv[i] + strlen("--stats=");
+        }
+        else if (strcmp(argv[i], "--time-report") == 0 ||
+                 strcmp(argv[i], "--time-report=text") == 0 ||
+                 strcmp(argv[i], "--time-report=json") == 0)
+        {
+            timeReport = true;
+            timeReportJson = strcmp(argv[i], "--time-report=json") == 0;
+        }
+        else if (argv[i][0] != '-' && sourcePath == NULL)
+        {
+            sourcePath = argv[i];
+        }
+        else
+        {
+            // Unknown option or more than one source file
+            print_usage(argv[0]);
+            return INTERNAL_ERROR;
+        }
+    }
+
+    // Copies of functions cost size, so -Os keeps only the generic ones
+    specializeFunctions = optLevel >= 1 && !sharedHelpers;
+    typeCallResults = optLevel >= 1;
+
+    tPipeline pipeline;
+    if (passesSpec == NULL)
+    {
+        passes_preset(&pipeline, optLevel, sharedHelpers);
+    }
+    else if (!passes_parse(&pipeline, passesSpec))
+    {
+        print_usage(argv[0]);
+        return INTERNAL_ERROR;
+    }
+
+    if (timeReport)
+    {
+#ifdef IFJ_INSTRUMENT
+        timing_enable();
+#else
+        fprintf(stderr, "Warning: built without IFJ_INSTRUMENT, --time-report is ignored\n");
+        timeReport = false;
+#endif
+    }
+
+    if (statsPath != NULL)
+    {
+        stats_enable();
+    }
+
+    list_init(&threeACcode);
+
+    if (loadIrPath != NULL)
+    {
+        // Re-emit a previously compiled program without touching the source
+        if (sourcePath != NULL || emitIrPath != NULL)
+        {
+            print_usage(argv[0]);
+            return INTERNAL_ERROR;
+        }
+
+        TIMING_BEGIN(PHASE_IR_IO);
+        int result = ir_load_file(loadIrPath, &threeACcode);
+        TIMING_END(PHASE_IR_IO);
+        if (result == 0)
+        {
+            result = optimize(&threeACcode, &pipeline, verifyIr);
+        }
+        if (result == 0 && dumpCfg)
+        {
+            dump_cfg(&threeACcode);
+        }
+        if (result == 0)
+        {
+            result = report_stats(statsPath);
+        }
+        if (result == 0)
+        {
+            TIMING_BEGIN(PHASE_PRINT);
+            list_print(&threeACcode);
+            TIMING_END(PHASE_PRINT);
+        }
+        list_dispose(&threeACcode);
+        report_timing(timeReport, timeReportJson);
+        return result;
+    }
+
+    if (sourcePath == NULL)
     {
         // No file argument, read from standard input
         file = stdin;
     }
-    else if (argc == 2)
+    else
     {
         // File argument provided, open the file
-        file = fopen(argv[1], "r");
+        file = fopen(sourcePath, "r");
         if (file == NULL)
         {
-            fprintf(stderr, "Error: Cannot open file '%s'\n", argv[1]);
+            fprintf(stderr, "Error: Cannot open file '%s'\n", sourcePath);
             return INTERNAL_ERROR;
         }
     }
-    else
-    {
-        // Wrong number of arguments
-        fprintf(stderr, "Usage: %s [<source_file>]\n", argv[0]);
-        return INTERNAL_ERROR;
-    }
 
-    list_init(&threeACcode);
+    TIMING_BEGIN(PHASE_PARSE);
     int result = parse_program(file);
+    TIMING_END(PHASE_PARSE);
 
     // Only close the file if it was opened by fopen
-    if (argc == 2)
+    if (sourcePath != NULL)
     {
         fclose(file);
     }
 
     if (result == 0)
     {
-        list_print(&threeACcode);
+        result = optimize(&threeACcode, &pipeline, verifyIr);
+        if (result == 0 && emitIrPath != NULL)
+        {
+            TIMING_BEGIN(PHASE_IR_IO);
+            result = ir_write_file(&threeACcode, emitIrPath);
+            TIMING_END(PHASE_IR_IO);
+        }
+        if (result == 0 && dumpCfg)
+        {
+            dump_cfg(&threeACcode);
+        }
+        if (result == 0)
+        {
+            result = report_stats(statsPath);
+        }
+        if (result == 0)
+        {
+            TIMING_BEGIN(PHASE_PRINT);
+            list_print(&threeACcode);
+            TIMING_END(PHASE_PRINT);
+        }
         list_dispose(&threeACcode);
     }
 
+    report_timing(timeReport, timeReportJson);
     return result;
 }
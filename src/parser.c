@@ -11,6 +11,12 @@
 #include "3AC_patterns.h"
 #include "parser.h"
 #include "scanner.h"
+#include "specialize.h"
+#include "stats.h"
+#include "timing.h"
+#include "typeinfer.h"
+
+#include <limits.h>
 
 static tToken peek_buffer = NULL;
 
@@ -29,11 +35,127 @@ static tBuiltinDef builtin_defs[] = {
 
 tSymTable *global_symtable = NULL;
 
+// Tokens of the function body being recorded for specialization
+static tToken *recordedTokens = NULL;
+static size_t recordedCount = 0;
+static size_t recordedCapacity = 0;
+static bool recording = false;
+
+// Recorded tokens read instead of the input while a clone is parsed
+static tToken *replayTokens = NULL;
+static size_t replayCount = 0;
+static size_t replayPosition = 0;
+static bool replaying = false;
+static tToken replaySavedPeek = NULL;
+
+/**
+ * Copies a token together with its data.
+ *
+ * @param token The token.
+ * @return The copy.
+ */
+static tToken parser_copy_token(tToken token)
+{
+    tToken copy = safeMalloc(sizeof(struct Token));
+    *copy = *token;
+    copy->prevToken = NULL;
+    copy->nextToken = NULL;
+    if (token->data != NULL)
+    {
+        copy->data = safeMalloc(strlen(token->data) + 1);
+        strcpy(copy->data, token->data);
+    }
+    return copy;
+}
+
+/**
+ * Appends a copy of a token to the recording.
+ *
+ * @param token The token.
+ */
+static void parser_record_token(tToken token)
+{
+    if (recordedCount == recordedCapacity)
+    {
+        recordedCapacity = recordedCapacity == 0 ? 64 : recordedCapacity * 2;
+        recordedTokens = safeRealloc(recordedTokens, sizeof(tToken) * recordedCapacity);
+    }
+    recordedTokens[recordedCount++] = parser_copy_token(token);
+}
+
+/**
+ * Reads the next token from the input or from the replayed recording.
+ *
+ * @param file The input file stream.
+ * @param token Output for the token.
+ * @return 0 on success, the scanner's error code otherwise.
+ */
+static int parser_lex(FILE *file, tToken *token)
+{
+    if (replaying)
+    {
+        // The recording ends with the tokens read after the closing brace
+        size_t index = replayPosition < replayCount ? replayPosition++ : replayCount - 1;
+        *token = parser_copy_token(replayTokens[index]);
+        return 0;
+    }
+
+    TIMING_BEGIN(PHASE_LEX);
+    int lexResult = getToken(file, token);
+    TIMING_END(PHASE_LEX);
+    if (lexResult == 0 && recording)
+    {
+        parser_record_token(*token);
+    }
+    return lexResult;
+}
+
+void parser_record_begin(tToken current)
+{
+    recordedTokens = NULL;
+    recordedCount = recordedCapacity = 0;
+    recording = true;
+    parser_record_token(current);
+    if (peek_buffer != NULL)
+    {
+        parser_record_token(peek_buffer);
+    }
+}
+
+tToken *parser_record_end(size_t *count)
+{
+    recording = false;
+    *count = recordedCount;
+    return recordedTokens;
+}
+
+void parser_replay_begin(tToken *tokens, size_t count)
+{
+    replayTokens = tokens;
+    replayCount = count;
+    replayPosition = 0;
+    replaying = true;
+    replaySavedPeek = peek_buffer;
+    peek_buffer = NULL;
+}
+
+void parser_replay_end(void)
+{
+    replaying = false;
+    if (peek_buffer != NULL)
+    {
+        freeToken(&peek_buffer);
+    }
+    peek_buffer = replaySavedPeek;
+    replaySavedPeek = NULL;
+}
+
 tToken peek_token(FILE *file)
 {
     if (peek_buffer == NULL)
     {
-        if (getToken(file, &peek_buffer) != 0)
+        int lexResult = parser_lex(file, &peek_buffer);
+        if (lexResult != 0)
         {
             fprintf(stderr, "[PARSER] LexicalError:%d:%d: Failed to get next token.\n",
                     peek_buffer->linePos, peek_buffer->colPos);
@@ -58,7 +180,8 @@ void get_next_token(FILE *file, tToken *currentToken)
         return;
     }
 
-    if (getToken(file, currentToken) != 0)
+    int lexResult = parser_lex(file, currentToken);
+    if (lexResult != 0)
     {
         fprintf(stderr, "[PARSER] LexicalError:%d:%d: Failed to get next token.\n",
                 (*currentToken)->linePos, (*currentToken)->colPos);
@@ -145,9 +268,16 @@ int parse_program(FILE *file)
     expect_and_consume(T_EOF, &currentToken, file, false, NULL);
 
     check_undefined_functions();
+    if (specializeFunctions)
+    {
+        specialize_run(&stack);
+    }
+    store_return_types(global_symtable->root);
+    generate_shared_helpers();
 
     parser_dispose_stack(&stack);
     freeToken(&currentToken);
+    typeinfer_dispose();
 
     return 0;
 }
@@ -292,48 +422,14 @@ void parse_function_declaration(FILE *file, tToken *currentToken, tSymTableStack
     char *mangledName = safeMalloc(mangledLen);
     sprintf(mangledName, "%s$%d%%func", funcName, paramCount);
 
-    tOperand *labelOp = safeMalloc(sizeof(tOperand));
-    labelOp->type = OPP_LABEL;
-    labelOp->value.label = mangledName;
-    char *commentText = safeMalloc(strlen(funcName) + 25);
-    sprintf(commentText, "####################");
-    emit_comment(commentText, &threeACcode);
-    sprintf(commentText, "Function declaration: %s", funcName);
-    emit_comment(commentText, &threeACcode);
-    sprintf(commentText, "####################");
-    emit_comment(commentText, &threeACcode);
-    free(commentText);
-    emit(OP_LABEL, labelOp, NULL, NULL, &threeACcode);
-
-    tOperand *retvalDef = create_operand_from_variable("%retval", false);
-    emit(OP_DEFVAR, retvalDef, NULL, NULL, &threeACcode);
-    tOperand *retvalInit = create_operand_from_variable("%retval", false);
-    tOperand *nilOp = create_operand_from_constant_nil();
-    emit(OP_MOVE, retvalInit, nilOp, NULL, &threeACcode);
-
-    tSymTable *funcScopeTable = symtable_stack_top(stack);
-
-    for (int i = 0; i < paramCount; i++)
+    tInstructionNode *prologueEnd = generate_function_prologue(
+        funcName, mangledName, symtable_stack_top(stack), paramNames, paramCount);
+    tInstructionNode *functionStart = prologueEnd;
+    while (functionStart->opType != OP_LABEL)
     {
-        tSymbolData *paramData = symtable_find(funcScopeTable, paramNames[i]);
-        tOperand *paramOp = create_operand_from_variable(paramData->unique_name, false);
-        emit(OP_DEFVAR, paramOp, NULL, NULL, &threeACcode);
-    }
-
-    for (int i = 0; i < paramCount; i++)
-    {
-        char tempParamName[20];
-        sprintf(tempParamName, "%%param%d", i);
-
-        tSymbolData *paramData = symtable_find(funcScopeTable, paramNames[i]);
-
-        tOperand *dest = create_operand_from_variable(paramData->unique_name, false);
-        tOperand *src = create_operand_from_variable(tempParamName, false);
-        emit(OP_MOVE, dest, src, NULL, &threeACcode);
+        functionStart = functionStart->prev;
     }
-
-    emit(NO_OP, NULL, NULL, NULL, &threeACcode);
-    threeACcode.tempCounter = 0;
+    free(mangledName);
 
     expect_and_consume(T_RIGHT_PAREN, currentToken, file, false, NULL);
 
@@ -399,7 +495,19 @@ void parse_function_declaration(FILE *file, tToken *currentToken, tSymTableStack
         }
     }
 
+    // Specialized copies of the function are parsed again from its tokens
+    bool recordBody = specializeFunctions && paramCount > 0;
+    if (recordBody)
+    {
+        parser_record_begin(*currentToken);
+    }
+
+    typeinfer_function_begin();
     parse_block(file, currentToken, stack, true);
+    typeinfer_function_end(key);
+
+    size_t tokenCount = 0;
+    tToken *tokens = recordBody ? parser_record_end(&tokenCount) : NULL;
 
     tSymbolData *justDefined = symtable_find(global_symtable, key);
     if (justDefined != NULL)
@@ -411,13 +519,15 @@ void parse_function_declaration(FILE *file, tToken *currentToken, tSymTableStack
     symtable_stack_pop(stack);
     symtable_free(poppedSymtable);
     free(poppedSymtable);
+
+    generate_function_epilogue(prologueEnd);
+    if (recordBody)
+    {
+        specialize_define(key, funcName, paramNames, paramCount, tokens, tokenCount,
+                          functionStart, threeACcode.active);
+    }
     free(funcName);
     free(key);
-
-    // For space bettween instructions
-    emit(OP_RETURN, NULL, NULL, NULL, &threeACcode);
-    emit(NO_OP, NULL, NULL, NULL, &threeACcode);
-    emit(NO_OP, NULL, NULL, NULL, &threeACcode);
 }
 
 void parse_getter(FILE *file, tToken *currentToken, tSymTableStack *stack, char *funcName)
@@ -478,8 +588,12 @@ void parse_getter(FILE *file, tToken *currentToken, tSymTableStack *stack, char
     tOperand *retvalInit = create_operand_from_variable("%retval", false);
     tOperand *nilOp = create_operand_from_constant_nil();
     emit(OP_MOVE, retvalInit, nilOp, NULL, &threeACcode);
+    tInstructionNode *prologueEnd = threeACcode.active;
 
+    typeinfer_function_begin();
     parse_block(file, currentToken, stack, true);
+    // Also ends a getter without a return statement, which gives null
+    generate_function_epilogue(prologueEnd);
     tSymbolData *definedGetter = symtable_find(global_symtable, key);
 
     if (definedGetter)
@@ -583,7 +697,9 @@ void parse_setter(FILE *file, tToken *currentToken, tSymTableStack *stack, char
     tOperand *setterParamSrc = create_operand_from_variable("%param0", false);
     emit(OP_DEFVAR, setterParamDest, NULL, NULL, &threeACcode);
     emit(OP_MOVE, setterParamDest, setterParamSrc, NULL, &threeACcode);
+    tInstructionNode *prologueEnd = threeACcode.active;
 
+    typeinfer_function_begin();
     parse_block(file, currentToken, stack, true);
 
     tSymbolData *definedSetter = symtable_find(global_symtable, key);
@@ -597,6 +713,8 @@ void parse_setter(FILE *file, tToken *currentToken, tSymTableStack *stack, char
     free(setterSymtable);
     free(key);
     emit(OP_RETURN, NULL, NULL, NULL, &threeACcode);
+    generate_cold_blocks();
+    list_hoist_defvars(&threeACcode, prologueEnd);
     emit(NO_OP, NULL, NULL, NULL, &threeACcode);
     emit(NO_OP, NULL, NULL, NULL, &threeACcode);
 }
@@ -670,6 +788,30 @@ int parse_parameter_list(FILE *file, tToken *currentToken, tSymTableStack *stack
     return paramCount;
 }
 
+/**
+ * Converts inferred run-time types to the type used by the semantic checks.
+ *
+ * @param type The set of possible types.
+ * @return TYPE_NUM, TYPE_STRING or TYPE_NULL if the value always has that
+ *         type, TYPE_UNDEF otherwise.
+ */
+static tDataType parser_data_type(tRtType type)
+{
+    if (typeinfer_is(type, RT_NUM))
+    {
+        return TYPE_NUM;
+    }
+    if (typeinfer_is(type, RT_STRING))
+    {
+        return TYPE_STRING;
+    }
+    if (type == RT_NIL)
+    {
+        return TYPE_NULL;
+    }
+    return TYPE_UNDEF;
+}
+
 void check_node_defined(tSymNode *node)
 {
     if (node == NULL)
@@ -696,6 +838,25 @@ void check_undefined_functions()
     }
 }
 
+void store_return_types(tSymNode *node)
+{
+    if (node == NULL)
+    {
+        return;
+    }
+
+    store_return_types(node->left);
+
+    // Getters and setters have keys such as "getter:name@0"
+    if (node->data.kind == SYM_FUNC && strchr(node->key, ':') == NULL &&
+        strncmp(node->key, "Ifj.", strlen("Ifj.")) != 0)
+    {
+        node->data.returnType = parser_data_type(typeinfer_call_result(node->key));
+    }
+
+    store_return_types(node->right);
+}
+
 void parse_block(FILE *file, tToken *currentToken, tSymTableStack *stack,
                         bool isFunctionBody)
 {
@@ -810,60 +971,18 @@ void parse_if_statement(FILE *file, tToken *currentToken, tSymTableStack *stack)
     emit_comment("If statement condition", &threeACcode);
     parse_expression(file, currentToken, stack);
 
-    // Handle truthiness rules
-    tOperand *exprValIf = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, exprValIf, NULL, NULL, &threeACcode);
-    emit(OP_POPS, exprValIf, NULL, NULL, &threeACcode); // Pop expression result
-
-    tOperand *finalBoolResultIf =
-        create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, finalBoolResultIf, NULL, NULL, &threeACcode);
-
-    tOperand *labelIsNullIf = create_operand_from_label(threeAC_create_label(&threeACcode));
-    tOperand *labelIsBoolIf = create_operand_from_label(threeAC_create_label(&threeACcode));
-    tOperand *labelIsOtherIf = create_operand_from_label(threeAC_create_label(&threeACcode));
-    tOperand *labelEndTruthinessIf = create_operand_from_label(threeAC_create_label(&threeACcode));
-
-    // Check if null
-    emit(OP_JUMPIFEQ, labelIsNullIf, exprValIf, create_operand_from_constant_nil(), &threeACcode);
-
-    // Check if boolean (using TYPE instruction)
-    tOperand *typeCheckVarIf =
-        create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, typeCheckVarIf, NULL, NULL, &threeACcode);
-    emit(OP_TYPE, typeCheckVarIf, exprValIf, NULL, &threeACcode); // Get type of expr_val
-
-    emit(OP_JUMPIFEQ, labelIsBoolIf, typeCheckVarIf, create_operand_from_constant_string("bool"),
-         &threeACcode);
-
-    // If not null and not bool, it's true
-    emit(OP_JUMP, labelIsOtherIf, NULL, NULL, &threeACcode);
-
-    // Case: is null
-    emit(OP_LABEL, labelIsNullIf, NULL, NULL, &threeACcode);
-    emit(OP_MOVE, finalBoolResultIf, create_operand_from_constant_bool(false), NULL, &threeACcode);
-    emit(OP_JUMP, labelEndTruthinessIf, NULL, NULL, &threeACcode);
-
-    // Case: is boolean
-    emit(OP_LABEL, labelIsBoolIf, NULL, NULL, &threeACcode);
-    emit(OP_MOVE, finalBoolResultIf, exprValIf, NULL, &threeACcode);
-    emit(OP_JUMP, labelEndTruthinessIf, NULL, NULL, &threeACcode);
-
-    // Case: is other (number, string, etc.)
-    emit(OP_LABEL, labelIsOtherIf, NULL, NULL, &threeACcode);
-    emit(OP_MOVE, finalBoolResultIf, create_operand_from_constant_bool(true), NULL, &threeACcode);
-    emit(OP_JUMP, labelEndTruthinessIf, NULL, NULL, &threeACcode);
-
-    emit(OP_LABEL, labelEndTruthinessIf, NULL, NULL, &threeACcode);
-    emit(OP_PUSHS, finalBoolResultIf, NULL, NULL, &threeACcode); // Push the final boolean result
+    bool conditionIsBool = typeinfer_value() == RT_BOOL;
 
     expect_and_consume(T_RIGHT_PAREN, currentToken, file, false, NULL);
 
     char *label1Str = threeAC_create_label(&threeACcode);
     tOperand *label1 = create_operand_from_label(label1Str);
 
-    emit(OP_PUSHS, create_operand_from_constant_bool(false), NULL, NULL, &threeACcode);
-    emit(OP_JUMPIFEQS, label1, NULL, NULL, &threeACcode);
+    // Conditions that are always bool skip the truthiness rules
+    generate_condition_jump(label1, conditionIsBool);
+
+    tTypeBranch typeBranch;
+    typeinfer_branch_begin(&typeBranch);
 
     emit_comment("If-block", &threeACcode);
     parse_block(file, currentToken, stack, false);
@@ -876,8 +995,11 @@ void parse_if_statement(FILE *file, tToken *currentToken, tSymTableStack *stack)
     emit(OP_JUMP, label2, NULL, NULL, &threeACcode);
     emit(OP_LABEL, label1, NULL, NULL, &threeACcode);
 
+    typeinfer_branch_else(&typeBranch);
+
     emit_comment("Else-block", &threeACcode);
     parse_block(file, currentToken, stack, false);
+    typeinfer_branch_end(&typeBranch);
 
     emit(OP_LABEL, label2, NULL, NULL, &threeACcode);
 
@@ -1005,6 +1127,10 @@ void parse_assignment_statement(FILE *file, tToken *currentToken, tSymTableStack
     if (varData)
     {
         varData->dataType = TYPE_UNDEF;
+        if (!isGlobal)
+        {
+            typeinfer_set(varData->unique_name, typeinfer_value());
+        }
     }
 
     tOperand *popsVarOp = create_operand_from_variable(varData->unique_name, isGlobal);
@@ -1065,6 +1191,14 @@ void parse_variable_declaration(FILE *file, tToken *currentToken, tSymTableStack
             varData->dataType = exprType;
         }
         emit(OP_POPS, varOp, NULL, NULL, &threeACcode);
+        if (!isGlobal)
+        {
+            typeinfer_set(varOp->value.varname, typeinfer_value());
+        }
+    }
+    else if (!isGlobal)
+    {
+        typeinfer_set(varOp->value.varname, RT_ANY);
     }
 }
 
@@ -1081,7 +1215,6 @@ void parse_while_statement(FILE *file, tToken *currentToken, tSymTableStack *sta
 
     emit(NO_OP, NULL, NULL, NULL, &threeACcode);
     emit_comment("While loop start", &threeACcode);
-    tInstructionNode *hoistPoint = threeACcode.active;
 
     char *loopStartLabelStr = threeAC_create_label(&threeACcode);
     char *loopEndLabelStr = threeAC_create_label(&threeACcode);
@@ -1097,138 +1230,33 @@ void parse_while_statement(FILE *file, tToken *currentToken, tSymTableStack *sta
     emit(OP_LABEL, loopStartLabel, NULL, NULL, &threeACcode);
     emit_comment("While condition", &threeACcode);
 
-    parse_expression(file, currentToken, stack);
-
-    // Handle truthiness rules
-    tOperand *exprValWhile = create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, exprValWhile, NULL, NULL, &threeACcode);
-    emit(OP_POPS, exprValWhile, NULL, NULL, &threeACcode); // Pop expression result
-
-    tOperand *finalBoolResultWhile =
-        create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, finalBoolResultWhile, NULL, NULL, &threeACcode);
-
-    tOperand *labelIsNullWhile = create_operand_from_label(threeAC_create_label(&threeACcode));
-    tOperand *labelIsBoolWhile = create_operand_from_label(threeAC_create_label(&threeACcode));
-    tOperand *labelIsOtherWhile = create_operand_from_label(threeAC_create_label(&threeACcode));
-    tOperand *labelEndTruthinessWhile =
-        create_operand_from_label(threeAC_create_label(&threeACcode));
-
-    emit(OP_JUMPIFEQ, labelIsNullWhile, exprValWhile, create_operand_from_constant_nil(),
-         &threeACcode);
-
-    tOperand *typeCheckVarWhile =
-        create_operand_from_variable(threeAC_create_temp(&threeACcode), false);
-    emit(OP_DEFVAR, typeCheckVarWhile, NULL, NULL, &threeACcode);
-    emit(OP_TYPE, typeCheckVarWhile, exprValWhile, NULL, &threeACcode); // Get type of expr_val
-
-    emit(OP_JUMPIFEQ, labelIsBoolWhile, typeCheckVarWhile,
-         create_operand_from_constant_string("bool"), &threeACcode);
-
-    emit(OP_JUMP, labelIsOtherWhile, NULL, NULL, &threeACcode);
-
-    // Case: is null
-    emit(OP_LABEL, labelIsNullWhile, NULL, NULL, &threeACcode);
-    emit(OP_MOVE, finalBoolResultWhile, create_operand_from_constant_bool(false), NULL,
-         &threeACcode);
-    emit(OP_JUMP, labelEndTruthinessWhile, NULL, NULL, &threeACcode);
-
-    // Case: is boolean
-    emit(OP_LABEL, labelIsBoolWhile, NULL, NULL, &threeACcode);
-    emit(OP_MOVE, finalBoolResultWhile, exprValWhile, NULL, &threeACcode);
-    emit(OP_JUMP, labelEndTruthinessWhile, NULL, NULL, &threeACcode);
-
-    // Case: is other (number, string, etc.)
-    emit(OP_LABEL, labelIsOtherWhile, NULL, NULL, &threeACcode);
-    emit(OP_MOVE, finalBoolResultWhile, create_operand_from_constant_bool(true), NULL,
-         &threeACcode);
-    emit(OP_JUMP, labelEndTruthinessWhile, NULL, NULL, &threeACcode);
-
-    emit(OP_LABEL, labelEndTruthinessWhile, NULL, NULL, &threeACcode);
-    emit(OP_PUSHS, finalBoolResultWhile, NULL, NULL, &threeACcode); // Push the final boolean result
+    // The body has not been seen yet, so nothing is known at the loop head
+    tTypeLoop typeLoop;
+    typeinfer_loop_begin(&typeLoop);
 
-    tOperand *conditionResult = safeMalloc(sizeof(tOperand));
-    conditionResult->type = OPP_TEMP;
-    conditionResult->value.varname = threeAC_create_temp(&threeACcode);
-    emit(OP_DEFVAR, conditionResult, NULL, NULL, &threeACcode);
-    emit(OP_POPS, conditionResult, NULL, NULL, &threeACcode);
-
-    tOperand *constFalse = safeMalloc(sizeof(tOperand));
-    constFalse->type = OPP_CONST_BOOL;
-    constFalse->value.boolval = false;
+    parse_expression(file, currentToken, stack);
 
-    emit(OP_JUMPIFEQ, loopEndLabel, conditionResult, constFalse, &threeACcode);
+    // Conditions that are always bool skip the truthiness rules
+    generate_condition_jump(loopEndLabel, typeinfer_value() == RT_BOOL);
 
     expect_and_consume(T_RIGHT_PAREN, currentToken, file, false, NULL);
 
     emit_comment("While body", &threeACcode);
     parse_block(file, currentToken, stack, false);
+    typeinfer_loop_end(&typeLoop);
 
     emit(OP_JUMP, loopStartLabel, NULL, NULL, &threeACcode);
 
     emit(OP_LABEL, loopEndLabel, NULL, NULL, &threeACcode);
     emit_comment("While loop end", &threeACcode);
     emit(NO_OP, NULL, NULL, NULL, &threeACcode);
-    tInstructionNode *loopEndNode = threeACcode.active;
-
-    // Hoist DEFVARs
-    tInstructionNode *scanPtr = hoistPoint ? hoistPoint->next : threeACcode.head;
-    while (scanPtr != NULL && scanPtr != loopEndNode)
-    {
-        tInstructionNode *nextScan = scanPtr->next;
-        if (scanPtr->opType == OP_DEFVAR &&
-            (scanPtr->result->type == OPP_VAR || scanPtr->result->type == OPP_TEMP))
-        {
-            // Unlink from current position
-            scanPtr->prev->next = scanPtr->next;
-            if (scanPtr->next)
-            {
-                scanPtr->next->prev = scanPtr->prev;
-            }
-            else
-            {
-                threeACcode.tail = scanPtr->prev;
-            }
-
-            // Insert after hoistPoint
-            if (hoistPoint)
-            {
-                scanPtr->next = hoistPoint->next;
-                if (hoistPoint->next)
-                {
-                    hoistPoint->next->prev = scanPtr;
-                }
-                hoistPoint->next = scanPtr;
-                scanPtr->prev = hoistPoint;
-            }
-            else
-            { // Hoisting to the very beginning of the list
-                scanPtr->next = threeACcode.head;
-                if (threeACcode.head)
-                {
-                    threeACcode.head->prev = scanPtr;
-                }
-                threeACcode.head = scanPtr;
-                scanPtr->prev = NULL;
-            }
-
-            if (threeACcode.tail == hoistPoint)
-            {
-                threeACcode.tail = scanPtr;
-            }
-
-            hoistPoint = scanPtr; // The next DEFVAR will be inserted after this one
-        }
-        scanPtr = nextScan;
-    }
-
-    threeACcode.active = loopEndNode;
 
     threeACcode.whileUsed = false;
     threeACcode.ifUsed = ifUsedBackup;
 }
 
-void parse_function_call(FILE *file, tToken *currentToken, tSymTableStack *stack, bool isStatement)
+tDataType parse_function_call(FILE *file, tToken *currentToken, tSymTableStack *stack,
+                              bool isStatement)
 {
     char *funcName = safeMalloc(strlen((*currentToken)->data) + 1);
     strcpy(funcName, (*currentToken)->data);
@@ -1239,16 +1267,21 @@ void parse_function_call(FILE *file, tToken *currentToken, tSymTableStack *stack
 
     // 1. Evaluate argument expressions
     int argCount = 0;
+    tRtType *argTypes = NULL;
     if ((*currentToken)->type != T_RIGHT_PAREN)
     {
         parse_expression(file, currentToken, stack);
         argCount++;
+        argTypes = safeRealloc(argTypes, sizeof(tRtType) * argCount);
+        argTypes[argCount - 1] = typeinfer_value();
         while ((*currentToken)->type == T_COMMA)
         {
             get_next_token(file, currentToken);
             skip_optional_eol(currentToken, file);
             parse_expression(file, currentToken, stack);
             argCount++;
+            argTypes = safeRealloc(argTypes, sizeof(tRtType) * argCount);
+            argTypes[argCount - 1] = typeinfer_value();
         }
     }
 
@@ -1296,6 +1329,7 @@ void parse_function_call(FILE *file, tToken *currentToken, tSymTableStack *stack
     free(mangledName);
 
     emit(OP_CALL, callLabel, NULL, NULL, &threeACcode);
+    tInstructionNode *callNode = threeACcode.active;
     emit(OP_POPFRAME, NULL, NULL, NULL, &threeACcode);
 
     // 4. Push return value for expression evaluation
@@ -1360,8 +1394,25 @@ void parse_function_call(FILE *file, tToken *currentToken, tSymTableStack *stack
         exit(UNDEFINED_FUN_ERROR);
     }
 
+    // 6. Call of a specialized copy for the known argument types
+    if (specializeFunctions)
+    {
+        specialize_record_call(key, callNode, argTypes, argCount);
+    }
+    free(argTypes);
+
+    // 7. Type of the result, once the callee has been parsed. The semantic
+    // checks always use it, the operators applied to it only when optimizing
+    tRtType resultType = typeinfer_call_result(key);
+    typeinfer_set_value(typeCallResults ? resultType : RT_ANY);
+    typeinfer_set_callee(typeinfer_function(key));
+
+    funcData = symtable_find(global_symtable, key);
+    funcData->returnType = parser_data_type(resultType);
+
     free(funcName);
     free(key);
+    return funcData->returnType;
 }
 
 tDataType get_type_from_token(tToken token)
@@ -1380,6 +1431,198 @@ tDataType get_type_from_token(tToken token)
     }
 }
 
+/**
+ * Checks whether a constant is a string of ASCII characters only, for which
+ * the byte and character positions of the interpreter agree.
+ *
+ * @param arg The constant.
+ * @return true for such strings.
+ */
+static bool ifj_fold_ascii(const tOperand *arg)
+{
+    if (arg->type != OPP_CONST_STRING)
+    {
+        return false;
+    }
+    for (const unsigned char *p = (const unsigned char *)arg->value.strval; *p != '\0'; p++)
+    {
+        if (*p >= 128)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Reads an integer argument the way the built-in patterns convert it: an int
+ * as it is, a float only if it holds an integer.
+ *
+ * @param arg The constant.
+ * @param value Output for the integer.
+ * @return false if the conversion fails at run time.
+ */
+static bool ifj_fold_int(const tOperand *arg, int *value)
+{
+    if (arg->type == OPP_CONST_INT)
+    {
+        *value = arg->value.intval;
+        return true;
+    }
+    if (arg->type == OPP_CONST_FLOAT && arg->value.floatval >= INT_MIN &&
+        arg->value.floatval <= INT_MAX &&
+        arg->value.floatval == (double)(int)arg->value.floatval)
+    {
+        *value = (int)arg->value.floatval;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Creates a string constant from a part of a string.
+ *
+ * @param str The string.
+ * @param length Number of bytes to copy.
+ * @return The constant.
+ */
+static tOperand *ifj_fold_string(const char *str, size_t length)
+{
+    char *copy = safeMalloc(length + 1);
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+    tOperand *op = create_operand_from_constant_string(copy);
+    free(copy);
+    return op;
+}
+
+/**
+ * Evaluates a call of a pure built-in with constant arguments, with the
+ * results of the run-time patterns including their null results.
+ *
+ * @param fullName Name of the built-in, e.g. "Ifj.length".
+ * @param args The arguments.
+ * @param argCount Number of arguments.
+ * @return The result, or NULL if the call fails at run time, depends on the
+ *         input or its result cannot be written as a constant.
+ */
+static tOperand *ifj_fold_call(const char *fullName, tOperand **args, int argCount)
+{
+    int i;
+    int j;
+    if (strcmp(fullName, "Ifj.length") == 0 && argCount == 1 && ifj_fold_ascii(args[0]))
+    {
+        size_t length = strlen(args[0]->value.strval);
+        return length <= INT_MAX ? create_operand_from_constant_int((int)length) : NULL;
+    }
+    if (strcmp(fullName, "Ifj.str") == 0 && argCount == 1)
+    {
+        // FLOAT2STR formats floats at run time
+        char buffer[16];
+        switch (args[0]->type)
+        {
+            case OPP_CONST_STRING:
+                return create_operand_from_constant_string(args[0]->value.strval);
+            case OPP_CONST_INT:
+                snprintf(buffer, sizeof(buffer), "%d", args[0]->value.intval);
+                return create_operand_from_constant_string(buffer);
+            case OPP_CONST_NIL:
+                return create_operand_from_constant_string("null");
+            case OPP_CONST_BOOL:
+                return create_operand_from_constant_string("");
+            default:
+                return NULL;
+        }
+    }
+    if (strcmp(fullName, "Ifj.chr") == 0 && argCount == 1 && ifj_fold_int(args[0], &i) &&
+        i > 0 && i < 128)
+    {
+        char c = (char)i;
+        return ifj_fold_string(&c, 1);
+    }
+    if (strcmp(fullName, "Ifj.ord") == 0 && argCount == 2 && ifj_fold_ascii(args[0]) &&
+        ifj_fold_int(args[1], &i))
+    {
+        const char *str = args[0]->value.strval;
+        bool inRange = i >= 0 && (size_t)i < strlen(str);
+        return create_operand_from_constant_int(inRange ? (unsigned char)str[i] : 0);
+    }
+    if (strcmp(fullName, "Ifj.substring") == 0 && argCount == 3 && ifj_fold_ascii(args[0]) &&
+        ifj_fold_int(args[2], &j) && ifj_fold_int(args[1], &i))
+    {
+        const char *str = args[0]->value.strval;
+        size_t length = strlen(str);
+        if (i < 0 || j < 0 || i > j || (size_t)i >= length || (size_t)j > length)
+        {
+            return create_operand_from_constant_nil();
+        }
+        return ifj_fold_string(str + i, (size_t)(j - i));
+    }
+    if (strcmp(fullName, "Ifj.strcmp") == 0 && argCount == 2 && ifj_fold_ascii(args[0]) &&
+        ifj_fold_ascii(args[1]))
+    {
+        int cmp = strcmp(args[0]->value.strval, args[1]->value.strval);
+        return create_operand_from_constant_int(cmp < 0 ? -1 : cmp > 0 ? 1 : 0);
+    }
+    if (strcmp(fullName, "Ifj.floor") == 0 && argCount == 1)
+    {
+        // FLOAT2INT truncates towards zero
+        if (args[0]->type == OPP_CONST_INT)
+        {
+            return create_operand_from_constant_int(args[0]->value.intval);
+        }
+        if (args[0]->type == OPP_CONST_FLOAT && args[0]->value.floatval > INT_MIN - 1.0 &&
+            args[0]->value.floatval < INT_MAX + 1.0)
+        {
+            return create_operand_from_constant_int((int)args[0]->value.floatval);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Replaces a built-in call whose arguments were each pushed as a constant by
+ * a single push of its result.
+ *
+ * @param fullName Name of the built-in.
+ * @param argsStart Last instruction before the arguments.
+ * @param argCount Number of arguments.
+ * @return true if the call was evaluated.
+ */
+static bool ifj_fold_pushed_call(const char *fullName, tInstructionNode *argsStart, int argCount)
+{
+    tInstructionNode *pushes[3];
+    tOperand *args[3];
+    tInstructionNode *node = threeACcode.active;
+    for (int k = argCount - 1; k >= 0; k--)
+    {
+        if (node == NULL || node == argsStart || node->opType != OP_PUSHS ||
+            node->result->type < OPP_CONST_INT || node->result->type > OPP_CONST_NIL)
+        {
+            return false;
+        }
+        pushes[k] = node;
+        args[k] = node->result;
+        node = node->prev;
+    }
+    if (argCount == 0 || node != argsStart)
+    {
+        return false;
+    }
+
+    tOperand *result = ifj_fold_call(fullName, args, argCount);
+    if (result == NULL)
+    {
+        return false;
+    }
+    for (int k = argCount - 1; k >= 0; k--)
+    {
+        list_remove(&threeACcode, pushes[k]);
+    }
+    emit(OP_PUSHS, result, NULL, NULL, &threeACcode);
+    return true;
+}
+
 tDataType parse_ifj_call(FILE *file, tToken *currentToken, tSymTableStack *stack, bool isStatement)
 {
     expect_and_consume(T_KW_IFJ, currentToken, file, false, NULL);
@@ -1405,6 +1648,7 @@ tDataType parse_ifj_call(FILE *file, tToken *currentToken, tSymTableStack *stack
 
     int argCount = 0;
     tDataType argTypes[3];
+    tInstructionNode *argsStart = threeACcode.active;
     if ((*currentToken)->type != T_RIGHT_PAREN)
     {
         argTypes[argCount] = parse_expression(file, currentToken, stack);
@@ -1447,6 +1691,16 @@ tDataType parse_ifj_call(FILE *file, tToken *currentToken, tSymTableStack *stack
     semantic_check_argument_types(funcData, argTypes, argCount, fullName);
 
     tDataType returnType;
+    if (ifj_fold_pushed_call(fullName, argsStart, argCount))
+    {
+        // Constant arguments, the result is known already
+        returnType = funcData->returnType;
+        typeinfer_set_value(typeinfer_builtin_result(fullName));
+        free(fullName);
+        return returnType;
+    }
+
+    tInstructionNode *patternStart = stats_pattern_begin();
 
     if (strcmp(fullName, "Ifj.write") == 0)
     {
@@ -1489,6 +1743,8 @@ tDataType parse_ifj_call(FILE *file, tToken *currentToken, tSymTableStack *stack
         returnType = generate_ifj_chr();
     }
 
+    stats_pattern_end(fullName, patternStart);
+    typeinfer_set_value(typeinfer_builtin_result(fullName));
     free(fullName);
     return returnType;
 }
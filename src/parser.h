@@ -62,8 +62,10 @@ void skip_optional_eol(tToken *currentToken, FILE *file);
  * @param currentToken The current token from the scanner.
  * @param stack The symbol table stack.
  * @param isStatement True if the function call is a standalone statement.
+ * @return The inferred return type of the function, TYPE_UNDEF if not known.
  */
-void parse_function_call(FILE *file, tToken *currentToken, tSymTableStack *stack, bool isStatement);
+tDataType parse_function_call(FILE *file, tToken *currentToken, tSymTableStack *stack,
+                              bool isStatement);
 
 /**
  * Parses a call to a built-in 'ifj' function.
@@ -173,6 +175,13 @@ void check_node_defined(tSymNode *node);
  */
 void check_undefined_functions();
 
+/**
+ * Stores the inferred return types of all user functions in the symbol table.
+ *
+ * @param node Root of the subtree to process.
+ */
+void store_return_types(tSymNode *node);
+
 /**
  * Parses an if-else statement.
  *
@@ -220,6 +229,35 @@ void parse_variable_declaration(FILE *file, tToken *currentToken, tSymTableStack
  */
 void parse_assignment_statement(FILE *file, tToken *currentToken, tSymTableStack *stack);
 
+/**
+ * Starts recording the tokens read from the input.
+ *
+ * @param current The current token, recorded first.
+ */
+void parser_record_begin(tToken current);
+
+/**
+ * Stops recording tokens.
+ *
+ * @param count Output for the number of recorded tokens.
+ * @return Copies of the recorded tokens, owned by the caller.
+ */
+tToken *parser_record_end(size_t *count);
+
+/**
+ * Makes the parser read recorded tokens instead of the input. Reading past
+ * the end repeats the last token.
+ *
+ * @param tokens The recorded tokens.
+ * @param count Number of tokens.
+ */
+void parser_replay_begin(tToken *tokens, size_t count);
+
+/**
+ * Returns the parser to the input.
+ */
+void parser_replay_end(void);
+
 /**
  * Parses a block of statements enclosed in curly braces.
  *
@@ -0,0 +1,419 @@
+/**
+ * @file passes.c
+ *
+ * IFJ25 project
+ *
+ * Pass manager of the optimizer.
+ *
+ * @author agent <agent@local>
+ */
+
+#include "passes.h"
+#include "accessors.h"
+#include "callgraph.h"
+#include "cfg.h"
+#include "dce.h"
+#include "error.h"
+#include "inliner.h"
+#include "licm.h"
+#include "lvn.h"
+#include "peephole.h"
+#include "strmap.h"
+#include "tailcall.h"
+#include "tempalloc.h"
+
+#include <string.h>
+
+// Registered passes, in the order of the -O2 pipeline
+static const tPass passes[] = {
+    {"accessors", accessors_run, PHASE_PASS_ACCESSORS, false},
+    {"inline", inliner_run, PHASE_PASS_INLINE, false},
+    {"tailcall", tailcall_run, PHASE_PASS_TAILCALL, false},
+    {"peephole", peephole_run, PHASE_PASS_PEEPHOLE, true},
+    {"lvn", lvn_run, PHASE_PASS_LVN, false},
+    {"dce", dce_run, PHASE_PASS_DCE, false},
+    {"licm", licm_run, PHASE_PASS_LICM, false},
+    {"callgraph", callgraph_run, PHASE_PASS_CALLGRAPH, false},
+    {"tempalloc", tempalloc_run, PHASE_PASS_TEMPALLOC, false},
+};
+
+#define PASS_COUNT (sizeof(passes) / sizeof(passes[0]))
+
+/**
+ * Finds a registered pass.
+ *
+ * @param name Pass name.
+ * @param length Length of the name.
+ * @return The pass, or NULL if there is none of this name.
+ */
+static const tPass *passes_find(const char *name, size_t length)
+{
+    for (size_t i = 0; i < PASS_COUNT; i++)
+    {
+        if (strlen(passes[i].name) == length && strncmp(passes[i].name, name, length) == 0)
+        {
+            return &passes[i];
+        }
+    }
+    return NULL;
+}
+
+bool passes_parse(tPipeline *pipeline, const char *spec)
+{
+    pipeline->count = 0;
+    int groups = 0;
+    bool inGroup = false;
+
+    const char *p = spec;
+    while (*p != '\0')
+    {
+        if (*p == '[' && !inGroup)
+        {
+            inGroup = true;
+            p++;
+            continue;
+        }
+        if (*p == ']' && inGroup)
+        {
+            inGroup = false;
+            groups++;
+            p++;
+            if (*p == ',')
+            {
+                p++;
+            }
+            continue;
+        }
+
+        size_t length = strcspn(p, ",[]");
+        if (length == 0)
+        {
+            fprintf(stderr, "Error: Malformed --passes '%s'\n", spec);
+            return false;
+        }
+        const tPass *pass = passes_find(p, length);
+        if (pass == NULL || pipeline->count == PASSES_MAX_STEPS)
+        {
+            fprintf(stderr, "Error: %s '%.*s' in --passes\n",
+                    pass == NULL ? "Unknown pass" : "Too many passes at", (int)length, p);
+            if (pass == NULL)
+            {
+                passes_print_names(stderr);
+            }
+            return false;
+        }
+        pipeline->steps[pipeline->count].pass = pass;
+        pipeline->steps[pipeline->count].group = inGroup ? groups : -1;
+        pipeline->count++;
+
+        p += length;
+        if (*p == ',')
+        {
+            p++;
+        }
+        else if (*p == '[')
+        {
+            break;
+        }
+    }
+
+    if (inGroup || *p != '\0')
+    {
+        fprintf(stderr, "Error: Unbalanced brackets in --passes '%s'\n", spec);
+        return false;
+    }
+    return true;
+}
+
+void passes_preset(tPipeline *pipeline, int level, bool sizeLevel)
+{
+    const char *spec = "";
+    if (sizeLevel)
+    {
+        // Inlining would undo the shared subroutines of -Os
+        spec = "accessors,tailcall,[peephole,dce,licm],callgraph,tempalloc";
+    }
+    else if (level == 1)
+    {
+        spec = "accessors,inline,tailcall,[peephole,dce,licm],callgraph,tempalloc";
+    }
+    else if (level >= 2)
+    {
+        // Value numbering before the dead code pass, which then removes
+        // the variables it leaves unused in the same sweep
+        spec = "accessors,inline,tailcall,[peephole,lvn,dce,licm],callgraph,tempalloc";
+    }
+    passes_parse(pipeline, spec);
+}
+
+/**
+ * Runs one pass and optionally verifies its result.
+ *
+ * @param list The generated code.
+ * @param pass The pass.
+ * @param verify Whether to verify the code afterwards.
+ * @param changes Output for the number of changes.
+ * @return false if the verification failed.
+ */
+static bool passes_run_one(tThreeACList *list, const tPass *pass, bool verify, size_t *changes)
+{
+    TIMING_BEGIN(pass->phase);
+    *changes = pass->run(list);
+    TIMING_END(pass->phase);
+    return !verify || passes_verify(list, pass->name) == 0;
+}
+
+int passes_run(tThreeACList *list, const tPipeline *pipeline, bool verify)
+{
+    if (verify && passes_verify(list, "front end") > 0)
+    {
+        return INTERNAL_ERROR;
+    }
+
+    int i = 0;
+    while (i < pipeline->count)
+    {
+        int group = pipeline->steps[i].group;
+        if (group < 0)
+        {
+            size_t changes;
+            if (!passes_run_one(list, pipeline->steps[i].pass, verify, &changes))
+            {
+                return INTERNAL_ERROR;
+            }
+            i++;
+            continue;
+        }
+
+        int end = i;
+        while (end < pipeline->count && pipeline->steps[end].group == group)
+        {
+            end++;
+        }
+
+        // Removed code may bring new instruction pairs together, and moved
+        // code may leave the outer loop invariant
+        size_t groupChanges;
+        do
+        {
+            groupChanges = 0;
+            for (int step = i; step < end; step++)
+            {
+                size_t changes;
+                if (!passes_run_one(list, pipeline->steps[step].pass, verify, &changes))
+                {
+                    return INTERNAL_ERROR;
+                }
+                if (!pipeline->steps[step].pass->converges)
+                {
+                    groupChanges += changes;
+                }
+            }
+        } while (groupChanges > 0);
+        i = end;
+    }
+    return 0;
+}
+
+/**
+ * Returns how many operands an instruction needs.
+ *
+ * @param op Operation type.
+ * @return 0 to 3, counting the result first.
+ */
+static int passes_operand_count(tOperationType op)
+{
+    switch (op)
+    {
+        case OP_LABEL:
+        case OP_JUMP:
+        case OP_JUMPIFEQS:
+        case OP_JUMPIFNEQS:
+        case OP_CALL:
+        case OP_DEFVAR:
+        case OP_PUSHS:
+        case OP_POPS:
+        case OP_WRITE:
+        case OP_EXIT:
+            return 1;
+        case OP_MOVE:
+        case OP_NOT:
+        case OP_STRLEN:
+        case OP_INT2FLOAT:
+        case OP_FLOAT2INT:
+        case OP_FLOAT2STR:
+        case OP_INT2CHAR:
+        case OP_INT2STR:
+        case OP_TYPE:
+        case OP_ISINT:
+        case OP_READ:
+            return 2;
+        case OP_JUMPIFEQ:
+        case OP_JUMPIFNEQ:
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_IDIV:
+        case OP_AND:
+        case OP_OR:
+        case OP_LT:
+        case OP_GT:
+        case OP_EQ:
+        case OP_CONCAT:
+        case OP_GETCHAR:
+        case OP_SETCHAR:
+        case OP_STRI2INT:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Checks the operands of one instruction.
+ *
+ * @param node The instruction.
+ * @param labels Defined labels.
+ * @param globals Global variables with a DEFVAR.
+ * @param locals Local variables with a DEFVAR in the function.
+ * @param function Label of the function, for the messages.
+ * @param stage What produced the code, for the messages.
+ * @return Number of problems found.
+ */
+static size_t passes_verify_instruction(const tInstructionNode *node, const tStrMap *labels,
+                                        const tStrMap *globals, const tStrMap *locals,
+                                        const char *function, const char *stage)
+{
+    size_t value;
+    tOperand *operands[] = {node->result, node->arg1, node->arg2};
+    int needed = passes_operand_count(node->opType);
+    for (int i = 0; i < needed; i++)
+    {
+        if (operands[i] == NULL)
+        {
+            fprintf(stderr, "[VERIFY] after %s: %s without operand %d in %s\n", stage,
+                    operation_to_string(node->opType), i + 1, function);
+            return 1;
+        }
+    }
+
+    if (cfg_has_target(node->opType))
+    {
+        if (node->result->type != OPP_LABEL ||
+            !strmap_get(labels, node->result->value.label, &value))
+        {
+            fprintf(stderr, "[VERIFY] after %s: %s to an undefined label in %s\n", stage,
+                    operation_to_string(node->opType), function);
+            return 1;
+        }
+        return 0;
+    }
+    if (node->opType == OP_DEFVAR || node->opType == OP_LABEL || node->opType == OP_COMMENT)
+    {
+        return 0;
+    }
+
+    size_t problems = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        const tOperand *operand = operands[i];
+        if (operand == NULL)
+        {
+            continue;
+        }
+        if (cfg_is_local(operand) &&
+            strncmp(operand->value.varname, "%param", strlen("%param")) != 0 &&
+            !strmap_get(locals, operand->value.varname, &value))
+        {
+            fprintf(stderr, "[VERIFY] after %s: LF@%s used without DEFVAR in %s\n", stage,
+                    operand->value.varname, function);
+            problems++;
+        }
+        else if (operand->type == OPP_GLOBAL && !strmap_get(globals, operand->value.varname, &value))
+        {
+            fprintf(stderr, "[VERIFY] after %s: GF@%s used without DEFVAR in %s\n", stage,
+                    operand->value.varname, function);
+            problems++;
+        }
+    }
+    return problems;
+}
+
+size_t passes_verify(tThreeACList *list, const char *stage)
+{
+    TIMING_BEGIN(PHASE_VERIFY);
+    size_t problems = 0;
+    tStrMap labels;
+    tStrMap globals;
+    strmap_init(&labels);
+    strmap_init(&globals);
+
+    size_t value;
+    for (tInstructionNode *node = list->globalDefHead; node != NULL; node = node->next)
+    {
+        if (node->opType == OP_DEFVAR && node->result != NULL &&
+            node->result->type == OPP_GLOBAL)
+        {
+            strmap_put(&globals, node->result->value.varname, 0);
+        }
+    }
+    for (tInstructionNode *node = list->head; node != NULL; node = node->next)
+    {
+        if (node->opType == OP_LABEL && node->result != NULL && node->result->type == OPP_LABEL)
+        {
+            if (strmap_get(&labels, node->result->value.label, &value))
+            {
+                fprintf(stderr, "[VERIFY] after %s: label %s defined twice\n", stage,
+                        node->result->value.label);
+                problems++;
+            }
+            strmap_put(&labels, node->result->value.label, 0);
+        }
+        else if (node->opType == OP_DEFVAR && node->result != NULL &&
+                 node->result->type == OPP_GLOBAL)
+        {
+            strmap_put(&globals, node->result->value.varname, 0);
+        }
+    }
+
+    // Every function, and the code in front of the first one, has its own frame
+    tInstructionNode *end;
+    for (tInstructionNode *first = list->head; first != NULL; first = end)
+    {
+        const char *function =
+            cfg_starts_function(first) ? first->result->value.label : "the program header";
+        end = cfg_function_end(first);
+
+        tStrMap locals;
+        strmap_init(&locals);
+        for (tInstructionNode *node = first; node != end; node = node->next)
+        {
+            if (node->opType == OP_DEFVAR && cfg_is_local(node->result))
+            {
+                strmap_put(&locals, node->result->value.varname, 0);
+            }
+        }
+        for (tInstructionNode *node = first; node != end; node = node->next)
+        {
+            problems +=
+                passes_verify_instruction(node, &labels, &globals, &locals, function, stage);
+        }
+        strmap_dispose(&locals);
+    }
+
+    strmap_dispose(&labels);
+    strmap_dispose(&globals);
+    TIMING_END(PHASE_VERIFY);
+    return problems;
+}
+
+void passes_print_names(FILE *out)
+{
+    fprintf(out, "Available passes:");
+    for (size_t i = 0; i < PASS_COUNT; i++)
+    {
+        fprintf(out, " %s", passes[i].name);
+    }
+    fprintf(out, "\n");
+}
@@ -0,0 +1,117 @@
+/**
+ * @file passes.h
+ *
+ * IFJ25 project
+ *
+ * Pass manager of the optimizer.
+ *
+ * A pipeline is a list of registered passes that run in order over the
+ * generated code. Passes written in brackets form a group that is repeated
+ * until none of its passes changes the code, e.g.
+ * "inline,tailcall,[peephole,dce,licm],tempalloc". A pass that already
+ * repeats itself until nothing changes (the peephole optimizer) does not
+ * restart its group on its own. The -O levels are fixed pipelines written
+ * in the same syntax. With verification on, the code is checked after the
+ * front end and after every pass.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_PASSES_H
+#define IFJ_PASSES_H
+
+#include "3AC.h"
+#include "timing.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define PASSES_MAX_STEPS 32
+
+/**
+ * Entry point of a pass.
+ *
+ * @param list The generated code.
+ * @return Number of changes, 0 if the code stayed the same.
+ */
+typedef size_t (*tPassRun)(tThreeACList *list);
+
+/**
+ * A registered pass.
+ */
+typedef struct
+{
+    const char *name;
+    tPassRun run;
+    tPhase phase;   // Phase of the time report
+    bool converges; // Repeats itself until nothing changes
+} tPass;
+
+/**
+ * One pass of a pipeline.
+ */
+typedef struct
+{
+    const tPass *pass;
+    int group; // Repeated group the pass belongs to, -1 for none
+} tPipelineStep;
+
+/**
+ * Passes in the order they run.
+ */
+typedef struct
+{
+    tPipelineStep steps[PASSES_MAX_STEPS];
+    int count;
+} tPipeline;
+
+/**
+ * Parses a pipeline such as "inline,tailcall,[peephole,dce,licm],tempalloc".
+ * An empty string gives an empty pipeline.
+ *
+ * @param pipeline Output pipeline.
+ * @param spec Comma-separated pass names, brackets around repeated groups.
+ * @return false after printing an error for unknown passes, nested or
+ *         unclosed groups and too long pipelines.
+ */
+bool passes_parse(tPipeline *pipeline, const char *spec);
+
+/**
+ * Sets the pipeline of an optimization level.
+ *
+ * @param pipeline Output pipeline.
+ * @param level Optimization level 0 to 2.
+ * @param sizeLevel -Os: the -O1 passes without inlining.
+ */
+void passes_preset(tPipeline *pipeline, int level, bool sizeLevel);
+
+/**
+ * Runs a pipeline over the code.
+ *
+ * @param list The generated code.
+ * @param pipeline The passes.
+ * @param verify Check the code before the first and after every pass.
+ * @return 0, or INTERNAL_ERROR if the verification failed.
+ */
+int passes_run(tThreeACList *list, const tPipeline *pipeline, bool verify);
+
+/**
+ * Checks that every jump and call target is a label defined once, that every
+ * instruction has its operands and that every local and global variable has
+ * a DEFVAR in its function or program. The problems are printed to stderr.
+ *
+ * @param list The generated code.
+ * @param stage What produced the code, for the messages, e.g. "peephole".
+ * @return Number of problems found.
+ */
+size_t passes_verify(tThreeACList *list, const char *stage);
+
+/**
+ * Prints the names of the registered passes.
+ *
+ * @param out Output stream.
+ */
+void passes_print_names(FILE *out);
+
+#endif // IFJ_PASSES_H
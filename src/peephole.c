@@ -0,0 +1,553 @@
+/**
+ * @file peephole.c
+ *
+ * IFJ25 project
+ *
+ * Peephole optimizer over the generated three-address code (-O1).
+ *
+ * Most rules turn the stack code of the expression parser into the
+ * equivalent three-address instructions. The rules that drop a variable
+ * ("MOVE t x; MOVE y t" to "MOVE y x") need to know that the second
+ * instruction is the only one reading it, so every sweep counts the reads
+ * of each local variable per function. A rewrite never adds a read, so the
+ * counts stay an upper bound while the sweep goes on.
+ *
+ * @author agent <agent@local>
+ */
+
+#include "peephole.h"
+#include "cfg.h"
+#include "stats.h"
+#include "strmap.h"
+
+#include <string.h>
+
+#define PEEPHOLE_WINDOW 4
+
+/**
+ * Instructions matched by a rule, comments and empty lines left out.
+ */
+typedef struct
+{
+    tInstructionNode *node[PEEPHOLE_WINDOW];
+    int count;
+} tPeepholeWindow;
+
+/**
+ * State of one sweep.
+ */
+typedef struct
+{
+    tThreeACList *list;
+    tStrMap reads; // Number of reads of every local variable of the current function
+} tPeepholeContext;
+
+/**
+ * A rewrite rule. apply() checks the window and rewrites it in place.
+ */
+typedef struct
+{
+    const char *name;
+    bool (*apply)(tPeepholeContext *ctx, tPeepholeWindow *window);
+    size_t hits;
+} tPeepholeRule;
+
+/**
+ * Stack instructions and their three-address forms.
+ */
+static const struct
+{
+    tOperationType stack;
+    tOperationType direct;
+} peephole_forms[] = {
+    {OP_ADDS, OP_ADD},           {OP_SUBS, OP_SUB},           {OP_MULS, OP_MUL},
+    {OP_DIVS, OP_DIV},           {OP_IDIVS, OP_IDIV},         {OP_LTS, OP_LT},
+    {OP_GTS, OP_GT},             {OP_EQS, OP_EQ},             {OP_ANDS, OP_AND},
+    {OP_ORS, OP_OR},             {OP_STRI2INTS, OP_STRI2INT}, {OP_NOTS, OP_NOT},
+    {OP_INT2FLOATS, OP_INT2FLOAT}, {OP_FLOAT2INTS, OP_FLOAT2INT}, {OP_INT2CHARS, OP_INT2CHAR},
+    {OP_INT2STRS, OP_INT2STR},   {OP_FLOAT2STRS, OP_FLOAT2STR}, {OP_TYPES, OP_TYPE},
+    {OP_ISINTS, OP_ISINT},       {OP_JUMPIFEQS, OP_JUMPIFEQ}, {OP_JUMPIFNEQS, OP_JUMPIFNEQ},
+};
+
+/**
+ * Finds the next instruction that is not a comment or an empty line.
+ *
+ * @param node The instruction to start after.
+ * @return The instruction, or NULL at the end of the list.
+ */
+static tInstructionNode *peephole_next(tInstructionNode *node)
+{
+    node = node->next;
+    while (node != NULL && cfg_is_marker(node->opType))
+    {
+        node = node->next;
+    }
+    return node;
+}
+
+/**
+ * Finds the previous instruction that is not a comment or an empty line.
+ *
+ * @param node The instruction to start before.
+ * @return The instruction, or NULL at the start of the list.
+ */
+static tInstructionNode *peephole_prev(tInstructionNode *node)
+{
+    node = node->prev;
+    while (node != NULL && cfg_is_marker(node->opType))
+    {
+        node = node->prev;
+    }
+    return node;
+}
+
+/**
+ * Returns the three-address form of a stack instruction.
+ *
+ * @param op The stack instruction.
+ * @return The three-address instruction, or NO_OP if there is none.
+ */
+static tOperationType peephole_direct_form(tOperationType op)
+{
+    for (size_t i = 0; i < sizeof(peephole_forms) / sizeof(peephole_forms[0]); i++)
+    {
+        if (peephole_forms[i].stack == op)
+        {
+            return peephole_forms[i].direct;
+        }
+    }
+    return NO_OP;
+}
+
+/**
+ * Checks whether two operands name the same local variable.
+ *
+ * @param a First operand.
+ * @param b Second operand.
+ * @return true if both are the same local variable.
+ */
+static bool peephole_same_local(const tOperand *a, const tOperand *b)
+{
+    return cfg_is_local(a) && cfg_is_local(b) &&
+           strcmp(a->value.varname, b->value.varname) == 0;
+}
+
+/**
+ * Checks whether a local variable is read exactly once in its function.
+ *
+ * @param ctx State of the sweep.
+ * @param operand The variable.
+ * @return true if there is a single read.
+ */
+static bool peephole_single_read(tPeepholeContext *ctx, const tOperand *operand)
+{
+    size_t reads;
+    return cfg_is_local(operand) && strmap_get(&ctx->reads, operand->value.varname, &reads) &&
+           reads == 1;
+}
+
+/**
+ * Adds one read of an operand to the counters.
+ *
+ * @param ctx State of the sweep.
+ * @param operand The operand, may be NULL.
+ */
+static void peephole_count_read(tPeepholeContext *ctx, const tOperand *operand)
+{
+    if (!cfg_is_local(operand))
+    {
+        return;
+    }
+    size_t reads = 0;
+    strmap_get(&ctx->reads, operand->value.varname, &reads);
+    strmap_put(&ctx->reads, operand->value.varname, reads + 1);
+}
+
+/**
+ * Counts the reads of local variables from a function label to the next one.
+ *
+ * @param ctx State of the sweep, the counters are reset.
+ * @param label The function label.
+ */
+static void peephole_count_function(tPeepholeContext *ctx, tInstructionNode *label)
+{
+    strmap_dispose(&ctx->reads);
+    strmap_init(&ctx->reads);
+
+    for (tInstructionNode *node = label->next; node != NULL; node = node->next)
+    {
+        if (node->opType == OP_LABEL && cfg_is_function_label(node->result->value.label))
+        {
+            break;
+        }
+        if (cfg_reads_result(node->opType))
+        {
+            peephole_count_read(ctx, node->result);
+        }
+        peephole_count_read(ctx, node->arg1);
+        peephole_count_read(ctx, node->arg2);
+        if (node->opType == OP_RETURN)
+        {
+            tOperand retval = {.type = OPP_VAR, .value.varname = "%retval"};
+            peephole_count_read(ctx, &retval);
+        }
+    }
+}
+
+/**
+ * Checks whether reading an operand cannot fail because it is uninitialized.
+ * TYPE is the only instruction that accepts an uninitialized variable, so
+ * TYPES may only be replaced when this holds for the pushed value.
+ *
+ * @param push The PUSHS of the operand.
+ * @return true for constants and variables accessed by the previous instruction.
+ */
+static bool peephole_initialized(tInstructionNode *push)
+{
+    const tOperand *operand = push->result;
+    if (operand->type != OPP_VAR && operand->type != OPP_TEMP && operand->type != OPP_GLOBAL &&
+        operand->type != OPP_TF_VAR)
+    {
+        return true;
+    }
+
+    tInstructionNode *prev = peephole_prev(push);
+    if (prev == NULL || prev->opType == OP_LABEL || prev->opType == OP_TYPE ||
+        prev->opType == OP_DEFVAR)
+    {
+        return false;
+    }
+    const tOperand *accessed[] = {prev->result, prev->arg1, prev->arg2};
+    for (size_t i = 0; i < 3; i++)
+    {
+        if (accessed[i] != NULL && accessed[i]->type == operand->type &&
+            strcmp(accessed[i]->value.varname, operand->value.varname) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Turns the first instruction of the window into a new one and removes the
+ * next count - 1 instructions.
+ *
+ * @param ctx State of the sweep.
+ * @param window The window.
+ * @param count Number of replaced instructions.
+ * @param op The new instruction.
+ * @param result Its result operand.
+ * @param arg1 Its first argument.
+ * @param arg2 Its second argument.
+ */
+static void peephole_replace(tPeepholeContext *ctx, tPeepholeWindow *window, int count,
+                             tOperationType op, tOperand *result, tOperand *arg1, tOperand *arg2)
+{
+    tInstructionNode *node = window->node[0];
+    node->opType = op;
+    node->result = result;
+    node->arg1 = arg1;
+    node->arg2 = arg2;
+    for (int i = 1; i < count; i++)
+    {
+        list_remove(ctx->list, window->node[i]);
+    }
+}
+
+/**
+ * PUSHS a; POPS b  ->  MOVE b a
+ */
+static bool peephole_push_pop(tPeepholeContext *ctx, tPeepholeWindow *w)
+{
+    if (w->count < 2 || w->node[0]->opType != OP_PUSHS || w->node[1]->opType != OP_POPS)
+    {
+        return false;
+    }
+    peephole_replace(ctx, w, 2, OP_MOVE, w->node[1]->result, w->node[0]->result, NULL);
+    return true;
+}
+
+/**
+ * JUMP L; LABEL L  ->  LABEL L
+ */
+static bool peephole_jump_next(tPeepholeContext *ctx, tPeepholeWindow *w)
+{
+    if (w->count < 2 || w->node[0]->opType != OP_JUMP || w->node[1]->opType != OP_LABEL ||
+        strcmp(w->node[0]->result->value.label, w->node[1]->result->value.label) != 0)
+    {
+        return false;
+    }
+    list_remove(ctx->list, w->node[0]);
+    return true;
+}
+
+/**
+ * PUSHS a; PUSHS b; JUMPIFEQS L  ->  JUMPIFEQ L a b (and JUMPIFNEQS)
+ */
+static bool peephole_push_push_jump(tPeepholeContext *ctx, tPeepholeWindow *w)
+{
+    if (w->count < 3 || w->node[0]->opType != OP_PUSHS || w->node[1]->opType != OP_PUSHS ||
+        (w->node[2]->opType != OP_JUMPIFEQS && w->node[2]->opType != OP_JUMPIFNEQS))
+    {
+        return false;
+    }
+    tOperand *label = w->node[2]->result;
+    tOperand *left = w->node[0]->result;
+    tOperand *right = w->node[1]->result;
+    peephole_replace(ctx, w, 3, peephole_direct_form(w->node[2]->opType), label, left, right);
+    return true;
+}
+
+/**
+ * PUSHS a; PUSHS b; ADDS; POPS c  ->  ADD c a b (any binary stack operator)
+ */
+static bool peephole_binary(tPeepholeContext *ctx, tPeepholeWindow *w)
+{
+    if (w->count < 4 || w->node[0]->opType != OP_PUSHS || w->node[1]->opType != OP_PUSHS ||
+        w->node[3]->opType != OP_POPS)
+    {
+        return false;
+    }
+    tOperationType op = w->node[2]->opType;
+    if (op != OP_ADDS && op != OP_SUBS && op != OP_MULS && op != OP_DIVS && op != OP_IDIVS &&
+        op != OP_LTS && op != OP_GTS && op != OP_EQS && op != OP_ANDS && op != OP_ORS &&
+        op != OP_STRI2INTS)
+    {
+        return false;
+    }
+    tOperand *result = w->node[3]->result;
+    tOperand *left = w->node[0]->result;
+    tOperand *right = w->node[1]->result;
+    peephole_replace(ctx, w, 4, peephole_direct_form(op), result, left, right);
+    return true;
+}
+
+/**
+ * PUSHS a; NOTS; POPS c  ->  NOT c a (any unary stack operator)
+ */
+static bool peephole_unary(tPeepholeContext *ctx, tPeepholeWindow *w)
+{
+    if (w->count < 3 || w->node[0]->opType != OP_PUSHS || w->node[2]->opType != OP_POPS)
+    {
+        return false;
+    }
+    tOperationType op = w->node[1]->opType;
+    if (op != OP_NOTS && op != OP_INT2FLOATS && op != OP_FLOAT2INTS && op != OP_INT2CHARS &&
+        op != OP_INT2STRS && op != OP_FLOAT2STRS && op != OP_ISINTS && op != OP_TYPES)
+    {
+        return false;
+    }
+    if (op == OP_TYPES && !peephole_initialized(w->node[0]))
+    {
+        return false;
+    }
+    tOperand *result = w->node[2]->result;
+    tOperand *arg = w->node[0]->result;
+    peephole_replace(ctx, w, 3, peephole_direct_form(op), result, arg, NULL);
+    return true;
+}
+
+/**
+ * MOVE t x; MOVE y t  ->  MOVE y x, when t is not read anywhere else
+ */
+static bool peephole_move_move(tPeepholeContext *ctx, tPeepholeWindow *w)
+{
+    if (w->count < 2 || w->node[0]->opType != OP_MOVE || w->node[1]->opType != OP_MOVE ||
+        !peephole_same_local(w->node[0]->result, w->node[1]->arg1) ||
+        !peephole_single_read(ctx, w->node[0]->result))
+    {
+        return false;
+    }
+    peephole_replace(ctx, w, 2, OP_MOVE, w->node[1]->result, w->node[0]->arg1, NULL);
+    return true;
+}
+
+/**
+ * MOVE t x; PUSHS t  ->  PUSHS x, when t is not read anywhere else
+ */
+static bool peephole_move_push(tPeepholeContext *ctx, tPeepholeWindow *w)
+{
+    if (w->count < 2 || w->node[0]->opType != OP_MOVE || w->node[1]->opType != OP_PUSHS ||
+        !peephole_same_local(w->node[0]->result, w->node[1]->result) ||
+        !peephole_single_read(ctx, w->node[0]->result))
+    {
+        return false;
+    }
+    peephole_replace(ctx, w, 2, OP_PUSHS, w->node[0]->arg1, NULL, NULL);
+    return true;
+}
+
+/**
+ * POPS t; MOVE y t  ->  POPS y, when t is not read anywhere else
+ */
+static bool peephole_pop_move(tPeepholeContext *ctx, tPeepholeWindow *w)
+{
+    if (w->count < 2 || w->node[0]->opType != OP_POPS || w->node[1]->opType != OP_MOVE ||
+        !peephole_same_local(w->node[0]->result, w->node[1]->arg1) ||
+        !peephole_single_read(ctx, w->node[0]->result))
+    {
+        return false;
+    }
+    peephole_replace(ctx, w, 2, OP_POPS, w->node[1]->result, NULL, NULL);
+    return true;
+}
+
+/**
+ * POPS t; PUSHS t  ->  nothing, when t is not read anywhere else
+ */
+static bool peephole_pop_push(tPeepholeContext *ctx, tPeepholeWindow *w)
+{
+    if (w->count < 2 || w->node[0]->opType != OP_POPS || w->node[1]->opType != OP_PUSHS ||
+        !peephole_same_local(w->node[0]->result, w->node[1]->result) ||
+        !peephole_single_read(ctx, w->node[0]->result))
+    {
+        return false;
+    }
+    list_remove(ctx->list, w->node[0]);
+    list_remove(ctx->list, w->node[1]);
+    return true;
+}
+
+static tPeepholeRule peephole_rules[] = {
+    {"pop-push", peephole_pop_push, 0},
+    {"move-push", peephole_move_push, 0},
+    {"pop-move", peephole_pop_move, 0},
+    {"move-move", peephole_move_move, 0},
+    {"binary-op", peephole_binary, 0},
+    {"unary-op", peephole_unary, 0},
+    {"push-push-jump", peephole_push_push_jump, 0},
+    {"push-pop", peephole_push_pop, 0},
+    {"jump-next", peephole_jump_next, 0},
+};
+
+#define PEEPHOLE_RULE_COUNT (sizeof(peephole_rules) / sizeof(peephole_rules[0]))
+
+/**
+ * Collects the window starting at an instruction. The window ends after
+ * the first label, so only a rule for the label itself can look past it.
+ *
+ * @param node First instruction, not a marker.
+ * @param window Output for the window.
+ */
+static void peephole_fill(tInstructionNode *node, tPeepholeWindow *window)
+{
+    window->count = 0;
+    while (node != NULL && window->count < PEEPHOLE_WINDOW)
+    {
+        window->node[window->count++] = node;
+        if (node->opType == OP_LABEL)
+        {
+            break;
+        }
+        node = peephole_next(node);
+    }
+}
+
+/**
+ * Tries all rules on the window starting at an instruction.
+ *
+ * @param ctx State of the sweep.
+ * @param node First instruction of the window.
+ * @return true if a rule rewrote the code.
+ */
+static bool peephole_match(tPeepholeContext *ctx, tInstructionNode *node)
+{
+    tPeepholeWindow window;
+    peephole_fill(node, &window);
+
+    for (size_t i = 0; i < PEEPHOLE_RULE_COUNT; i++)
+    {
+        if (peephole_rules[i].apply(ctx, &window))
+        {
+            peephole_rules[i].hits++;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Applies the rules once to every instruction of the list.
+ *
+ * @param ctx State of the sweep.
+ * @return Number of rewrites.
+ */
+static size_t peephole_sweep(tPeepholeContext *ctx)
+{
+    size_t rewrites = 0;
+    tInstructionNode *node = ctx->list->head;
+
+    while (node != NULL)
+    {
+        if (cfg_is_marker(node->opType))
+        {
+            node = node->next;
+            continue;
+        }
+        if (node->opType == OP_LABEL && cfg_is_function_label(node->result->value.label))
+        {
+            peephole_count_function(ctx, node);
+        }
+
+        // Remember where to continue, the window itself may be freed
+        tInstructionNode *before = peephole_prev(node);
+        if (!peephole_match(ctx, node))
+        {
+            node = peephole_next(node);
+            continue;
+        }
+        rewrites++;
+
+        // The rewrite may complete a pattern that starts up to three
+        // instructions earlier, within the same block
+        tInstructionNode *restart = before;
+        for (int i = 1; i < PEEPHOLE_WINDOW - 1 && restart != NULL && restart->opType != OP_LABEL;
+             i++)
+        {
+            tInstructionNode *prev = peephole_prev(restart);
+            if (prev == NULL || prev->opType == OP_LABEL)
+            {
+                break;
+            }
+            restart = prev;
+        }
+        if (restart == NULL)
+        {
+            node = ctx->list->head;
+        }
+        else if (restart->opType == OP_LABEL)
+        {
+            node = restart->next;
+        }
+        else
+        {
+            node = restart;
+        }
+    }
+    return rewrites;
+}
+
+size_t peephole_run(tThreeACList *list)
+{
+    tPeepholeContext ctx;
+    ctx.list = list;
+    strmap_init(&ctx.reads);
+
+    size_t total = 0;
+    size_t rewrites;
+    do
+    {
+        rewrites = peephole_sweep(&ctx);
+        total += rewrites;
+    } while (rewrites > 0);
+
+    strmap_dispose(&ctx.reads);
+
+    for (size_t i = 0; i < PEEPHOLE_RULE_COUNT; i++)
+    {
+        stats_rule_hits("peephole", peephole_rules[i].name, peephole_rules[i].hits);
+        peephole_rules[i].hits = 0;
+    }
+    return total;
+}
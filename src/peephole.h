@@ -0,0 +1,34 @@
+/**
+ * @file peephole.h
+ *
+ * IFJ25 project
+ *
+ * Peephole optimizer over the generated three-address code (-O1).
+ *
+ * The optimizer slides a window of up to four instructions over every
+ * function and replaces instruction sequences matched by the rules of a
+ * table, e.g. "PUSHS a; PUSHS b; ADDS; POPS c" by "ADD c a b". Comments and
+ * empty lines are skipped, a window never reaches past a label except for
+ * the jump to the label right behind it. The list is swept again until no
+ * rule matches.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_PEEPHOLE_H
+#define IFJ_PEEPHOLE_H
+
+#include "3AC.h"
+
+#include <stddef.h>
+
+/**
+ * Optimizes the code until no rule applies and reports the rule hits to the
+ * statistics.
+ *
+ * @param list The generated code.
+ * @return Total number of rewrites.
+ */
+size_t peephole_run(tThreeACList *list);
+
+#endif // IFJ_PEEPHOLE_H
@@ -0,0 +1,338 @@
+/**
+ * @file specialize.c
+ *
+ * IFJ25 project
+ *
+ * Specialization of functions by the types of their arguments (-O1).
+ *
+ * @author agent <agent@local>
+ */
+
+#include "specialize.h"
+#include "3AC_patterns.h"
+#include "cfg.h"
+#include "helper.h"
+#include "parser.h"
+#include "stats.h"
+#include "symtable.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool specializeFunctions = false;
+
+/**
+ * A function whose body can be parsed again.
+ */
+typedef struct
+{
+    char *name; // NULL for functions that were not recorded
+    char **paramNames;
+    int paramCount;
+    tToken *tokens;
+    size_t tokenCount;
+    size_t size;    // Instructions of the generic function
+    int cloneCount; // Copies emitted so far
+} tSpecFunction;
+
+/**
+ * A call with at least one known argument type.
+ */
+typedef struct
+{
+    int function; // Number from typeinfer_function()
+    tInstructionNode *call;
+    tRtType *types;
+} tSpecCall;
+
+/**
+ * A tuple of argument types of one function.
+ */
+typedef struct
+{
+    int function;
+    tRtType *types;
+    char *label;   // Label of the copy, NULL if there is none yet
+    bool rejected; // Over the budget or not smaller than the generic function
+} tSpecVariant;
+
+// Indexed by the function numbers of the type inference
+static tSpecFunction *functions = NULL;
+static int functionCount = 0;
+
+static tSpecCall *calls = NULL;
+static size_t callCount = 0;
+static size_t callCapacity = 0;
+
+static tSpecVariant *variants = NULL;
+static size_t variantCount = 0;
+static size_t variantCapacity = 0;
+
+void specialize_define(const char *key, const char *name, char **paramNames, int paramCount,
+                       tToken *tokens, size_t tokenCount, tInstructionNode *first,
+                       tInstructionNode *last)
+{
+    int index = typeinfer_function(key);
+    if (index >= functionCount)
+    {
+        functions = safeRealloc(functions, sizeof(tSpecFunction) * (index + 1));
+        for (int i = functionCount; i <= index; i++)
+        {
+            functions[i].name = NULL;
+            functions[i].tokens = NULL;
+            functions[i].tokenCount = 0;
+        }
+        functionCount = index + 1;
+    }
+
+    tSpecFunction *function = &functions[index];
+    function->name = safeMalloc(strlen(name) + 1);
+    strcpy(function->name, name);
+    function->paramNames = paramNames;
+    function->paramCount = paramCount;
+    function->tokens = tokens;
+    function->tokenCount = tokenCount;
+    function->size = cfg_count_instructions(first, last->next);
+    function->cloneCount = 0;
+}
+
+void specialize_record_call(const char *key, tInstructionNode *call, const tRtType *argTypes,
+                            int argCount)
+{
+    bool known = false;
+    for (int i = 0; i < argCount; i++)
+    {
+        known = known || (argTypes[i] != RT_ANY && argTypes[i] != RT_NONE);
+    }
+    if (!known)
+    {
+        return;
+    }
+
+    if (callCount == callCapacity)
+    {
+        callCapacity = callCapacity == 0 ? 16 : callCapacity * 2;
+        calls = safeRealloc(calls, sizeof(tSpecCall) * callCapacity);
+    }
+    tSpecCall *record = &calls[callCount++];
+    record->function = typeinfer_function(key);
+    record->call = call;
+    record->types = safeMalloc(sizeof(tRtType) * argCount);
+    for (int i = 0; i < argCount; i++)
+    {
+        record->types[i] = argTypes[i] == RT_NONE ? RT_ANY : argTypes[i];
+    }
+}
+
+/**
+ * Finds the variant of a function for a tuple of argument types, creating
+ * it on first use.
+ *
+ * @param function Number of the function.
+ * @param types Argument types, one per parameter.
+ * @return Index of the variant.
+ */
+static size_t specialize_variant(int function, const tRtType *types)
+{
+    int paramCount = functions[function].paramCount;
+    for (size_t i = 0; i < variantCount; i++)
+    {
+        if (variants[i].function == function &&
+            memcmp(variants[i].types, types, sizeof(tRtType) * paramCount) == 0)
+        {
+            return i;
+        }
+    }
+
+    if (variantCount == variantCapacity)
+    {
+        variantCapacity = variantCapacity == 0 ? 16 : variantCapacity * 2;
+        variants = safeRealloc(variants, sizeof(tSpecVariant) * variantCapacity);
+    }
+    tSpecVariant *variant = &variants[variantCount];
+    variant->function = function;
+    variant->types = safeMalloc(sizeof(tRtType) * paramCount);
+    memcpy(variant->types, types, sizeof(tRtType) * paramCount);
+    variant->label = NULL;
+    variant->rejected = false;
+    return variantCount++;
+}
+
+/**
+ * Parses the body of a function again with typed parameters and emits it
+ * at the end of the listing.
+ *
+ * @param function The function.
+ * @param types Types of the parameters.
+ * @param label Label of the copy.
+ * @param stack The symbol table stack with the global table.
+ */
+static void specialize_emit(const tSpecFunction *function, const tRtType *types,
+                            const char *label, tSymTableStack *stack)
+{
+    tSymTable *scope = safeMalloc(sizeof(tSymTable));
+    symtable_init(scope);
+    symtable_stack_push(stack, scope);
+
+    for (int i = 0; i < function->paramCount; i++)
+    {
+        tSymbolData paramData = {0};
+        paramData.kind = SYM_VAR;
+        paramData.dataType = TYPE_UNDEF;
+
+        const char *paramName = function->paramNames[i];
+        int len = snprintf(NULL, 0, "%s%%%d", paramName, threeACcode.varCounter);
+        paramData.unique_name = safeMalloc(len + 1);
+        sprintf(paramData.unique_name, "%s%%%d", paramName, threeACcode.varCounter++);
+        symtable_insert(scope, (char *)paramName, paramData);
+    }
+
+    tInstructionNode *prologueEnd = generate_function_prologue(
+        label, label, scope, function->paramNames, function->paramCount);
+
+    typeinfer_function_begin();
+    for (int i = 0; i < function->paramCount; i++)
+    {
+        tSymbolData *paramData = symtable_find(scope, function->paramNames[i]);
+        typeinfer_set(paramData->unique_name, types[i]);
+    }
+
+    parser_replay_begin(function->tokens, function->tokenCount);
+    tToken current = NULL;
+    get_next_token(NULL, &current);
+    parse_block(NULL, &current, stack, true);
+    freeToken(&current);
+    free(current);
+    parser_replay_end();
+
+    symtable_stack_pop(stack);
+    symtable_free(scope);
+    free(scope);
+
+    generate_function_epilogue(prologueEnd);
+}
+
+/**
+ * Forgets the calls recorded from a position on.
+ *
+ * @param count Number of calls to keep.
+ */
+static void specialize_truncate_calls(size_t count)
+{
+    while (callCount > count)
+    {
+        callCount--;
+        free(calls[callCount].types);
+    }
+}
+
+/**
+ * Frees all memory held by the pass.
+ */
+static void specialize_dispose(void)
+{
+    for (int i = 0; i < functionCount; i++)
+    {
+        for (size_t j = 0; j < functions[i].tokenCount; j++)
+        {
+            freeToken(&functions[i].tokens[j]);
+            free(functions[i].tokens[j]);
+        }
+        free(functions[i].tokens);
+        free(functions[i].name);
+    }
+    for (size_t i = 0; i < variantCount; i++)
+    {
+        free(variants[i].types);
+        free(variants[i].label);
+    }
+    specialize_truncate_calls(0);
+    free(functions);
+    free(calls);
+    free(variants);
+    functions = NULL;
+    calls = NULL;
+    variants = NULL;
+    functionCount = 0;
+    callCapacity = 0;
+    variantCount = variantCapacity = 0;
+}
+
+void specialize_run(tSymTableStack *stack)
+{
+    size_t budget = cfg_count_instructions(threeACcode.head, NULL) * SPECIALIZE_BUDGET_PERCENT / 100;
+    if (budget < SPECIALIZE_MIN_BUDGET)
+    {
+        budget = SPECIALIZE_MIN_BUDGET;
+    }
+
+    size_t clones = 0;
+    size_t rewritten = 0;
+    size_t unprofitable = 0;
+
+    // Copies add calls of their own at the end of the list
+    for (size_t i = 0; i < callCount; i++)
+    {
+        int function = calls[i].function;
+        if (function >= functionCount || functions[function].name == NULL)
+        {
+            continue;
+        }
+
+        size_t variant = specialize_variant(function, calls[i].types);
+        if (variants[variant].label == NULL && !variants[variant].rejected)
+        {
+            tSpecFunction *generic = &functions[function];
+            if (generic->cloneCount == SPECIALIZE_MAX_CLONES || generic->size > budget)
+            {
+                variants[variant].rejected = true;
+                continue;
+            }
+
+            int labelLen = snprintf(NULL, 0, "%s$%d%%func$%d", generic->name, generic->paramCount,
+                                    generic->cloneCount);
+            char *label = safeMalloc(labelLen + 1);
+            sprintf(label, "%s$%d%%func$%d", generic->name, generic->paramCount,
+                    generic->cloneCount);
+
+            size_t mark = callCount;
+            tInstructionNode *before = threeACcode.active;
+            specialize_emit(generic, variants[variant].types, label, stack);
+            size_t size = cfg_count_instructions(before->next, NULL);
+
+            // Typed operators are shorter than the dispatch, an equal size
+            // means the known types did not help
+            if (size >= generic->size)
+            {
+                while (before->next != NULL)
+                {
+                    list_remove(&threeACcode, before->next);
+                }
+                specialize_truncate_calls(mark);
+                free(label);
+                variants[variant].rejected = true;
+                unprofitable++;
+                continue;
+            }
+
+            budget -= size;
+            generic->cloneCount++;
+            variants[variant].label = label;
+            clones++;
+        }
+
+        if (variants[variant].label != NULL)
+        {
+            tInstructionNode *call = calls[i].call;
+            free(call->result->value.label);
+            free(call->result);
+            call->result = create_operand_from_label(variants[variant].label);
+            rewritten++;
+        }
+    }
+
+    stats_rule_hits("specialize", "clone", clones);
+    stats_rule_hits("specialize", "unprofitable", unprofitable);
+    stats_rule_hits("specialize", "redirected-call", rewritten);
+    specialize_dispose();
+}
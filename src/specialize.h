@@ -0,0 +1,81 @@
+/**
+ * @file specialize.h
+ *
+ * IFJ25 project
+ *
+ * Specialization of functions by the types of their arguments (-O1).
+ *
+ * Parameters have no known type, so the operators in a function body use
+ * the generic dispatch. The parser records the tokens of every function body
+ * and the argument types known at every call. After the whole program has
+ * been parsed, the body is parsed again for each distinct tuple of argument
+ * types with the parameters typed, and emitted as a copy labelled
+ * "name$N%func$K". The calls with that tuple are then redirected to the
+ * copy. A copy that is not smaller than the generic function is dropped,
+ * and the copies together may grow the program only by a fixed budget. The
+ * generic function stays for all other calls.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_SPECIALIZE_H
+#define IFJ_SPECIALIZE_H
+
+#include "3AC.h"
+#include "scanner.h"
+#include "symstack.h"
+#include "typeinfer.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Copies of one function
+#define SPECIALIZE_MAX_CLONES 4
+
+// Growth of the program allowed for all copies, in percent of its instructions
+#define SPECIALIZE_BUDGET_PERCENT 25
+
+// Growth allowed for small programs, in instructions
+#define SPECIALIZE_MIN_BUDGET 400
+
+// Specialized copies are generated (-O1 and -O2)
+extern bool specializeFunctions;
+
+/**
+ * Registers a parsed function that may be specialized.
+ *
+ * @param key Symbol table key of the function, e.g. "add@2".
+ * @param name Name of the function.
+ * @param paramNames Names of the parameters, owned by the symbol table.
+ * @param paramCount Number of parameters.
+ * @param tokens Recorded tokens of the body, owned by this module from now on.
+ * @param tokenCount Number of tokens.
+ * @param first Label of the generic function.
+ * @param last Last instruction of the generic function.
+ */
+void specialize_define(const char *key, const char *name, char **paramNames, int paramCount,
+                       tToken *tokens, size_t tokenCount, tInstructionNode *first,
+                       tInstructionNode *last);
+
+/**
+ * Records a call of a user function. Calls without any known argument type
+ * are ignored.
+ *
+ * @param key Symbol table key of the function.
+ * @param call The CALL instruction.
+ * @param argTypes Types of the arguments.
+ * @param argCount Number of arguments.
+ */
+void specialize_record_call(const char *key, tInstructionNode *call, const tRtType *argTypes,
+                            int argCount);
+
+/**
+ * Emits the specialized copies after the last function, redirects the calls
+ * to them and reports both to the statistics. Calls inside the copies are
+ * specialized too.
+ *
+ * @param stack The symbol table stack with the global table.
+ */
+void specialize_run(tSymTableStack *stack);
+
+#endif // IFJ_SPECIALIZE_H
@@ -0,0 +1,435 @@
+/**
+ * @file stats.c
+ *
+ * IFJ25 project
+ *
+ * Generated code statistics (--stats).
+ *
+ * @author agent <agent@local>
+ */
+
+#include "stats.h"
+#include "cfg.h"
+#include "helper.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define STATS_OP_COUNT (NO_OP + 1)
+
+/**
+ * Counters of one function or of the whole program.
+ */
+typedef struct
+{
+    const char *name;
+    size_t ops[STATS_OP_COUNT];
+    size_t instructions;
+    size_t defvars;
+    size_t temps;
+    size_t labels;
+    size_t pushs;
+    size_t pops;
+} tCodeStats;
+
+/**
+ * Aggregated cost of one code pattern over all its uses.
+ */
+typedef struct
+{
+    char *name;
+    size_t uses;
+    size_t instructions;
+    size_t minCost;
+    size_t maxCost;
+    bool loop;
+} tPatternStats;
+
+/**
+ * Hits of one rewrite rule of an optimization pass.
+ */
+typedef struct
+{
+    const char *pass;
+    const char *name;
+    size_t hits;
+} tRuleStats;
+
+bool statsEnabled = false;
+
+static tPatternStats *patterns = NULL;
+static size_t patternCount = 0;
+static size_t patternCapacity = 0;
+
+static tRuleStats *rules = NULL;
+static size_t ruleCount = 0;
+
+void stats_enable(void)
+{
+    statsEnabled = true;
+}
+
+tInstructionNode *stats_pattern_begin(void)
+{
+    return statsEnabled ? threeACcode.active : NULL;
+}
+
+/**
+ * Finds the index of a label inside a pattern.
+ *
+ * @param nodes Instructions of the pattern.
+ * @param count Number of instructions.
+ * @param label Label name.
+ * @return Index of the LABEL instruction, or count if the label is outside the pattern.
+ */
+static size_t stats_find_label(tInstructionNode **nodes, size_t count, const char *label)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (nodes[i]->opType == OP_LABEL && nodes[i]->result != NULL &&
+            strcmp(nodes[i]->result->value.label, label) == 0)
+        {
+            return i;
+        }
+    }
+    return count;
+}
+
+/**
+ * Updates the shortest and longest path to a successor instruction.
+ *
+ * @param minDist Shortest known path costs.
+ * @param maxDist Longest known path costs.
+ * @param reached Whether an instruction was reached yet.
+ * @param target Index of the successor.
+ * @param minCost Cost of the shortest path through the current instruction.
+ * @param maxCost Cost of the longest path through the current instruction.
+ */
+static void stats_relax(size_t *minDist, size_t *maxDist, bool *reached, size_t target,
+                        size_t minCost, size_t maxCost)
+{
+    if (!reached[target] || minCost < minDist[target])
+    {
+        minDist[target] = minCost;
+    }
+    if (!reached[target] || maxCost > maxDist[target])
+    {
+        maxDist[target] = maxCost;
+    }
+    reached[target] = true;
+}
+
+void stats_pattern_end(const char *name, tInstructionNode *before)
+{
+    if (!statsEnabled)
+    {
+        return;
+    }
+
+    tInstructionNode *first = before != NULL ? before->next : threeACcode.head;
+    tInstructionNode *last = threeACcode.active;
+
+    size_t count = 0;
+    for (tInstructionNode *node = first; node != NULL && before != last; node = node->next)
+    {
+        count++;
+        if (node == last)
+        {
+            break;
+        }
+    }
+
+    tInstructionNode **nodes = safeMalloc(sizeof(tInstructionNode *) * (count + 1));
+    size_t *minDist = safeMalloc(sizeof(size_t) * (count + 1));
+    size_t *maxDist = safeMalloc(sizeof(size_t) * (count + 1));
+    bool *reached = safeMalloc(sizeof(bool) * (count + 1));
+
+    size_t index = 0;
+    for (tInstructionNode *node = first; index < count; node = node->next)
+    {
+        nodes[index++] = node;
+    }
+    for (size_t i = 0; i <= count; i++)
+    {
+        minDist[i] = maxDist[i] = 0;
+        reached[i] = false;
+    }
+
+    // Instructions are visited in program order, back edges are only recorded,
+    // so the longest path is the longest path through one iteration
+    size_t staticCount = 0;
+    bool loop = false;
+    reached[0] = true;
+    for (size_t i = 0; i < count; i++)
+    {
+        tOperationType op = nodes[i]->opType;
+        if (!cfg_is_marker(op))
+        {
+            staticCount++;
+        }
+        if (!reached[i])
+        {
+            continue;
+        }
+
+        size_t cost = (cfg_is_marker(op) || op == OP_LABEL) ? 0 : 1;
+        size_t minCost = minDist[i] + cost;
+        size_t maxCost = maxDist[i] + cost;
+
+        if (cfg_is_jump(op))
+        {
+            size_t target = stats_find_label(nodes, count, nodes[i]->result->value.label);
+            if (target <= i)
+            {
+                loop = true;
+            }
+            else
+            {
+                stats_relax(minDist, maxDist, reached, target, minCost, maxCost);
+            }
+        }
+        if (op != OP_JUMP && op != OP_EXIT && op != OP_RETURN)
+        {
+            stats_relax(minDist, maxDist, reached, i + 1, minCost, maxCost);
+        }
+    }
+
+    tPatternStats *pattern = NULL;
+    for (size_t i = 0; i < patternCount; i++)
+    {
+        if (strcmp(patterns[i].name, name) == 0)
+        {
+            pattern = &patterns[i];
+            break;
+        }
+    }
+    if (pattern == NULL)
+    {
+        if (patternCount == patternCapacity)
+        {
+            patternCapacity = patternCapacity == 0 ? 16 : patternCapacity * 2;
+            patterns = safeRealloc(patterns, sizeof(tPatternStats) * patternCapacity);
+        }
+        pattern = &patterns[patternCount++];
+        pattern->name = safeMalloc(strlen(name) + 1);
+        strcpy(pattern->name, name);
+        pattern->uses = 0;
+        pattern->instructions = 0;
+        pattern->minCost = minDist[count];
+        pattern->maxCost = maxDist[count];
+        pattern->loop = false;
+    }
+
+    pattern->uses++;
+    pattern->instructions += staticCount;
+    pattern->loop = pattern->loop || loop;
+    if (minDist[count] < pattern->minCost)
+    {
+        pattern->minCost = minDist[count];
+    }
+    if (maxDist[count] > pattern->maxCost)
+    {
+        pattern->maxCost = maxDist[count];
+    }
+
+    free(nodes);
+    free(minDist);
+    free(maxDist);
+    free(reached);
+}
+
+void stats_rule_hits(const char *pass, const char *rule, size_t hits)
+{
+    if (!statsEnabled)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < ruleCount; i++)
+    {
+        if (strcmp(rules[i].pass, pass) == 0 && strcmp(rules[i].name, rule) == 0)
+        {
+            rules[i].hits += hits;
+            return;
+        }
+    }
+
+    // Pass and rule names are string literals of the passes
+    rules = safeRealloc(rules, sizeof(tRuleStats) * (ruleCount + 1));
+    rules[ruleCount].pass = pass;
+    rules[ruleCount].name = rule;
+    rules[ruleCount].hits = hits;
+    ruleCount++;
+}
+
+/**
+ * Adds one instruction to the counters.
+ *
+ * @param stats Counters to update.
+ * @param node The instruction.
+ */
+static void stats_count(tCodeStats *stats, const tInstructionNode *node)
+{
+    if (cfg_is_marker(node->opType))
+    {
+        return;
+    }
+
+    stats->ops[node->opType]++;
+    stats->instructions++;
+
+    switch (node->opType)
+    {
+        case OP_DEFVAR:
+            stats->defvars++;
+            if (node->result->type == OPP_VAR && strchr(node->result->value.varname, '%') == NULL)
+            {
+                stats->temps++;
+            }
+            break;
+        case OP_LABEL:
+            stats->labels++;
+            break;
+        case OP_PUSHS:
+            stats->pushs++;
+            break;
+        case OP_POPS:
+            stats->pops++;
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Prints the counters as the members of a JSON object.
+ *
+ * @param out Output stream.
+ * @param stats Counters to print.
+ * @param indent Indentation of the members.
+ */
+static void stats_print_counters(FILE *out, const tCodeStats *stats, const char *indent)
+{
+    double ratio = stats->instructions > 0
+                       ? (double)(stats->pushs + stats->pops) / (double)stats->instructions
+                       : 0.0;
+
+    fprintf(out, "%s\"instructions\": %zu,\n", indent, stats->instructions);
+    fprintf(out, "%s\"defvars\": %zu,\n", indent, stats->defvars);
+    fprintf(out, "%s\"temps\": %zu,\n", indent, stats->temps);
+    fprintf(out, "%s\"labels\": %zu,\n", indent, stats->labels);
+    fprintf(out, "%s\"pushs\": %zu,\n", indent, stats->pushs);
+    fprintf(out, "%s\"pops\": %zu,\n", indent, stats->pops);
+    fprintf(out, "%s\"stackOpRatio\": %.3f,\n", indent, ratio);
+    fprintf(out, "%s\"ops\": {", indent);
+
+    bool first = true;
+    for (int op = 0; op < STATS_OP_COUNT; op++)
+    {
+        if (stats->ops[op] > 0)
+        {
+            fprintf(out, "%s\"%s\": %zu", first ? "" : ", ", operation_to_string(op),
+                    stats->ops[op]);
+            first = false;
+        }
+    }
+    fprintf(out, "}");
+}
+
+/**
+ * Orders patterns by name for qsort.
+ *
+ * @param a First pattern.
+ * @param b Second pattern.
+ * @return Result of strcmp on the names.
+ */
+static int stats_compare_patterns(const void *a, const void *b)
+{
+    return strcmp(((const tPatternStats *)a)->name, ((const tPatternStats *)b)->name);
+}
+
+void stats_report(tThreeACList *list, FILE *out)
+{
+    tCodeStats program = {0};
+    tCodeStats *functions = NULL;
+    size_t functionCount = 0;
+    size_t globals = 0;
+
+    for (tInstructionNode *node = list->globalDefHead; node != NULL; node = node->next)
+    {
+        globals++;
+    }
+
+    for (tInstructionNode *node = list->head; node != NULL; node = node->next)
+    {
+        if (node->opType == OP_LABEL && cfg_is_function_label(node->result->value.label))
+        {
+            functions = safeRealloc(functions, sizeof(tCodeStats) * (functionCount + 1));
+            memset(&functions[functionCount], 0, sizeof(tCodeStats));
+            functions[functionCount].name = node->result->value.label;
+            functionCount++;
+        }
+
+        stats_count(&program, node);
+        if (functionCount > 0)
+        {
+            stats_count(&functions[functionCount - 1], node);
+        }
+    }
+
+    fprintf(out, "{\n  \"program\": {\n");
+    fprintf(out, "    \"functions\": %zu,\n", functionCount);
+    fprintf(out, "    \"globals\": %zu,\n", globals);
+    stats_print_counters(out, &program, "    ");
+    fprintf(out, "\n  },\n  \"functions\": [\n");
+
+    for (size_t i = 0; i < functionCount; i++)
+    {
+        fprintf(out, "    {\n      \"name\": \"%s\",\n", functions[i].name);
+        stats_print_counters(out, &functions[i], "      ");
+        fprintf(out, "\n    }%s\n", i + 1 < functionCount ? "," : "");
+    }
+
+    fprintf(out, "  ],\n  \"patterns\": [\n");
+
+    if (patternCount > 0)
+    {
+        qsort(patterns, patternCount, sizeof(tPatternStats), stats_compare_patterns);
+    }
+    for (size_t i = 0; i < patternCount; i++)
+    {
+        const tPatternStats *p = &patterns[i];
+        fprintf(out,
+                "    {\"name\": \"%s\", \"uses\": %zu, \"instructions\": %zu, "
+                "\"minCost\": %zu, \"maxCost\": %zu, \"loop\": %s}%s\n",
+                p->name, p->uses, p->instructions, p->minCost, p->maxCost,
+                p->loop ? "true" : "false", i + 1 < patternCount ? "," : "");
+    }
+
+    fprintf(out, "  ],\n  \"rules\": [\n");
+
+    for (size_t i = 0; i < ruleCount; i++)
+    {
+        fprintf(out, "    {\"pass\": \"%s\", \"name\": \"%s\", \"hits\": %zu}%s\n",
+                rules[i].pass, rules[i].name, rules[i].hits, i + 1 < ruleCount ? "," : "");
+    }
+
+    fprintf(out, "  ]\n}\n");
+    free(functions);
+}
+
+void stats_dispose(void)
+{
+    for (size_t i = 0; i < patternCount; i++)
+    {
+        free(patterns[i].name);
+    }
+    free(patterns);
+    patterns = NULL;
+    patternCount = 0;
+    patternCapacity = 0;
+
+    free(rules);
+    rules = NULL;
+    ruleCount = 0;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file stats.h
+ *
+ * IFJ25 project
+ *
+ * Generated code statistics (--stats).
+ *
+ * The report is JSON with three parts: totals of the whole program, the same
+ * counters for every function (keyed by its mangled label, e.g. "foo$2%func")
+ * and an estimate of the dynamic cost of every code pattern from
+ * 3AC_patterns.c that was used. A pattern's cost is the number of executed
+ * instructions on its shortest and longest path to the end of the pattern,
+ * paths ending in EXIT (runtime errors) are not counted. The last part
+ * lists how often each rewrite rule of the optimization passes fired.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_STATS_H
+#define IFJ_STATS_H
+
+#include "3AC.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+extern bool statsEnabled;
+
+/**
+ * Turns the collection of pattern costs on.
+ */
+void stats_enable(void);
+
+/**
+ * Marks the start of a code pattern.
+ *
+ * @return The last instruction emitted before the pattern, pass it to stats_pattern_end().
+ */
+tInstructionNode *stats_pattern_begin(void);
+
+/**
+ * Measures the instructions emitted since stats_pattern_begin().
+ *
+ * @param name Name of the pattern, e.g. "Ifj.write" or "operator +".
+ * @param before The value returned by stats_pattern_begin().
+ */
+void stats_pattern_end(const char *name, tInstructionNode *before);
+
+/**
+ * Adds the hits of a rewrite rule of an optimization pass.
+ *
+ * @param pass Name of the pass, e.g. "peephole".
+ * @param rule Name of the rule.
+ * @param hits Number of rewrites made by the rule.
+ */
+void stats_rule_hits(const char *pass, const char *rule, size_t hits);
+
+/**
+ * Prints the statistics of the generated code as JSON.
+ *
+ * @param list The generated code.
+ * @param out Output stream.
+ */
+void stats_report(tThreeACList *list, FILE *out);
+
+/**
+ * Releases the collected pattern statistics.
+ */
+void stats_dispose(void);
+
+#endif // IFJ_STATS_H
@@ -0,0 +1,142 @@
+/**
+ * @file strmap.c
+ *
+ * IFJ25 project
+ *
+ * Open-addressing hash map from strings to indices.
+ *
+ * @author agent <agent@local>
+ */
+
+#include "strmap.h"
+
+#define STRMAP_INITIAL_CAPACITY 64
+
+/**
+ * FNV-1a hash of a NUL-terminated string.
+ *
+ * @param key The string to hash.
+ * @return The hash value.
+ */
+static size_t strmap_hash(const char *key)
+{
+    size_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)key; *p != '\0'; p++)
+    {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Finds the slot for a key using linear probing.
+ *
+ * @param entries The slot array.
+ * @param capacity Number of slots (power of two).
+ * @param key The key to find.
+ * @return Pointer to the slot holding the key or to the empty slot where it belongs.
+ */
+static tStrMapEntry *strmap_find_slot(tStrMapEntry *entries, size_t capacity, const char *key)
+{
+    size_t index = strmap_hash(key) & (capacity - 1);
+    while (entries[index].key != NULL && strcmp(entries[index].key, key) != 0)
+    {
+        index = (index + 1) & (capacity - 1);
+    }
+    return &entries[index];
+}
+
+/**
+ * Doubles the capacity of the map and rehashes all entries.
+ *
+ * @param map The map to grow.
+ */
+static void strmap_grow(tStrMap *map)
+{
+    size_t newCapacity = map->capacity ? map->capacity * 2 : STRMAP_INITIAL_CAPACITY;
+    tStrMapEntry *newEntries = safeMalloc(newCapacity * sizeof(tStrMapEntry));
+    for (size_t i = 0; i < newCapacity; i++)
+    {
+        newEntries[i].key = NULL;
+    }
+
+    for (size_t i = 0; i < map->capacity; i++)
+    {
+        if (map->entries[i].key != NULL)
+        {
+            *strmap_find_slot(newEntries, newCapacity, map->entries[i].key) = map->entries[i];
+        }
+    }
+
+    free(map->entries);
+    map->entries = newEntries;
+    map->capacity = newCapacity;
+}
+
+void strmap_init(tStrMap *map)
+{
+    map->entries = NULL;
+    map->capacity = 0;
+    map->count = 0;
+}
+
+void strmap_dispose(tStrMap *map)
+{
+    for (size_t i = 0; i < map->capacity; i++)
+    {
+        free(map->entries[i].key);
+    }
+    free(map->entries);
+    strmap_init(map);
+}
+
+void strmap_clear(tStrMap *map)
+{
+    if (map->count == 0)
+    {
+        return;
+    }
+    for (size_t i = 0; i < map->capacity; i++)
+    {
+        free(map->entries[i].key);
+        map->entries[i].key = NULL;
+    }
+    map->count = 0;
+}
+
+void strmap_put(tStrMap *map, const char *key, size_t value)
+{
+    if ((map->count + 1) * 2 > map->capacity)
+    {
+        strmap_grow(map);
+    }
+
+    tStrMapEntry *slot = strmap_find_slot(map->entries, map->capacity, key);
+    if (slot->key == NULL)
+    {
+        slot->key = safeMalloc(strlen(key) + 1);
+        strcpy(slot->key, key);
+        map->count++;
+    }
+    slot->value = value;
+}
+
+bool strmap_get(const tStrMap *map, const char *key, size_t *value)
+{
+    if (map->capacity == 0)
+    {
+        return false;
+    }
+
+    tStrMapEntry *slot = strmap_find_slot(map->entries, map->capacity, key);
+    if (slot->key == NULL)
+    {
+        return false;
+    }
+    if (value != NULL)
+    {
+        *value = slot->value;
+    }
+    return true;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file strmap.h
+ *
+ * IFJ25 project
+ *
+ * Open-addressing hash map from strings to indices, used by the IR
+ * utilities wherever a name has to be resolved in constant time
+ * (label lookup, operand interning, variable numbering).
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_STRMAP_H
+#define IFJ_STRMAP_H
+
+#include "helper.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * A single slot of the map. Empty slots have key == NULL.
+ */
+typedef struct
+{
+    char *key;
+    size_t value;
+} tStrMapEntry;
+
+/**
+ * The map itself. Capacity is always a power of two.
+ */
+typedef struct
+{
+    tStrMapEntry *entries;
+    size_t capacity;
+    size_t count;
+} tStrMap;
+
+/**
+ * Initializes an empty map.
+ *
+ * @param map The map to initialize.
+ */
+void strmap_init(tStrMap *map);
+
+/**
+ * Frees all keys and the slot array of the map.
+ *
+ * @param map The map to dispose.
+ */
+void strmap_dispose(tStrMap *map);
+
+/**
+ * Removes all keys but keeps the allocated slots.
+ *
+ * @param map The map to clear.
+ */
+void strmap_clear(tStrMap *map);
+
+/**
+ * Inserts a key or overwrites the value of an existing one.
+ * The key is copied.
+ *
+ * @param map The map.
+ * @param key The key to insert.
+ * @param value The value to associate with the key.
+ */
+void strmap_put(tStrMap *map, const char *key, size_t value);
+
+/**
+ * Looks up a key.
+ *
+ * @param map The map.
+ * @param key The key to look up.
+ * @param value Output for the stored value, may be NULL.
+ * @return true if the key is present, false otherwise.
+ */
+bool strmap_get(const tStrMap *map, const char *key, size_t *value);
+
+#endif // IFJ_STRMAP_H
@@ -0,0 +1,267 @@
+/**
+ * @file tailcall.c
+ *
+ * IFJ25 project
+ *
+ * Tail-call elimination for self-recursive functions (-O1).
+ *
+ * @author agent <agent@local>
+ */
+
+#include "tailcall.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "helper.h"
+#include "stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Skips comments and empty lines.
+ *
+ * @param node The instruction to start at, may be NULL.
+ * @return The first instruction that is not a marker, or NULL.
+ */
+static tInstructionNode *tailcall_skip_markers(tInstructionNode *node)
+{
+    while (node != NULL && cfg_is_marker(node->opType))
+    {
+        node = node->next;
+    }
+    return node;
+}
+
+/**
+ * Returns the number of a parameter variable.
+ *
+ * @param operand The operand, may be NULL.
+ * @return N for LF@%paramN or TF@%paramN, -1 for other operands.
+ */
+static int tailcall_param_number(const tOperand *operand)
+{
+    if (operand == NULL || (operand->type != OPP_VAR && operand->type != OPP_TF_VAR) ||
+        strncmp(operand->value.varname, "%param", 6) != 0)
+    {
+        return -1;
+    }
+    return atoi(operand->value.varname + 6);
+}
+
+/**
+ * Finds the CREATEFRAME that starts the call sequence of a CALL.
+ *
+ * @param call The CALL instruction.
+ * @return The CREATEFRAME, or NULL if the sequence differs from
+ *         CREATEFRAME, DEFVAR TF@%paramN..., POPS TF@%paramN..., PUSHFRAME.
+ */
+static tInstructionNode *tailcall_call_start(tInstructionNode *call)
+{
+    tInstructionNode *node = call->prev;
+    if (node == NULL || node->opType != OP_PUSHFRAME)
+    {
+        return NULL;
+    }
+    int pops = 0;
+    for (node = node->prev; node != NULL && node->opType == OP_POPS &&
+                            tailcall_param_number(node->result) >= 0;
+         node = node->prev)
+    {
+        pops++;
+    }
+    int defvars = 0;
+    for (; node != NULL && node->opType == OP_DEFVAR && node->result->type == OPP_TF_VAR;
+         node = node->prev)
+    {
+        defvars++;
+    }
+    return node != NULL && node->opType == OP_CREATEFRAME && pops == defvars ? node : NULL;
+}
+
+/**
+ * Checks whether the function returns the result of a call right away.
+ *
+ * @param call The CALL instruction.
+ * @return true if POPFRAME, the copy of TF@%retval to LF@%retval and RETURN follow.
+ */
+static bool tailcall_is_tail(tInstructionNode *call)
+{
+    tInstructionNode *node = call->next;
+    if (node == NULL || node->opType != OP_POPFRAME)
+    {
+        return false;
+    }
+
+    node = tailcall_skip_markers(node->next);
+    if (node != NULL && node->opType == OP_MOVE &&
+        cfg_is_var(node->result, OPP_VAR, "%retval") &&
+        cfg_is_var(node->arg1, OPP_TF_VAR, "%retval"))
+    {
+        node = tailcall_skip_markers(node->next);
+    }
+    else if (node != NULL && node->opType == OP_PUSHS &&
+             cfg_is_var(node->result, OPP_TF_VAR, "%retval"))
+    {
+        node = tailcall_skip_markers(node->next);
+        if (node == NULL || node->opType != OP_POPS ||
+            !cfg_is_var(node->result, OPP_VAR, "%retval"))
+        {
+            return false;
+        }
+        node = tailcall_skip_markers(node->next);
+    }
+    else
+    {
+        return false;
+    }
+
+    return node != NULL && node->opType == OP_RETURN;
+}
+
+/**
+ * Replaces the self-recursive tail calls of one function.
+ *
+ * @param list The generated code.
+ * @param cfg Graph of the function.
+ * @return Number of replaced calls.
+ */
+static size_t tailcall_function(tThreeACList *list, const tCfg *cfg)
+{
+    if (strstr(cfg->name, "%func") == NULL)
+    {
+        return 0;
+    }
+
+    tInstructionNode *end = cfg->last->next;
+    size_t siteCount = 0;
+    for (tInstructionNode *node = cfg->first; node != end; node = node->next)
+    {
+        if (node->opType == OP_CALL && strcmp(node->result->value.label, cfg->name) == 0 &&
+            tailcall_call_start(node) != NULL && tailcall_is_tail(node))
+        {
+            siteCount++;
+        }
+    }
+    if (siteCount == 0 || dataflow_reads_uninitialized(cfg))
+    {
+        return 0;
+    }
+
+    // The prologue declares the variables and copies the parameters
+    int paramCount = 0;
+    const char **params = NULL;
+    tInstructionNode *prologueEnd = cfg->first;
+    for (tInstructionNode *node = cfg->first->next; node != end; node = node->next)
+    {
+        int param = node->opType == OP_MOVE ? tailcall_param_number(node->arg1) : -1;
+        if (param >= 0 && node->arg1->type == OPP_VAR && node->result->type == OPP_VAR)
+        {
+            if (param >= paramCount)
+            {
+                params = safeRealloc(params, sizeof(char *) * (param + 1));
+                for (int p = paramCount; p <= param; p++)
+                {
+                    params[p] = NULL;
+                }
+                paramCount = param + 1;
+            }
+            params[param] = node->result->value.varname;
+        }
+        else if (!cfg_is_marker(node->opType) && node->opType != OP_DEFVAR &&
+                 !(node->opType == OP_MOVE && cfg_is_var(node->result, OPP_VAR, "%retval") &&
+                   node->arg1->type == OPP_CONST_NIL))
+        {
+            break;
+        }
+        if (!cfg_is_marker(node->opType))
+        {
+            prologueEnd = node;
+        }
+    }
+    for (tInstructionNode *node = prologueEnd->next; node != end; node = node->next)
+    {
+        if (node->opType == OP_DEFVAR && node->result->type == OPP_VAR)
+        {
+            free(params);
+            return 0;
+        }
+    }
+
+    char *loopName = threeAC_create_label(list);
+    list->active = prologueEnd;
+    list_InsertAfter(list, OP_LABEL, create_operand_from_label(loopName), NULL, NULL);
+
+    size_t replaced = 0;
+    tInstructionNode *next;
+    for (tInstructionNode *node = prologueEnd->next; node != end; node = next)
+    {
+        next = node->next;
+        if (node->opType != OP_CALL || strcmp(node->result->value.label, cfg->name) != 0 ||
+            !tailcall_is_tail(node))
+        {
+            continue;
+        }
+        tInstructionNode *start = tailcall_call_start(node);
+        if (start == NULL)
+        {
+            continue;
+        }
+
+        bool known = true;
+        for (tInstructionNode *pop = start->next; pop != node->prev; pop = pop->next)
+        {
+            int param = tailcall_param_number(pop->result);
+            known = known && (pop->opType != OP_POPS ||
+                              (param < paramCount && params[param] != NULL));
+        }
+        if (!known)
+        {
+            continue;
+        }
+
+        // The arguments are on the data stack, so no parameter is read after its POPS
+        tInstructionNode *popFrame = node->next;
+        tInstructionNode *current = start;
+        while (current != node)
+        {
+            tInstructionNode *following = current->next;
+            if (current->opType == OP_POPS)
+            {
+                current->result =
+                    create_operand_from_variable(params[tailcall_param_number(current->result)],
+                                                 false);
+            }
+            else
+            {
+                list_remove(list, current);
+            }
+            current = following;
+        }
+        list_remove(list, popFrame);
+        node->opType = OP_JUMP;
+        node->result = create_operand_from_label(loopName);
+        next = node->next;
+        replaced++;
+    }
+
+    free(loopName);
+    free(params);
+    return replaced;
+}
+
+size_t tailcall_run(tThreeACList *list)
+{
+    int count;
+    size_t replaced = 0;
+
+    tCfg *cfgs = cfg_build_program(list, &count);
+    for (int i = 0; i < count; i++)
+    {
+        replaced += tailcall_function(list, &cfgs[i]);
+    }
+    cfg_dispose_program(cfgs, count);
+    list->active = list->tail;
+
+    stats_rule_hits("tailcall", "replaced", replaced);
+    return replaced;
+}
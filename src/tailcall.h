@@ -0,0 +1,38 @@
+/**
+ * @file tailcall.h
+ *
+ * IFJ25 project
+ *
+ * Tail-call elimination for self-recursive functions (-O1).
+ *
+ * `return f(args)` inside f compiles to
+ *     CREATEFRAME, DEFVAR TF@%paramN, POPS TF@%paramN, PUSHFRAME, CALL f,
+ *     POPFRAME, the copy of TF@%retval to %retval, RETURN.
+ * The pass pops the arguments straight into the parameter variables of the
+ * running call and jumps to a label behind the prologue (the DEFVARs and
+ * the copies of %paramN), so the recursion runs as a loop in one frame.
+ * %retval is still nil at such a call, because every assignment to it is
+ * followed by RETURN. Functions that may read a variable before assigning it
+ * are left alone, as the next iteration would see the old value instead of
+ * failing.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_TAILCALL_H
+#define IFJ_TAILCALL_H
+
+#include "3AC.h"
+
+#include <stddef.h>
+
+/**
+ * Replaces self-recursive tail calls by jumps and reports them to the
+ * statistics.
+ *
+ * @param list The generated code.
+ * @return Number of replaced calls.
+ */
+size_t tailcall_run(tThreeACList *list);
+
+#endif // IFJ_TAILCALL_H
@@ -0,0 +1,410 @@
+/**
+ * @file tempalloc.c
+ *
+ * IFJ25 project
+ *
+ * Reuse of temporary variables (-O1).
+ *
+ * A live range is approximated by an interval of positions in the listing
+ * that covers every point where the temporary is live, so two temporaries
+ * with disjoint intervals never hold a value at the same time. A temporary
+ * that may be read before it is assigned keeps its own variable, sharing
+ * it would replace the runtime error by a stale value.
+ *
+ * @author agent <agent@local>
+ */
+
+#include "tempalloc.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "helper.h"
+#include "stats.h"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Functions with more blocks * temporaries are skipped to bound the memory of the analysis
+#define TEMPALLOC_MAX_BITS ((size_t)1 << 26)
+
+/**
+ * Live interval of one temporary.
+ */
+typedef struct
+{
+    int temp;
+    size_t start;
+    size_t end;
+} tTempInterval;
+
+/**
+ * A slot occupied until the end of an interval.
+ */
+typedef struct
+{
+    size_t end;
+    int slot;
+} tActiveSlot;
+
+/**
+ * Checks whether a variable name was made by threeAC_create_temp().
+ *
+ * @param name Variable name.
+ * @return true for names of the form "tN".
+ */
+static bool tempalloc_is_temp(const char *name)
+{
+    if (name[0] != 't' || name[1] == '\0')
+    {
+        return false;
+    }
+    for (const char *c = name + 1; *c != '\0'; c++)
+    {
+        if (!isdigit((unsigned char)*c))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Orders intervals by their start for qsort.
+ *
+ * @param a First interval.
+ * @param b Second interval.
+ * @return Negative, zero or positive like strcmp.
+ */
+static int tempalloc_compare(const void *a, const void *b)
+{
+    const tTempInterval *x = a;
+    const tTempInterval *y = b;
+    if (x->start != y->start)
+    {
+        return x->start < y->start ? -1 : 1;
+    }
+    return x->temp - y->temp;
+}
+
+/**
+ * Adds a slot to the min-heap of active slots ordered by the end of their interval.
+ *
+ * @param heap The heap.
+ * @param count Number of slots in the heap, incremented.
+ * @param item The slot.
+ */
+static void tempalloc_heap_push(tActiveSlot *heap, size_t *count, tActiveSlot item)
+{
+    size_t i = (*count)++;
+    while (i > 0 && heap[(i - 1) / 2].end > item.end)
+    {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = item;
+}
+
+/**
+ * Removes the slot whose interval ends first from the heap.
+ *
+ * @param heap The heap.
+ * @param count Number of slots in the heap, decremented.
+ * @return The removed slot.
+ */
+static tActiveSlot tempalloc_heap_pop(tActiveSlot *heap, size_t *count)
+{
+    tActiveSlot top = heap[0];
+    tActiveSlot last = heap[--*count];
+    size_t i = 0;
+    while (2 * i + 1 < *count)
+    {
+        size_t child = 2 * i + 1;
+        if (child + 1 < *count && heap[child + 1].end < heap[child].end)
+        {
+            child++;
+        }
+        if (heap[child].end >= last.end)
+        {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (*count > 0)
+    {
+        heap[i] = last;
+    }
+    return top;
+}
+
+/**
+ * Returns the temporary an operand refers to.
+ *
+ * @param cfg Graph of the function.
+ * @param tempOf Temporary number of every variable of the graph, -1 for other variables.
+ * @param operand The operand, may be NULL.
+ * @return Number of the temporary, or -1.
+ */
+static int tempalloc_temp(const tCfg *cfg, const int *tempOf, const tOperand *operand)
+{
+    int index = cfg_var_index(cfg, operand);
+    return index >= 0 ? tempOf[index] : -1;
+}
+
+/**
+ * Computes which temporaries are live at the start and at the end of every
+ * block. Unlike dataflow_liveness(), DEFVAR does not count as an assignment,
+ * so a temporary read before its first assignment is live at the entry.
+ *
+ * @param df The problem, initialized by this function.
+ * @param cfg Graph of the function.
+ * @param tempOf Temporary number of every variable of the graph.
+ * @param tempCount Number of temporaries.
+ */
+static void tempalloc_liveness(tDataflow *df, const tCfg *cfg, const int *tempOf, int tempCount)
+{
+    dataflow_init(df, cfg, DATAFLOW_BACKWARD, DATAFLOW_UNION, (size_t)tempCount);
+
+    for (int i = 0; i < cfg->blockCount; i++)
+    {
+        const tBasicBlock *block = &cfg->blocks[i];
+        for (tInstructionNode *node = block->first; node != NULL; node = node->next)
+        {
+            int uses[3];
+            int useCount = cfg_instruction_uses(cfg, node, uses);
+            for (int u = 0; u < useCount; u++)
+            {
+                int temp = tempOf[uses[u]];
+                if (temp >= 0 && !bitset_test(&df->kill[i], temp))
+                {
+                    bitset_set(&df->gen[i], temp);
+                }
+            }
+
+            int def = cfg_instruction_def(cfg, node);
+            if (def >= 0 && tempOf[def] >= 0 && node->opType != OP_DEFVAR)
+            {
+                bitset_set(&df->kill[i], tempOf[def]);
+            }
+
+            if (node == block->last)
+            {
+                break;
+            }
+        }
+    }
+
+    dataflow_solve(df, cfg);
+}
+
+/**
+ * Extends an interval to contain a position.
+ *
+ * @param interval The interval.
+ * @param position The position.
+ */
+static void tempalloc_extend(tTempInterval *interval, size_t position)
+{
+    if (position < interval->start)
+    {
+        interval->start = position;
+    }
+    if (position > interval->end)
+    {
+        interval->end = position;
+    }
+}
+
+/**
+ * Merges the temporaries of one function.
+ *
+ * @param list The generated code.
+ * @param cfg Graph of the function.
+ * @return Number of removed temporaries.
+ */
+static size_t tempalloc_function(tThreeACList *list, tCfg *cfg)
+{
+    int *tempOf = safeMalloc(sizeof(int) * (cfg->varCount + 1));
+    tOperand **defOperand = safeMalloc(sizeof(tOperand *) * (cfg->varCount + 1));
+    int tempCount = 0;
+    for (int i = 0; i < cfg->varCount; i++)
+    {
+        tempOf[i] = -1;
+    }
+
+    tInstructionNode *end = cfg->last->next;
+    for (tInstructionNode *node = cfg->first; node != end; node = node->next)
+    {
+        int index = cfg_var_index(cfg, node->result);
+        if (node->opType == OP_DEFVAR && index >= 0 && tempOf[index] < 0 &&
+            tempalloc_is_temp(node->result->value.varname))
+        {
+            defOperand[tempCount] = node->result;
+            tempOf[index] = tempCount++;
+        }
+    }
+
+    if (tempCount < 2 || (size_t)cfg->blockCount * (size_t)tempCount > TEMPALLOC_MAX_BITS)
+    {
+        free(tempOf);
+        free(defOperand);
+        return 0;
+    }
+
+    tDataflow df;
+    tempalloc_liveness(&df, cfg, tempOf, tempCount);
+
+    tTempInterval *intervals = safeMalloc(sizeof(tTempInterval) * tempCount);
+    for (int t = 0; t < tempCount; t++)
+    {
+        intervals[t].temp = t;
+        intervals[t].start = SIZE_MAX;
+        intervals[t].end = 0;
+    }
+
+    // Blocks are contiguous and in the order of the listing
+    size_t position = 0;
+    for (int i = 0; i < cfg->blockCount; i++)
+    {
+        const tBasicBlock *block = &cfg->blocks[i];
+        size_t first = position;
+        for (tInstructionNode *node = block->first; node != NULL; node = node->next)
+        {
+            if (node->opType != OP_DEFVAR)
+            {
+                int uses[3];
+                int useCount = cfg_instruction_uses(cfg, node, uses);
+                for (int u = 0; u < useCount; u++)
+                {
+                    if (tempOf[uses[u]] >= 0)
+                    {
+                        tempalloc_extend(&intervals[tempOf[uses[u]]], position);
+                    }
+                }
+                int def = cfg_instruction_def(cfg, node);
+                if (def >= 0 && tempOf[def] >= 0)
+                {
+                    tempalloc_extend(&intervals[tempOf[def]], position);
+                }
+            }
+            if (node == block->last)
+            {
+                break;
+            }
+            position++;
+        }
+
+        for (int t = 0; t < tempCount; t++)
+        {
+            if (bitset_test(&df.in[i], t))
+            {
+                tempalloc_extend(&intervals[t], first);
+            }
+            if (bitset_test(&df.out[i], t))
+            {
+                tempalloc_extend(&intervals[t], position);
+            }
+        }
+        position++;
+    }
+
+    // Temporaries that may be read uninitialized or are never used keep their variable
+    size_t candidateCount = 0;
+    for (int t = 0; t < tempCount; t++)
+    {
+        if (intervals[t].start != SIZE_MAX && !bitset_test(&df.in[0], t))
+        {
+            intervals[candidateCount++] = intervals[t];
+        }
+    }
+    qsort(intervals, candidateCount, sizeof(tTempInterval), tempalloc_compare);
+
+    int *slotOf = safeMalloc(sizeof(int) * tempCount);
+    int *slotOwner = safeMalloc(sizeof(int) * tempCount);
+    int *freeSlots = safeMalloc(sizeof(int) * tempCount);
+    tActiveSlot *active = safeMalloc(sizeof(tActiveSlot) * tempCount);
+    size_t activeCount = 0;
+    int freeCount = 0;
+    int slotCount = 0;
+    for (int t = 0; t < tempCount; t++)
+    {
+        slotOf[t] = -1;
+    }
+
+    for (size_t i = 0; i < candidateCount; i++)
+    {
+        while (activeCount > 0 && active[0].end < intervals[i].start)
+        {
+            freeSlots[freeCount++] = tempalloc_heap_pop(active, &activeCount).slot;
+        }
+
+        int slot;
+        if (freeCount > 0)
+        {
+            slot = freeSlots[--freeCount];
+        }
+        else
+        {
+            slot = slotCount++;
+            slotOwner[slot] = intervals[i].temp;
+        }
+        slotOf[intervals[i].temp] = slot;
+        tActiveSlot item = {intervals[i].end, slot};
+        tempalloc_heap_push(active, &activeCount, item);
+    }
+
+    // Rename to the first temporary of each slot and drop the other DEFVARs
+    size_t merged = 0;
+    tInstructionNode *node = cfg->first;
+    while (node != end)
+    {
+        tInstructionNode *next = node->next;
+        tOperand **operands[] = {&node->result, &node->arg1, &node->arg2};
+        bool removed = false;
+        for (int k = 0; k < 3 && !removed; k++)
+        {
+            int temp = tempalloc_temp(cfg, tempOf, *operands[k]);
+            if (temp < 0 || slotOf[temp] < 0 || slotOwner[slotOf[temp]] == temp)
+            {
+                continue;
+            }
+            if (node->opType == OP_DEFVAR)
+            {
+                list_remove(list, node);
+                merged++;
+                removed = true;
+            }
+            else
+            {
+                *operands[k] = defOperand[slotOwner[slotOf[temp]]];
+            }
+        }
+        node = next;
+    }
+
+    dataflow_dispose(&df);
+    free(tempOf);
+    free(defOperand);
+    free(intervals);
+    free(slotOf);
+    free(slotOwner);
+    free(freeSlots);
+    free(active);
+    return merged;
+}
+
+size_t tempalloc_run(tThreeACList *list)
+{
+    int count;
+    size_t merged = 0;
+
+    tCfg *cfgs = cfg_build_program(list, &count);
+    for (int i = 0; i < count; i++)
+    {
+        merged += tempalloc_function(list, &cfgs[i]);
+    }
+    cfg_dispose_program(cfgs, count);
+
+    stats_rule_hits("tempalloc", "merged-temp", merged);
+    return merged;
+}
@@ -0,0 +1,35 @@
+/**
+ * @file tempalloc.h
+ *
+ * IFJ25 project
+ *
+ * Reuse of temporary variables (-O1).
+ *
+ * The code generator takes a fresh temporary ("tN") for every intermediate
+ * value, so a long function defines thousands of LF@ variables and every
+ * call creates a frame that big. This pass computes the live range of each
+ * temporary and assigns the temporaries to slots in linear-scan fashion: a
+ * temporary takes over the slot of one whose range has ended. Each slot is
+ * named after the first temporary assigned to it and keeps only that
+ * temporary's DEFVAR in the function prologue.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_TEMPALLOC_H
+#define IFJ_TEMPALLOC_H
+
+#include "3AC.h"
+
+#include <stddef.h>
+
+/**
+ * Merges temporaries with disjoint live ranges in every function and
+ * reports the merges to the statistics.
+ *
+ * @param list The generated code.
+ * @return Number of removed temporaries.
+ */
+size_t tempalloc_run(tThreeACList *list);
+
+#endif // IFJ_TEMPALLOC_H
@@ -0,0 +1,190 @@
+/**
+ * @file timing.c
+ *
+ * IFJ25 project
+ *
+ * Per-phase compile time and allocation instrumentation (--time-report).
+ *
+ * @author agent <agent@local>
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "timing.h"
+
+#ifdef IFJ_INSTRUMENT
+
+#include <stdint.h>
+#include <time.h>
+
+#define TIMING_MAX_DEPTH 32
+
+/**
+ * Accumulated measurements of one phase.
+ */
+typedef struct
+{
+    uint64_t calls;
+    uint64_t totalNs;
+    uint64_t childNs;
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+} tPhaseStats;
+
+/**
+ * One running phase on the phase stack.
+ */
+typedef struct
+{
+    tPhase phase;
+    uint64_t startNs;
+} tPhaseFrame;
+
+bool timingEnabled = false;
+
+static tPhaseStats phaseStats[PHASE_COUNT];
+static tPhaseStats otherStats;
+static tPhaseFrame phaseStack[TIMING_MAX_DEPTH];
+static int phaseDepth = 0;
+static uint64_t programStartNs = 0;
+
+static const char *phaseNames[PHASE_COUNT] = {
+    "lex",          "parse",     "codegen",       "hoist",          "print",
+    "ir_io",        "optimize",  "pass_accessors", "pass_inline",   "pass_tailcall",
+    "pass_peephole", "pass_lvn", "pass_dce",      "pass_licm",      "pass_callgraph",
+    "pass_tempalloc", "verify_ir",
+};
+
+static const char *phaseDescriptions[PHASE_COUNT] = {
+    "lexing (getToken)", "parsing and semantics", "code emission (emit)",
+    "DEFVAR hoisting", "output (list_print)", "IR file I/O",
+    "optimization passes", "  accessors", "  inline", "  tailcall", "  peephole", "  lvn",
+    "  dce", "  licm", "  callgraph", "  tempalloc", "IR verification",
+};
+
+/**
+ * Reads the monotonic clock.
+ *
+ * @return Current time in nanoseconds.
+ */
+static uint64_t timing_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void timing_enable(void)
+{
+    timingEnabled = true;
+    programStartNs = timing_now();
+}
+
+void timing_begin(tPhase phase)
+{
+    if (phaseDepth < TIMING_MAX_DEPTH)
+    {
+        phaseStack[phaseDepth].phase = phase;
+        phaseStack[phaseDepth].startNs = timing_now();
+    }
+    phaseDepth++;
+    phaseStats[phase].calls++;
+}
+
+void timing_end(tPhase phase)
+{
+    if (phaseDepth == 0)
+    {
+        return;
+    }
+    phaseDepth--;
+    if (phaseDepth >= TIMING_MAX_DEPTH || phaseStack[phaseDepth].phase != phase)
+    {
+        return;
+    }
+
+    uint64_t elapsed = timing_now() - phaseStack[phaseDepth].startNs;
+    phaseStats[phase].totalNs += elapsed;
+    if (phaseDepth > 0 && phaseDepth - 1 < TIMING_MAX_DEPTH)
+    {
+        phaseStats[phaseStack[phaseDepth - 1].phase].childNs += elapsed;
+    }
+}
+
+void timing_count_alloc(size_t bytes)
+{
+    tPhaseStats *stats = &otherStats;
+    if (phaseDepth > 0 && phaseDepth <= TIMING_MAX_DEPTH)
+    {
+        stats = &phaseStats[phaseStack[phaseDepth - 1].phase];
+    }
+    stats->allocations++;
+    stats->allocatedBytes += bytes;
+}
+
+/**
+ * Converts nanoseconds to milliseconds.
+ *
+ * @param ns Time in nanoseconds.
+ * @return Time in milliseconds.
+ */
+static double timing_ms(uint64_t ns)
+{
+    return (double)ns / 1e6;
+}
+
+void timing_report(FILE *out, bool json)
+{
+    uint64_t totalNs = timing_now() - programStartNs;
+    uint64_t totalAllocations = otherStats.allocations;
+    uint64_t totalBytes = otherStats.allocatedBytes;
+    for (int i = 0; i < PHASE_COUNT; i++)
+    {
+        totalAllocations += phaseStats[i].allocations;
+        totalBytes += phaseStats[i].allocatedBytes;
+    }
+
+    if (json)
+    {
+        fprintf(out, "{\n  \"totalMs\": %.3f,\n  \"allocations\": %llu,\n"
+                     "  \"allocatedBytes\": %llu,\n  \"phases\": [\n",
+                timing_ms(totalNs), (unsigned long long)totalAllocations,
+                (unsigned long long)totalBytes);
+        for (int i = 0; i < PHASE_COUNT; i++)
+        {
+            const tPhaseStats *s = &phaseStats[i];
+            fprintf(out,
+                    "    {\"name\": \"%s\", \"calls\": %llu, \"totalMs\": %.3f, "
+                    "\"selfMs\": %.3f, \"allocations\": %llu, \"allocatedBytes\": %llu}%s\n",
+                    phaseNames[i], (unsigned long long)s->calls, timing_ms(s->totalNs),
+                    timing_ms(s->totalNs - s->childNs), (unsigned long long)s->allocations,
+                    (unsigned long long)s->allocatedBytes, i + 1 < PHASE_COUNT ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+        return;
+    }
+
+    fprintf(out, "Time report (monotonic clock)\n");
+    fprintf(out, "  %-24s %10s %11s %11s %10s %14s\n", "phase", "calls", "total ms", "self ms",
+            "allocs", "alloc bytes");
+    for (int i = 0; i < PHASE_COUNT; i++)
+    {
+        const tPhaseStats *s = &phaseStats[i];
+        fprintf(out, "  %-24s %10llu %11.3f %11.3f %10llu %14llu\n", phaseDescriptions[i],
+                (unsigned long long)s->calls, timing_ms(s->totalNs),
+                timing_ms(s->totalNs - s->childNs), (unsigned long long)s->allocations,
+                (unsigned long long)s->allocatedBytes);
+    }
+    fprintf(out, "  %-24s %10s %11s %11s %10llu %14llu\n", "other", "", "", "",
+            (unsigned long long)otherStats.allocations,
+            (unsigned long long)otherStats.allocatedBytes);
+    fprintf(out, "  %-24s %10s %11.3f %11s %10llu %14llu\n", "total", "", timing_ms(totalNs), "",
+            (unsigned long long)totalAllocations, (unsigned long long)totalBytes);
+}
+
+#else
+
+// Keeps the translation unit non-empty when instrumentation is compiled out
+typedef int tTimingDisabled;
+
+#endif // IFJ_INSTRUMENT
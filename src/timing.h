@@ -0,0 +1,117 @@
+/**
+ * @file timing.h
+ *
+ * IFJ25 project
+ *
+ * Per-phase compile time and allocation instrumentation (--time-report).
+ *
+ * Phases nest: lexing, code emission and hoisting run inside parsing, so
+ * every phase reports both its inclusive time and its self time without
+ * nested phases. Allocations are attributed to the innermost running phase.
+ *
+ * The instrumentation is only compiled in when IFJ_INSTRUMENT is defined.
+ * Without it all TIMING_* macros expand to nothing.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_TIMING_H
+#define IFJ_TIMING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Instrumented compiler phases.
+ */
+typedef enum
+{
+    PHASE_LEX,
+    PHASE_PARSE,
+    PHASE_CODEGEN,
+    PHASE_HOIST,
+    PHASE_PRINT,
+    PHASE_IR_IO,
+    PHASE_OPTIMIZE,
+    PHASE_PASS_ACCESSORS,
+    PHASE_PASS_INLINE,
+    PHASE_PASS_TAILCALL,
+    PHASE_PASS_PEEPHOLE,
+    PHASE_PASS_LVN,
+    PHASE_PASS_DCE,
+    PHASE_PASS_LICM,
+    PHASE_PASS_CALLGRAPH,
+    PHASE_PASS_TEMPALLOC,
+    PHASE_VERIFY,
+    PHASE_COUNT
+} tPhase;
+
+#ifdef IFJ_INSTRUMENT
+
+extern bool timingEnabled;
+
+/**
+ * Turns the instrumentation on and starts the total time measurement.
+ */
+void timing_enable(void);
+
+/**
+ * Starts measuring a phase.
+ *
+ * @param phase The phase that starts.
+ */
+void timing_begin(tPhase phase);
+
+/**
+ * Stops measuring the innermost running phase.
+ *
+ * @param phase The phase that ends, must match the last started one.
+ */
+void timing_end(tPhase phase);
+
+/**
+ * Counts one allocation in the innermost running phase.
+ *
+ * @param bytes Number of requested bytes.
+ */
+void timing_count_alloc(size_t bytes);
+
+/**
+ * Prints the collected measurements.
+ *
+ * @param out Output stream.
+ * @param json Print JSON instead of a human-readable table.
+ */
+void timing_report(FILE *out, bool json);
+
+#define TIMING_BEGIN(phase)                                                                        \
+    do                                                                                             \
+    {                                                                                              \
+        if (timingEnabled)                                                                         \
+            timing_begin(phase);                                                                   \
+    } while (0)
+
+#define TIMING_END(phase)                                                                          \
+    do                                                                                             \
+    {                                                                                              \
+        if (timingEnabled)                                                                         \
+            timing_end(phase);                                                                     \
+    } while (0)
+
+#define TIMING_COUNT_ALLOC(bytes)                                                                  \
+    do                                                                                             \
+    {                                                                                              \
+        if (timingEnabled)                                                                         \
+            timing_count_alloc(bytes);                                                             \
+    } while (0)
+
+#else
+
+#define TIMING_BEGIN(phase) ((void)0)
+#define TIMING_END(phase) ((void)0)
+#define TIMING_COUNT_ALLOC(bytes) ((void)0)
+
+#endif // IFJ_INSTRUMENT
+
+#endif // IFJ_TIMING_H
@@ -0,0 +1,642 @@
+/**
+ * @file typeinfer.c
+ *
+ * IFJ25 project
+ *
+ * Flow-sensitive inference of run-time types of local variables.
+ *
+ * Each variable has a slot with its type and the epoch in which the type
+ * was recorded. Entering a loop starts a new epoch and everything recorded
+ * before it counts as unknown, which forgets all variables in constant
+ * time. Every change of a slot is logged, so the facts of a then block can
+ * be rolled back before the else block and the changes made inside a
+ * construct can be enumerated when it ends.
+ *
+ * Function summaries are solved lazily: the first call that finds the
+ * callee and all functions it depends on parsed computes the least fixpoint
+ * for all of them at once, and their results never change afterwards.
+ *
+ * @author agent <agent@local>
+ */
+
+#include "typeinfer.h"
+#include "helper.h"
+#include "strmap.h"
+
+#include <string.h>
+
+bool typeCallResults = false;
+
+/**
+ * Inferred type of one variable.
+ */
+typedef struct
+{
+    tRtType type;
+    unsigned epoch;
+    unsigned stamp;  // Deduplicates slots while a construct is closed
+    tRtType scratch; // Type from the else block while an if statement is closed
+} tTypeSlot;
+
+/**
+ * Previous content of a slot, used to roll changes back.
+ */
+typedef struct
+{
+    size_t slot;
+    tRtType type;
+    unsigned epoch;
+} tTypeUndo;
+
+/**
+ * What a user function returns.
+ */
+typedef struct
+{
+    tRtType returns; // Types of the returned values that are not call results
+    int *callees;    // Functions whose results are returned as they are
+    size_t calleeCount;
+    bool parsed;     // The whole body has been seen
+    tRtType result;  // Solved type, RT_NONE until it is known
+    unsigned stamp;  // Marks the functions of one fixpoint
+    tRtType scratch; // Type of the function during the fixpoint
+} tFunctionSummary;
+
+/**
+ * Built-in functions and the types they return.
+ */
+static const struct
+{
+    const char *name;
+    tRtType type;
+} builtin_results[] = {
+    {"Ifj.write", RT_NIL},
+    {"Ifj.read_num", RT_NUM | RT_NIL},
+    {"Ifj.read_str", RT_STRING | RT_NIL},
+    {"Ifj.floor", RT_INT},
+    {"Ifj.str", RT_STRING},
+    {"Ifj.length", RT_INT},
+    {"Ifj.substring", RT_STRING | RT_NIL},
+    {"Ifj.strcmp", RT_INT},
+    {"Ifj.ord", RT_INT},
+    {"Ifj.chr", RT_STRING},
+};
+
+static tStrMap slotIndex;
+static bool slotIndexReady = false;
+static tTypeSlot *slots = NULL;
+static size_t slotCount = 0;
+static size_t slotCapacity = 0;
+
+static tTypeUndo *undoLog = NULL;
+static size_t undoCount = 0;
+static size_t undoCapacity = 0;
+
+static unsigned currentEpoch = 0;
+static unsigned killEpoch = 0;
+static unsigned currentStamp = 0;
+
+static tRtType lastValue = RT_ANY;
+static int lastCallee = -1;
+
+static tStrMap functionIndex;
+static bool functionIndexReady = false;
+static tFunctionSummary *functions = NULL;
+static int functionCount = 0;
+static int functionCapacity = 0;
+static unsigned functionStamp = 0;
+
+// Return statements of the function being parsed
+static bool reachable = true;
+static tRtType currentReturns = RT_NONE;
+static int *currentCallees = NULL;
+static size_t currentCalleeCount = 0;
+static size_t currentCalleeCapacity = 0;
+
+tRtType typeinfer_join(tRtType a, tRtType b)
+{
+    return (tRtType)(a | b);
+}
+
+bool typeinfer_is(tRtType type, tRtType set)
+{
+    return type != RT_NONE && (type & ~set) == 0;
+}
+
+/**
+ * Returns the slot of a variable.
+ *
+ * @param var Unique name of the variable.
+ * @param create Create the slot if the variable has none.
+ * @param slot Output for the slot index.
+ * @return true if the slot exists.
+ */
+static bool typeinfer_slot(const char *var, bool create, size_t *slot)
+{
+    if (!slotIndexReady)
+    {
+        strmap_init(&slotIndex);
+        slotIndexReady = true;
+    }
+
+    if (strmap_get(&slotIndex, var, slot))
+    {
+        return true;
+    }
+    if (!create)
+    {
+        return false;
+    }
+
+    if (slotCount == slotCapacity)
+    {
+        slotCapacity = slotCapacity == 0 ? 64 : slotCapacity * 2;
+        slots = safeRealloc(slots, sizeof(tTypeSlot) * slotCapacity);
+    }
+    slots[slotCount].type = RT_ANY;
+    slots[slotCount].epoch = 0;
+    slots[slotCount].stamp = 0;
+    slots[slotCount].scratch = RT_ANY;
+    strmap_put(&slotIndex, var, slotCount);
+    *slot = slotCount++;
+    return true;
+}
+
+/**
+ * Returns the type of a slot, unknown if it was recorded before the
+ * innermost loop.
+ *
+ * @param slot The slot.
+ * @return The type.
+ */
+static tRtType typeinfer_slot_type(size_t slot)
+{
+    return slots[slot].epoch < killEpoch ? RT_ANY : slots[slot].type;
+}
+
+/**
+ * Changes the type of a slot and logs its previous content.
+ *
+ * @param slot The slot.
+ * @param type The new type.
+ */
+static void typeinfer_update(size_t slot, tRtType type)
+{
+    if (undoCount == undoCapacity)
+    {
+        undoCapacity = undoCapacity == 0 ? 64 : undoCapacity * 2;
+        undoLog = safeRealloc(undoLog, sizeof(tTypeUndo) * undoCapacity);
+    }
+    undoLog[undoCount].slot = slot;
+    undoLog[undoCount].type = slots[slot].type;
+    undoLog[undoCount].epoch = slots[slot].epoch;
+    undoCount++;
+
+    slots[slot].type = type;
+    slots[slot].epoch = currentEpoch;
+}
+
+/**
+ * Restores all slots changed since a log position.
+ *
+ * @param mark The log position.
+ */
+static void typeinfer_rollback(size_t mark)
+{
+    while (undoCount > mark)
+    {
+        undoCount--;
+        tTypeUndo *entry = &undoLog[undoCount];
+        slots[entry->slot].type = entry->type;
+        slots[entry->slot].epoch = entry->epoch;
+    }
+}
+
+/**
+ * Collects the current types of all slots changed since a log position.
+ *
+ * @param mark The log position.
+ * @param count Output for the number of facts.
+ * @return The facts, each slot at most once.
+ */
+static tTypeFact *typeinfer_collect(size_t mark, size_t *count)
+{
+    tTypeFact *facts = safeMalloc(sizeof(tTypeFact) * (undoCount - mark + 1));
+    *count = 0;
+    currentStamp++;
+
+    for (size_t i = mark; i < undoCount; i++)
+    {
+        size_t slot = undoLog[i].slot;
+        if (slots[slot].stamp == currentStamp)
+        {
+            continue;
+        }
+        slots[slot].stamp = currentStamp;
+        facts[*count].slot = slot;
+        facts[*count].type = typeinfer_slot_type(slot);
+        (*count)++;
+    }
+    return facts;
+}
+
+void typeinfer_function_begin(void)
+{
+    undoCount = 0;
+    killEpoch = ++currentEpoch;
+    reachable = true;
+    currentReturns = RT_NONE;
+    currentCalleeCount = 0;
+}
+
+tRtType typeinfer_get(const char *var)
+{
+    size_t slot;
+    if (var == NULL || !typeinfer_slot(var, false, &slot))
+    {
+        return RT_ANY;
+    }
+    return typeinfer_slot_type(slot);
+}
+
+void typeinfer_set(const char *var, tRtType type)
+{
+    size_t slot;
+    typeinfer_slot(var, true, &slot);
+    typeinfer_update(slot, type == RT_NONE ? RT_ANY : type);
+}
+
+void typeinfer_narrow(const char *var, tRtType type)
+{
+    if (var == NULL)
+    {
+        return;
+    }
+
+    tRtType current = typeinfer_get(var);
+    tRtType narrowed = (tRtType)(current & type);
+    if (narrowed != current && narrowed != RT_NONE)
+    {
+        typeinfer_set(var, narrowed);
+    }
+}
+
+void typeinfer_branch_begin(tTypeBranch *branch)
+{
+    branch->mark = undoCount;
+    branch->thenFacts = NULL;
+    branch->thenCount = 0;
+    branch->reachable = reachable;
+}
+
+void typeinfer_branch_else(tTypeBranch *branch)
+{
+    branch->thenFacts = typeinfer_collect(branch->mark, &branch->thenCount);
+    typeinfer_rollback(branch->mark);
+    branch->thenReachable = reachable;
+    reachable = branch->reachable;
+}
+
+/**
+ * Joins facts with the types their slots had before a construct and
+ * records the result.
+ *
+ * @param facts The facts, each slot at most once.
+ * @param count Number of facts.
+ */
+static void typeinfer_merge(const tTypeFact *facts, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        tRtType before = typeinfer_slot_type(facts[i].slot);
+        typeinfer_update(facts[i].slot, typeinfer_join(facts[i].type, before));
+    }
+}
+
+void typeinfer_branch_end(tTypeBranch *branch)
+{
+    size_t elseCount;
+    tTypeFact *elseFacts = typeinfer_collect(branch->mark, &elseCount);
+    typeinfer_rollback(branch->mark);
+
+    currentStamp++;
+    for (size_t i = 0; i < elseCount; i++)
+    {
+        slots[elseFacts[i].slot].stamp = currentStamp;
+        slots[elseFacts[i].slot].scratch = elseFacts[i].type;
+    }
+
+    // A slot changed in the then block meets its else type, or its old
+    // type if the else block left it alone
+    for (size_t i = 0; i < branch->thenCount; i++)
+    {
+        size_t index = branch->thenFacts[i].slot;
+        tRtType other = typeinfer_slot_type(index);
+        if (slots[index].stamp == currentStamp)
+        {
+            other = slots[index].scratch;
+            slots[index].stamp = 0;
+        }
+        typeinfer_update(index, typeinfer_join(branch->thenFacts[i].type, other));
+    }
+
+    // Slots changed only in the else block meet their old type
+    size_t onlyElse = 0;
+    for (size_t i = 0; i < elseCount; i++)
+    {
+        if (slots[elseFacts[i].slot].stamp == currentStamp)
+        {
+            elseFacts[onlyElse++] = elseFacts[i];
+        }
+    }
+    typeinfer_merge(elseFacts, onlyElse);
+
+    free(elseFacts);
+    free(branch->thenFacts);
+    branch->thenFacts = NULL;
+    reachable = reachable || branch->thenReachable;
+}
+
+void typeinfer_loop_begin(tTypeLoop *loop)
+{
+    loop->mark = undoCount;
+    loop->savedKill = killEpoch;
+    killEpoch = ++currentEpoch;
+    loop->reachable = reachable;
+}
+
+void typeinfer_loop_end(tTypeLoop *loop)
+{
+    size_t count;
+    tTypeFact *facts = typeinfer_collect(loop->mark, &count);
+    typeinfer_rollback(loop->mark);
+    killEpoch = loop->savedKill;
+    currentEpoch++;
+
+    typeinfer_merge(facts, count);
+    free(facts);
+
+    // The condition may be false right away
+    reachable = loop->reachable;
+}
+
+void typeinfer_set_value(tRtType type)
+{
+    lastValue = type;
+    lastCallee = -1;
+}
+
+tRtType typeinfer_value(void)
+{
+    return lastValue;
+}
+
+tRtType typeinfer_binary_result(const char *op, tRtType left, tRtType right)
+{
+    tRtType result = RT_NONE;
+
+    if (strcmp(op, "+") == 0)
+    {
+        if ((left & RT_STRING) && (right & RT_STRING))
+            result = typeinfer_join(result, RT_STRING);
+        if ((left & RT_NUM) && (right & RT_NUM))
+            result = typeinfer_join(result, RT_FLOAT);
+    }
+    else if (strcmp(op, "*") == 0)
+    {
+        if ((left & RT_STRING) && (right & RT_NUM))
+            result = typeinfer_join(result, RT_STRING);
+        if ((left & RT_NUM) && (right & RT_NUM))
+            result = typeinfer_join(result, RT_FLOAT);
+    }
+    else if (strcmp(op, "-") == 0 || strcmp(op, "/") == 0)
+    {
+        result = RT_FLOAT;
+    }
+    else
+    {
+        result = RT_BOOL;
+    }
+
+    // An operation that always fails leaves nothing behind
+    return result == RT_NONE ? RT_ANY : result;
+}
+
+tRtType typeinfer_binary_operand(const char *op, tRtType self, tRtType other, bool isLeft)
+{
+    tRtType allowed;
+
+    if (strcmp(op, "+") == 0)
+    {
+        allowed = typeinfer_is(other, RT_STRING) ? RT_STRING
+                  : typeinfer_is(other, RT_NUM)  ? RT_NUM
+                                                 : (tRtType)(RT_STRING | RT_NUM);
+    }
+    else if (strcmp(op, "*") == 0)
+    {
+        allowed = isLeft ? (tRtType)(RT_STRING | RT_NUM) : RT_NUM;
+    }
+    else if (strcmp(op, "==") == 0 || strcmp(op, "!=") == 0)
+    {
+        allowed = RT_ANY;
+    }
+    else
+    {
+        // - / < > <= >=
+        allowed = RT_NUM;
+    }
+
+    tRtType narrowed = (tRtType)(self & allowed);
+    return narrowed == RT_NONE ? self : narrowed;
+}
+
+tRtType typeinfer_builtin_result(const char *fullName)
+{
+    for (size_t i = 0; i < sizeof(builtin_results) / sizeof(builtin_results[0]); i++)
+    {
+        if (strcmp(builtin_results[i].name, fullName) == 0)
+        {
+            return builtin_results[i].type;
+        }
+    }
+    return RT_ANY;
+}
+
+void typeinfer_set_callee(int function)
+{
+    lastCallee = function;
+}
+
+int typeinfer_value_callee(void)
+{
+    return lastCallee;
+}
+
+int typeinfer_function(const char *name)
+{
+    if (!functionIndexReady)
+    {
+        strmap_init(&functionIndex);
+        functionIndexReady = true;
+    }
+
+    size_t index;
+    if (strmap_get(&functionIndex, name, &index))
+    {
+        return (int)index;
+    }
+
+    if (functionCount == functionCapacity)
+    {
+        functionCapacity = functionCapacity == 0 ? 16 : functionCapacity * 2;
+        functions = safeRealloc(functions, sizeof(tFunctionSummary) * functionCapacity);
+    }
+    tFunctionSummary *function = &functions[functionCount];
+    function->returns = RT_NONE;
+    function->callees = NULL;
+    function->calleeCount = 0;
+    function->parsed = false;
+    function->result = RT_NONE;
+    function->stamp = 0;
+    function->scratch = RT_NONE;
+    strmap_put(&functionIndex, name, (size_t)functionCount);
+    return functionCount++;
+}
+
+void typeinfer_return(tRtType type, int callee)
+{
+    if (!reachable)
+    {
+        return;
+    }
+    reachable = false;
+
+    if (callee < 0)
+    {
+        currentReturns = typeinfer_join(currentReturns, type == RT_NONE ? RT_ANY : type);
+        return;
+    }
+    if (currentCalleeCount == currentCalleeCapacity)
+    {
+        currentCalleeCapacity = currentCalleeCapacity == 0 ? 8 : currentCalleeCapacity * 2;
+        currentCallees = safeRealloc(currentCallees, sizeof(int) * currentCalleeCapacity);
+    }
+    currentCallees[currentCalleeCount++] = callee;
+}
+
+void typeinfer_function_end(const char *name)
+{
+    int index = typeinfer_function(name);
+    tFunctionSummary *function = &functions[index];
+
+    // Falling off the end returns the null the result was initialized to
+    function->returns = reachable ? typeinfer_join(currentReturns, RT_NIL) : currentReturns;
+    function->callees = NULL;
+    function->calleeCount = currentCalleeCount;
+    if (currentCalleeCount > 0)
+    {
+        function->callees = safeMalloc(sizeof(int) * currentCalleeCount);
+        memcpy(function->callees, currentCallees, sizeof(int) * currentCalleeCount);
+    }
+    function->parsed = true;
+}
+
+tRtType typeinfer_call_result(const char *name)
+{
+    int root = typeinfer_function(name);
+    if (functions[root].result != RT_NONE)
+    {
+        return functions[root].result;
+    }
+
+    // Everything the function returns results of, which must all be parsed
+    functionStamp++;
+    int *members = safeMalloc(sizeof(int) * functionCount);
+    int memberCount = 0;
+    members[memberCount++] = root;
+    functions[root].stamp = functionStamp;
+    for (int i = 0; i < memberCount; i++)
+    {
+        tFunctionSummary *function = &functions[members[i]];
+        if (!function->parsed)
+        {
+            free(members);
+            return RT_ANY;
+        }
+        for (size_t j = 0; j < function->calleeCount; j++)
+        {
+            int callee = function->callees[j];
+            if (functions[callee].stamp != functionStamp)
+            {
+                functions[callee].stamp = functionStamp;
+                members[memberCount++] = callee;
+            }
+        }
+    }
+
+    // Least fixpoint, the sets only grow
+    for (int i = 0; i < memberCount; i++)
+    {
+        tFunctionSummary *function = &functions[members[i]];
+        function->scratch = function->result != RT_NONE ? function->result : function->returns;
+    }
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = 0; i < memberCount; i++)
+        {
+            tFunctionSummary *function = &functions[members[i]];
+            tRtType type = function->scratch;
+            for (size_t j = 0; j < function->calleeCount; j++)
+            {
+                type = typeinfer_join(type, functions[function->callees[j]].scratch);
+            }
+            if (type != function->scratch)
+            {
+                function->scratch = type;
+                changed = true;
+            }
+        }
+    }
+
+    // A function that never returns may be given any type
+    for (int i = 0; i < memberCount; i++)
+    {
+        tFunctionSummary *function = &functions[members[i]];
+        function->result = function->scratch == RT_NONE ? RT_ANY : function->scratch;
+    }
+    free(members);
+    return functions[root].result;
+}
+
+void typeinfer_dispose(void)
+{
+    if (slotIndexReady)
+    {
+        strmap_dispose(&slotIndex);
+        slotIndexReady = false;
+    }
+    free(slots);
+    free(undoLog);
+    slots = NULL;
+    undoLog = NULL;
+    slotCount = slotCapacity = 0;
+    undoCount = undoCapacity = 0;
+
+    if (functionIndexReady)
+    {
+        strmap_dispose(&functionIndex);
+        functionIndexReady = false;
+    }
+    for (int i = 0; i < functionCount; i++)
+    {
+        free(functions[i].callees);
+    }
+    free(functions);
+    free(currentCallees);
+    functions = NULL;
+    currentCallees = NULL;
+    functionCount = functionCapacity = 0;
+    currentCalleeCount = currentCalleeCapacity = 0;
+}
@@ -0,0 +1,264 @@
+/**
+ * @file typeinfer.h
+ *
+ * IFJ25 project
+ *
+ * Flow-sensitive inference of run-time types of local variables.
+ *
+ * The parser generates code in a single pass, so the analysis runs along
+ * with it: every assignment records the type of the assigned value, an
+ * operator that did not fail narrows its variable operands (after `a - 1`
+ * the variable a holds a number) and the two branches of an if statement
+ * are joined where they meet again. Nothing is known about a variable at
+ * the head of a while loop, because the body has not been parsed yet; the
+ * facts from before the loop are joined with the ones from its end once
+ * the loop is closed. Globals and parameters are never known.
+ *
+ * The types a user function returns are summarized when its body ends:
+ * the types of the returned values, the functions whose results it returns
+ * as they are, and null if the end of the body can be reached. A call is
+ * typed once the callee and every function it returns results of have been
+ * parsed, by iterating the summaries to a fixpoint, so recursive functions
+ * are covered too. Calls of functions defined later are not known.
+ *
+ * @author agent <agent@local>
+ */
+
+#ifndef IFJ_TYPEINFER_H
+#define IFJ_TYPEINFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Set of IFJcode25 types a value may have at run time.
+ */
+typedef enum
+{
+    RT_NONE = 0,
+    RT_NIL = 1 << 0,
+    RT_BOOL = 1 << 1,
+    RT_INT = 1 << 2,
+    RT_FLOAT = 1 << 3,
+    RT_STRING = 1 << 4,
+    RT_NUM = RT_INT | RT_FLOAT,
+    RT_ANY = RT_NIL | RT_BOOL | RT_NUM | RT_STRING
+} tRtType;
+
+/**
+ * A variable and the type it had at some point.
+ */
+typedef struct
+{
+    size_t slot;
+    tRtType type;
+} tTypeFact;
+
+/**
+ * State of an if statement between its two branches.
+ */
+typedef struct
+{
+    size_t mark;
+    tTypeFact *thenFacts;
+    size_t thenCount;
+    bool reachable;     // The statement itself can be reached
+    bool thenReachable; // The end of the then block can be reached
+} tTypeBranch;
+
+/**
+ * State of a while loop while its body is parsed.
+ */
+typedef struct
+{
+    size_t mark;
+    unsigned savedKill;
+    bool reachable; // The loop itself can be reached
+} tTypeLoop;
+
+// Typed operators use the inferred results of calls (-O1 and above)
+extern bool typeCallResults;
+
+/**
+ * Joins two sets of types.
+ *
+ * @param a First set.
+ * @param b Second set.
+ * @return The union of both.
+ */
+tRtType typeinfer_join(tRtType a, tRtType b);
+
+/**
+ * Checks that a value is known to have one of the given types.
+ *
+ * @param type The inferred set.
+ * @param set The allowed types.
+ * @return true if type is non-empty and a subset of set.
+ */
+bool typeinfer_is(tRtType type, tRtType set);
+
+/**
+ * Forgets everything, called at the start of every function body.
+ */
+void typeinfer_function_begin(void);
+
+/**
+ * Returns the inferred type of a local variable.
+ *
+ * @param var Unique name of the variable.
+ * @return The set of possible types, RT_ANY if nothing is known.
+ */
+tRtType typeinfer_get(const char *var);
+
+/**
+ * Records an assignment to a local variable.
+ *
+ * @param var Unique name of the variable.
+ * @param type Type of the assigned value.
+ */
+void typeinfer_set(const char *var, tRtType type);
+
+/**
+ * Records that a variable has one of the given types, e.g. because an
+ * operator that only accepts numbers succeeded on it.
+ *
+ * @param var Unique name of the variable.
+ * @param type The allowed types.
+ */
+void typeinfer_narrow(const char *var, tRtType type);
+
+/**
+ * Called after the condition of an if statement.
+ *
+ * @param branch State of the statement.
+ */
+void typeinfer_branch_begin(tTypeBranch *branch);
+
+/**
+ * Called between the then and the else block; the else block starts from
+ * the facts valid before the then block.
+ *
+ * @param branch State of the statement.
+ */
+void typeinfer_branch_else(tTypeBranch *branch);
+
+/**
+ * Called after the else block, joins the facts of both blocks.
+ *
+ * @param branch State of the statement.
+ */
+void typeinfer_branch_end(tTypeBranch *branch);
+
+/**
+ * Called at the head of a while loop, before its condition.
+ *
+ * @param loop State of the loop.
+ */
+void typeinfer_loop_begin(tTypeLoop *loop);
+
+/**
+ * Called after the loop body, joins the facts from before the loop with
+ * the ones from the end of the body.
+ *
+ * @param loop State of the loop.
+ */
+void typeinfer_loop_end(tTypeLoop *loop);
+
+/**
+ * Records the type of the value an expression or a built-in call has
+ * just left on the data stack.
+ *
+ * @param type The type.
+ */
+void typeinfer_set_value(tRtType type);
+
+/**
+ * Returns the type recorded by typeinfer_set_value().
+ *
+ * @return The type.
+ */
+tRtType typeinfer_value(void);
+
+/**
+ * Type of the result of a binary operator that did not fail.
+ *
+ * @param op The operator, e.g. "+".
+ * @param left Type of the left operand.
+ * @param right Type of the right operand.
+ * @return The type of the result.
+ */
+tRtType typeinfer_binary_result(const char *op, tRtType left, tRtType right);
+
+/**
+ * Type an operand must have had for a binary operator to succeed.
+ *
+ * @param op The operator, e.g. "+".
+ * @param self Type of the operand.
+ * @param other Type of the other operand.
+ * @param isLeft true for the left operand.
+ * @return The narrowed type of the operand.
+ */
+tRtType typeinfer_binary_operand(const char *op, tRtType self, tRtType other, bool isLeft);
+
+/**
+ * Type of the value returned by a built-in function.
+ *
+ * @param fullName Name of the function, e.g. "Ifj.floor".
+ * @return The type of its result.
+ */
+tRtType typeinfer_builtin_result(const char *fullName);
+
+/**
+ * Records the user function the value recorded by typeinfer_set_value()
+ * is the result of.
+ *
+ * @param function The function from typeinfer_function(), -1 for none.
+ */
+void typeinfer_set_callee(int function);
+
+/**
+ * Returns the function recorded by typeinfer_set_callee().
+ *
+ * @return The function, -1 if the value is not the result of a call.
+ */
+int typeinfer_value_callee(void);
+
+/**
+ * Returns the number of a user function, registering it on first use.
+ *
+ * @param name Symbol table key of the function, e.g. "foo@2".
+ * @return The number.
+ */
+int typeinfer_function(const char *name);
+
+/**
+ * Records a return statement of the function being parsed. The code after
+ * it cannot be reached.
+ *
+ * @param type Type of the returned value.
+ * @param callee Function whose result is returned as it is, -1 for none.
+ */
+void typeinfer_return(tRtType type, int callee);
+
+/**
+ * Summarizes the function whose body has just been parsed.
+ *
+ * @param name Symbol table key of the function.
+ */
+void typeinfer_function_end(const char *name);
+
+/**
+ * Returns the types a call of a user function may give.
+ *
+ * @param name Symbol table key of the function.
+ * @return The set of possible types, RT_ANY while the function or one it
+ *         returns results of has not been parsed.
+ */
+tRtType typeinfer_call_result(const char *name);
+
+/**
+ * Frees all memory held by the analysis.
+ */
+void typeinfer_dispose(void);
+
+#endif // IFJ_TYPEINFER_H